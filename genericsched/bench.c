@@ -0,0 +1,161 @@
+/*
+ * bench.c
+ *
+ * Counters and JSON report for the headless benchmark mode (--bench).
+ * Shared by genericsched and marsched.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void bench_start(BenchStats *b)
+{
+    memset(b, 0, sizeof(*b));
+    b->start_ns = bench_now_ns();
+}
+
+void bench_linkup(BenchStats *b, int ticks, uint64_t ns)
+{
+    if (b->n_linkup == b->cap_linkup) {
+        int cap = b->cap_linkup ? b->cap_linkup * 2 : 64;
+        int    *t = realloc(b->linkup_ticks, cap * sizeof(int));
+        if (t) b->linkup_ticks = t;
+        double *m = realloc(b->linkup_ms, cap * sizeof(double));
+        if (m) b->linkup_ms = m;
+        if (!t || !m) return;
+        b->cap_linkup = cap;
+    }
+    b->linkup_ticks[b->n_linkup] = ticks;
+    b->linkup_ms[b->n_linkup]    = ns / 1e6;
+    b->n_linkup++;
+}
+
+void bench_free(BenchStats *b)
+{
+    free(b->linkup_ticks);
+    free(b->linkup_ms);
+    b->linkup_ticks = NULL;
+    b->linkup_ms    = NULL;
+}
+
+int bench_parse_rates(const char *s, int *rates, int max)
+{
+    int n = 0;
+    while (*s && n < max) {
+        char *end;
+        long r = strtol(s, &end, 10);
+        if (end == s || r <= 0)
+            return 0;
+        rates[n++] = (int)r;
+        if (*end == ',')
+            end++;
+        else if (*end)
+            return 0;
+        s = end;
+    }
+    return *s ? 0 : n;
+}
+
+int bench_cmp_int(const void *a, const void *b)
+{
+    return (*(const int *)a > *(const int *)b) - (*(const int *)a < *(const int *)b);
+}
+
+int bench_cmp_u64(const void *a, const void *b)
+{
+    return (*(const uint64_t *)a > *(const uint64_t *)b) -
+           (*(const uint64_t *)a < *(const uint64_t *)b);
+}
+
+int bench_cmp_double(const void *a, const void *b)
+{
+    return (*(const double *)a > *(const double *)b) - (*(const double *)a < *(const double *)b);
+}
+
+int bench_rank(int n, double p)
+{
+    int idx = (int)(p / 100.0 * n + 0.999999) - 1;
+    if (idx < 0) idx = 0;
+    if (idx >= n) idx = n - 1;
+    return idx;
+}
+
+static void write_dist(FILE *fp, const char *name, const double *v, int n,
+                       const char *num_fmt)
+{
+    fprintf(fp, "  \"%s\": ", name);
+    if (n == 0) {
+        fprintf(fp, "null");
+        return;
+    }
+    double sum = 0.0;
+    for (int i = 0; i < n; i++)
+        sum += v[i];
+
+    const char *keys[] = { "p50", "p90", "p99" };
+    const double ps[]  = { 50, 90, 99 };
+    fprintf(fp, "{ \"mean\": %.3f", sum / n);
+    for (int k = 0; k < 3; k++) {
+        fprintf(fp, ", \"%s\": ", keys[k]);
+        fprintf(fp, num_fmt, v[bench_rank(n, ps[k])]);
+    }
+    fprintf(fp, ", \"max\": ");
+    fprintf(fp, num_fmt, v[n - 1]);
+    fprintf(fp, " }");
+}
+
+void bench_write(FILE *fp, BenchStats *b, const BenchInfo *info)
+{
+    double wall_s = (bench_now_ns() - b->start_ns) / 1e9;
+    uint64_t steps = 0;
+    for (int p = 0; p < DONE; p++)
+        steps += b->phase_steps[p];
+    uint64_t samples = (b->phase_steps[CTLE] + b->phase_steps[RX]) * STEP_SIZE;
+
+    int n = b->n_linkup;
+    qsort(b->linkup_ticks, n, sizeof(int), bench_cmp_int);
+    qsort(b->linkup_ms, n, sizeof(double), bench_cmp_double);
+    double *ticks = malloc((n ? n : 1) * sizeof(double));
+    if (!ticks) return;
+    for (int i = 0; i < n; i++)
+        ticks[i] = b->linkup_ticks[i];
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"program\": \"%s\",\n", info->program);
+    fprintf(fp, "  \"channel\": \"%s\",\n", info->channel);
+    fprintf(fp, "  \"policy\": \"%s\",\n", info->policy);
+    fprintf(fp, "  \"lanes\": %d,\n", info->lanes);
+    fprintf(fp, "  \"rates\": \"%s\",\n", info->rates);
+    fprintf(fp, "  \"priority_mode\": \"%s\",\n", info->random_prio ? "RANDOM" : "EQUAL");
+    fprintf(fp, "  \"seed\": %u,\n", info->seed);
+    fprintf(fp, "  \"wall_s\": %.6f,\n", wall_s);
+    fprintf(fp, "  \"steps\": %llu,\n", (unsigned long long)steps);
+    fprintf(fp, "  \"samples\": %llu,\n", (unsigned long long)samples);
+    fprintf(fp, "  \"lanes_per_s\": %.3f,\n", wall_s > 0 ? n / wall_s : 0.0);
+    fprintf(fp, "  \"samples_per_s\": %.1f,\n", wall_s > 0 ? samples / wall_s : 0.0);
+
+    fprintf(fp, "  \"phases\": {");
+    for (int p = 0; p < DONE; p++)
+        fprintf(fp, "%s\n    \"%s\": { \"steps\": %llu, \"cpu_s\": %.6f, \"max_us\": %.1f }",
+                p ? "," : "", state_name((LaneState)p),
+                (unsigned long long)b->phase_steps[p], b->phase_ns[p] / 1e9,
+                b->phase_max_ns[p] / 1e3);
+    fprintf(fp, "\n  },\n");
+
+    write_dist(fp, "linkup_ticks", ticks, n, "%.0f");
+    fprintf(fp, ",\n");
+    write_dist(fp, "linkup_ms", b->linkup_ms, n, "%.3f");
+    fprintf(fp, "\n}\n");
+
+    free(ticks);
+}
@@ -0,0 +1,166 @@
+/*
+ * deadline.c
+ *
+ * Link-up deadline accounting and EDF-demand admission control for the
+ * generic scheduler.  Remaining work comes from each task's
+ * type->remaining() estimate, in scheduler steps (= ticks).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "deadline.h"
+
+DeadlineStats deadline_stats;
+
+typedef struct {
+    int lane;                       /* -1 for a lane not yet created      */
+    int work;                       /* estimated remaining steps          */
+    int deadline;                   /* absolute tick                      */
+    int slack;                      /* projected, filled by project()     */
+    int prev;                       /* slack before the request           */
+    int cand;                       /* 1 for the requesting lane          */
+} Demand;
+
+int deadline_parse_budget(const char *s, int *ticks)
+{
+    char *end;
+    long long v = strtoll(s, &end, 10);
+    if (end == s || v <= 0)
+        return -1;
+
+    if      (strcmp(end, "us") == 0) v = v / TICK_US;
+    else if (strcmp(end, "ms") == 0) v = v * 1000 / TICK_US;
+    else if (strcmp(end, "s")  == 0) v = v * 1000000 / TICK_US;
+    else if (*end)                   return -1;
+
+    /* leave headroom so now + budget cannot overflow */
+    if (v <= 0 || v > INT_MAX / 2)
+        return -1;
+    *ticks = (int)v;
+    return 0;
+}
+
+int deadline_parse_mode(const char *s, AdmitMode *mode)
+{
+    if      (strcmp(s, "off")    == 0) *mode = ADMIT_OFF;
+    else if (strcmp(s, "refuse") == 0) *mode = ADMIT_REFUSE;
+    else if (strcmp(s, "defer")  == 0) *mode = ADMIT_DEFER;
+    else return -1;
+    return 0;
+}
+
+void deadline_arm(Task *t, int now)
+{
+    t->deadline = now + t->budget;
+}
+
+void deadline_complete(Task *t, int now)
+{
+    int late = now + 1 - t->deadline;
+
+    deadline_stats.completed++;
+    if (late > 0) {
+        deadline_stats.missed++;
+        if (late > deadline_stats.max_lateness)
+            deadline_stats.max_lateness = late;
+    }
+}
+
+/* ── EDF demand projection ────────────────────────────────────────────
+ *  Runnable lanes in deadline order each finish after everything ahead
+ *  of them plus their own remaining work.
+ */
+static int cmp_demand(const void *a, const void *b)
+{
+    const Demand *x = a, *y = b;
+    if (x->deadline != y->deadline)
+        return (x->deadline > y->deadline) - (x->deadline < y->deadline);
+    return (x->lane > y->lane) - (x->lane < y->lane);
+}
+
+static void project(Demand *d, int n, int now)
+{
+    qsort(d, n, sizeof(Demand), cmp_demand);
+    long long finish = now;
+    for (int k = 0; k < n; k++) {
+        finish += d[k].work;
+        long long s = (long long)d[k].deadline - finish;
+        d[k].slack = s < INT_MIN ? INT_MIN : (int)s;
+    }
+}
+
+/* Runnable lanes except `skip`; room is left for one more entry. */
+static Demand *collect(Task_List *tl, int skip, int *n)
+{
+    Demand *d = malloc((tl->task_buffer_size + 1) * sizeof(Demand));
+    if (!d) return NULL;
+
+    *n = 0;
+    for (int i = 0; i < tl->task_buffer_size; i++) {
+        Task *t = &tl->task_buffer[i];
+        if (i == skip || !t->task_data || t->is_active != 1)
+            continue;
+        d[*n] = (Demand){ .lane = i, .deadline = t->deadline,
+                          .work = t->type->remaining(t->task_data) };
+        (*n)++;
+    }
+    return d;
+}
+
+int deadline_admit(Task_List *tl, int now, int lane, int work, int budget)
+{
+    int n;
+    Demand *d = collect(tl, lane, &n);
+    if (!d) return 0;
+
+    project(d, n, now);
+    for (int k = 0; k < n; k++)
+        d[k].prev = d[k].slack;
+
+    d[n++] = (Demand){ .lane = lane, .work = work,
+                       .deadline = now + budget, .cand = 1 };
+    project(d, n, now);
+
+    int ok = 1;
+    for (int k = 0; k < n && ok; k++) {
+        if (d[k].cand)
+            ok = d[k].slack >= 0;
+        else
+            ok = d[k].prev < 0 || d[k].slack >= 0;
+    }
+    free(d);
+
+    if (ok) deadline_stats.admitted++;
+    return ok;
+}
+
+void deadline_report(FILE *fp, Task_List *tl, int now)
+{
+    int n;
+    Demand *d = collect(tl, -1, &n);
+    if (!d) return;
+    project(d, n, now);
+
+    fprintf(fp, "Slack @ tick %d (runnable lanes in deadline order):\n", now);
+    fprintf(fp, "  lane  deadline  remaining    finish     slack\n");
+    for (int k = 0; k < n; k++) {
+        const char *flag = "";
+        if (d[k].slack < 0)
+            flag = now + 1 > d[k].deadline ? "  MISSED" : "  at risk";
+        fprintf(fp, "  %4d %9d %10d %9d %9d%s\n", d[k].lane, d[k].deadline,
+                d[k].work, d[k].deadline - d[k].slack, d[k].slack, flag);
+    }
+    free(d);
+    deadline_summary(fp);
+}
+
+void deadline_summary(FILE *fp)
+{
+    const DeadlineStats *s = &deadline_stats;
+    fprintf(fp, "Deadlines: completed=%d met=%d missed=%d max_late=%d ticks"
+                " | admission: admitted=%d refused=%d deferred=%d\n",
+            s->completed, s->completed - s->missed, s->missed, s->max_lateness,
+            s->admitted, s->refused, s->deferred);
+}
@@ -0,0 +1,67 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <stdio.h>
+
+#include "task.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Link-up deadlines and admission control
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Every lane has a link-up budget (ticks from becoming runnable to
+ *  DONE).  When it becomes runnable its absolute deadline is armed at
+ *  enqueue + budget; the edf policy schedules on that deadline.
+ *
+ *  Feasibility is judged with the uniprocessor EDF demand test: one
+ *  tick runs one step of one lane, so walking the runnable lanes in
+ *  deadline order and summing their estimated remaining steps gives
+ *  each lane's projected finish tick.  slack = deadline − finish; a
+ *  negative slack is a projected miss.  Under non-edf policies the
+ *  projection is the best case, not a guarantee.
+ *
+ *  A request (new lane, reset, rate change) is admitted when the
+ *  requesting lane itself is projected to meet its budget and no lane
+ *  that is currently projected to meet its budget would stop doing so.
+ */
+#define TICK_US             10      /* nominal firmware time slice        */
+
+typedef enum {
+    ADMIT_OFF = 0,                  /* accept everything (default)        */
+    ADMIT_REFUSE,                   /* reject infeasible requests         */
+    ADMIT_DEFER                     /* queue them until they fit          */
+} AdmitMode;
+
+typedef struct {
+    int completed;                  /* lanes that reached DONE            */
+    int missed;                     /* … after their deadline             */
+    int max_lateness;               /* worst overrun, ticks               */
+    int admitted;                   /* requests that passed the test      */
+    int refused;                    /* requests rejected                  */
+    int deferred;                   /* requests queued for a retry        */
+} DeadlineStats;
+
+extern DeadlineStats deadline_stats;
+
+/* Budget from "<n>" ticks or "<n>us" / "<n>ms" / "<n>s" of wall time
+ * (converted at TICK_US per tick).  Returns 0 on success. */
+int  deadline_parse_budget(const char *s, int *ticks);
+int  deadline_parse_mode  (const char *s, AdmitMode *mode);
+
+/* Arm t->deadline for a lane that becomes runnable at `now`. */
+void deadline_arm(Task *t, int now);
+
+/* Account a lane that reached DONE in the step run at tick `now`. */
+void deadline_complete(Task *t, int now);
+
+/* Admission test.  lane < 0 asks for a new lane, otherwise for lane to
+ * restart with `work` remaining steps.  Returns 1 if admissible. */
+int  deadline_admit(Task_List *tl, int now, int lane, int work, int budget);
+
+/* Per-lane slack table (runnable lanes in deadline order). */
+void deadline_report(FILE *fp, Task_List *tl, int now);
+
+/* One-line met / missed summary. */
+void deadline_summary(FILE *fp);
+
+#endif /* DEADLINE_H */
@@ -0,0 +1,99 @@
+/*
+ * event.c
+ *
+ * Event queue of the discrete-event core (see event.h): a binary
+ * min-heap on (tick, seq).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "event.h"
+
+static int ev_before(const Event *a, const Event *b)
+{
+    return a->tick != b->tick ? a->tick < b->tick : a->seq < b->seq;
+}
+
+static void ev_swap(Event *a, Event *b)
+{
+    Event t = *a;
+    *a = *b;
+    *b = t;
+}
+
+int evq_push(EventQueue *q, int tick, EventType type, TimerId timer,
+             const char *cmd)
+{
+    if (q->n == q->cap) {
+        int cap = q->cap ? q->cap * 2 : 64;
+        Event *buf = realloc(q->heap, cap * sizeof(Event));
+        if (!buf) return -1;
+        q->heap = buf;
+        q->cap  = cap;
+    }
+
+    int i = q->n++;
+    Event *e = &q->heap[i];
+    e->tick  = tick;
+    e->seq   = q->seq++;
+    e->type  = type;
+    e->timer = timer;
+    if (type == EV_TIMER)
+        q->timers++;
+    snprintf(e->cmd, sizeof(e->cmd), "%s", cmd ? cmd : "");
+
+    /* sift up */
+    while (i > 0 && ev_before(&q->heap[i], &q->heap[(i - 1) / 2])) {
+        ev_swap(&q->heap[i], &q->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    return 0;
+}
+
+int evq_load(EventQueue *q, const Script *s)
+{
+    for (int i = 0; i < s->n; i++) {
+        const char *cmd = s->cmds[i].cmd;
+        int pll = cmd[0] == 'p';          /* as in the command interpreter */
+        if (evq_push(q, s->cmds[i].tick, pll ? EV_PLL : EV_COMMAND,
+                     TIMER_DEFER_RETRY, pll ? NULL : cmd) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int evq_pop(EventQueue *q, int tick, Event *ev)
+{
+    if (q->n == 0 || q->heap[0].tick > tick)
+        return 0;
+
+    *ev = q->heap[0];
+    q->heap[0] = q->heap[--q->n];
+    if (ev->type == EV_TIMER)
+        q->timers--;
+
+    /* sift down */
+    int i = 0;
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < q->n && ev_before(&q->heap[l], &q->heap[m])) m = l;
+        if (r < q->n && ev_before(&q->heap[r], &q->heap[m])) m = r;
+        if (m == i) break;
+        ev_swap(&q->heap[i], &q->heap[m]);
+        i = m;
+    }
+    return 1;
+}
+
+int evq_next_tick(const EventQueue *q)
+{
+    return q->n ? q->heap[0].tick : -1;
+}
+
+void evq_free(EventQueue *q)
+{
+    free(q->heap);
+    memset(q, 0, sizeof(*q));
+}
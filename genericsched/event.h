@@ -0,0 +1,76 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include <stdint.h>
+
+#include "script.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Discrete-event core: event queue and virtual firmware clock
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Everything that happens at a given tick other than a lane step is an
+ *  event in one min-heap keyed on (tick, insertion order):
+ *
+ *    EV_COMMAND   operator command line (from a -S script)
+ *    EV_PLL       PLL on/off toggle
+ *    EV_TIMER     internal timer, e.g. the deferred-command retry
+ *
+ *  The loop drains the events due at each tick before it schedules.  When
+ *  no lane is runnable it jumps straight to the next event instead of
+ *  ticking through the gap; once only timers are left, nothing can make
+ *  a lane runnable again and the run ends.
+ *
+ *  Firmware time runs alongside the tick counter: a tick that runs a step
+ *  costs the step's modelled cycles (TaskType.cycles); an idle tick costs
+ *  FW_TICK_CYCLES.  At fw_mhz that gives the simulated time reported at
+ *  exit, independent of how fast the host ran the model.
+ */
+#define FW_CLOCK_MHZ    1000        /* default modelled firmware clock    */
+
+typedef enum {
+    EV_COMMAND,
+    EV_PLL,
+    EV_TIMER
+} EventType;
+
+typedef enum {
+    TIMER_DEFER_RETRY               /* retry commands held by admission   */
+} TimerId;
+
+typedef struct {
+    int       tick;
+    uint32_t  seq;                  /* FIFO among events at one tick      */
+    EventType type;
+    TimerId   timer;                /* EV_TIMER                           */
+    char      cmd[SCRIPT_CMD_MAX];  /* EV_COMMAND                         */
+} Event;
+
+typedef struct {
+    Event   *heap;
+    int      n, cap;
+    int      timers;                /* EV_TIMER entries among the n       */
+    uint32_t seq;
+} EventQueue;
+
+int  evq_push     (EventQueue *q, int tick, EventType type, TimerId timer,
+                   const char *cmd);      /* 0, or -1 if out of memory    */
+
+/* Queue every line of a loaded script ("p" becomes EV_PLL). */
+int  evq_load     (EventQueue *q, const Script *s);
+
+/* Pop the next event due at or before `tick` into *ev; 0 if none. */
+int  evq_pop      (EventQueue *q, int tick, Event *ev);
+
+/* Tick of the earliest pending event, or -1 if the queue is empty. */
+int  evq_next_tick(const EventQueue *q);
+
+/* Pending events other than timers. */
+static inline int evq_inputs(const EventQueue *q)
+{
+    return q->n - q->timers;
+}
+
+void evq_free     (EventQueue *q);
+
+#endif /* EVENT_H */
@@ -0,0 +1,141 @@
+/*
+ * init_memo.c
+ *
+ * Tap hashes and CDR result table behind lane_step_init() (see
+ * init_memo.h).
+ */
+
+#include <string.h>
+
+#include "chan_load.h"
+#include "init_memo.h"
+
+typedef struct {
+    const char *path;               /* NULL: none                         */
+    unsigned    version;
+    uint64_t    hash;
+} TapHash;
+
+typedef struct {
+    uint64_t    hash;
+    int         L, rate;            /* L 0: free                          */
+    int         sample_instant, lag;
+    const void *owner;              /* lane running the CDR; NULL: done   */
+} CdrResult;
+
+static int       enabled = 1;
+static TapHash   hashes[CHAN_LOAD_FILES];
+static CdrResult results[INIT_MEMO_RESULTS];
+static int       n_results, next_result;
+static unsigned  hash_hits, hash_misses, cdr_hits, cdr_misses;
+
+void init_memo_enable(int on)
+{
+    enabled = on;
+}
+
+static uint64_t fnv1a(const void *p, size_t n, uint64_t h)
+{
+    const unsigned char *b = p;
+    while (n--)
+        h = (h ^ *b++) * 0x100000001b3ull;
+    return h;
+}
+
+uint64_t init_memo_hash(const char *path, int entry, unsigned version,
+                        const double *taps, int L)
+{
+    TapHash *h = enabled && entry >= 0 && entry < CHAN_LOAD_FILES ? &hashes[entry] : NULL;
+    if (h && h->path && strcmp(h->path, path) == 0 && h->version == version) {
+        hash_hits++;
+        return h->hash;
+    }
+    hash_misses++;
+    uint64_t v = fnv1a(taps, L * sizeof(double), 0xcbf29ce484222325ull);
+    if (h) {
+        h->path    = path;
+        h->version = version;
+        h->hash    = v;
+    }
+    return v;
+}
+
+static CdrResult *cdr_find(uint64_t hash, int L, int rate)
+{
+    for (int i = 0; i < n_results; i++) {
+        CdrResult *r = &results[i];
+        if (r->hash == hash && r->L == L && r->rate == rate)
+            return r;
+    }
+    return NULL;
+}
+
+static CdrResult *cdr_add(uint64_t hash, int L, int rate)
+{
+    CdrResult *r = &results[next_result];
+    *r = (CdrResult){ hash, L, rate, 0, 0, NULL };
+    if (n_results < INIT_MEMO_RESULTS)
+        n_results++;
+    next_result = (next_result + 1) % INIT_MEMO_RESULTS;
+    return r;
+}
+
+int init_memo_cdr_get(uint64_t hash, int L, int rate, const void *owner,
+                      int *sample_instant, int *lag)
+{
+    if (!enabled)
+        return INIT_MEMO_MISS;
+    CdrResult *r = cdr_find(hash, L, rate);
+    if (r && r->owner && r->owner != owner)
+        return INIT_MEMO_WAIT;
+    if (r && !r->owner) {
+        cdr_hits++;
+        *sample_instant = r->sample_instant;
+        *lag            = r->lag;
+        return INIT_MEMO_HIT;
+    }
+    cdr_misses++;
+    if (!r)
+        r = cdr_add(hash, L, rate);
+    r->owner = owner;
+    return INIT_MEMO_MISS;
+}
+
+void init_memo_cdr_put(uint64_t hash, int L, int rate, const void *owner,
+                       int sample_instant, int lag)
+{
+    if (!enabled)
+        return;
+    CdrResult *r = NULL;
+    for (int i = 0; i < n_results && !r; i++)
+        if (results[i].owner == owner)
+            r = &results[i];
+    if (!r)
+        r = cdr_add(hash, L, rate);
+    r->sample_instant = sample_instant;
+    r->lag            = lag;
+    r->owner          = NULL;
+}
+
+void init_memo_cdr_drop(const void *owner)
+{
+    for (int i = 0; i < n_results; i++)
+        if (results[i].owner == owner)
+            results[i] = (CdrResult){ 0 };
+}
+
+void init_memo_report(FILE *fp)
+{
+    if (!enabled) {
+        fprintf(fp, "INIT memo: off\n");
+        return;
+    }
+    fprintf(fp, "INIT memo: tap hashes reused=%u computed=%u | CDR hit=%u miss=%u\n",
+            hash_hits, hash_misses, cdr_hits, cdr_misses);
+}
+
+void init_memo_free(void)
+{
+    memset(hashes, 0, sizeof(hashes));
+    n_results = next_result = 0;
+}
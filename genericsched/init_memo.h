@@ -0,0 +1,64 @@
+#ifndef INIT_MEMO_H
+#define INIT_MEMO_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Memoised INIT
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Most of INIT depends only on the channel and the data rate, not on
+ *  the lane: the CDR sub-phases drive a fixed clock pattern through the
+ *  channel (LEN_CDR·OSF·L MACs, about a thousand scheduler steps).  The
+ *  tap file itself is cached by the loader (chan_load.h).  Lanes that share a channel and rate
+ *  therefore get the same sample_instant and lag.  Only the PRBS is per
+ *  lane, and it stays per lane.
+ *
+ *  Two tables:
+ *
+ *    tap hashes  chan_load entry → 64-bit FNV-1a hash of its taps, kept
+ *                while the entry holds the same path and version, so
+ *                each new set of taps is hashed once.
+ *    CDR results (hash, L, rate) → sample_instant, lag.  Keyed by
+ *                content, so two files with identical taps share
+ *                results.  The model's CDR does not use the rate, but a
+ *                real one locks to it, so it stays part of the key.
+ *
+ *  Both are small fixed arrays; when the results are full the oldest
+ *  entry is replaced (an in-flight one too: its waiters then miss).  A hit produces exactly the values the computation would,
+ *  so runs are bit-identical with the memo on or off (--no-memo).
+ */
+#define INIT_MEMO_RESULTS   64
+
+void init_memo_enable(int on);
+
+/* Hash of `taps`: version `version` of `path` in chan_load entry
+ * `entry` (path must outlive the memo, as for chan_load_request). */
+uint64_t init_memo_hash(const char *path, int entry, unsigned version,
+                        const double *taps, int L);
+
+/* CDR results for channel (hash, L) at `rate`, asked for by lane
+ * `owner`:
+ *
+ *   INIT_MEMO_HIT    the values are in *sample_instant, *lag;
+ *   INIT_MEMO_MISS   the caller runs the CDR and put()s the results; the
+ *                    key is marked in flight for it (with the memo on);
+ *   INIT_MEMO_WAIT   another lane is running the CDR for this key: ask
+ *                    again next step rather than run it as well.
+ *
+ * Lanes that start together so run the CDR once between them.  A lane
+ * that is reset or destroyed while running it calls drop(), and the
+ * next lane to ask takes the key over. */
+enum { INIT_MEMO_WAIT = -1, INIT_MEMO_MISS, INIT_MEMO_HIT };
+
+int  init_memo_cdr_get (uint64_t hash, int L, int rate, const void *owner,
+                        int *sample_instant, int *lag);
+void init_memo_cdr_put (uint64_t hash, int L, int rate, const void *owner,
+                        int sample_instant, int lag);
+void init_memo_cdr_drop(const void *owner);
+
+void init_memo_report(FILE *fp);
+void init_memo_free(void);
+
+#endif /* INIT_MEMO_H */
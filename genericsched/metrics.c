@@ -0,0 +1,328 @@
+/*
+ * metrics.c
+ *
+ * Per-lane runtime metrics: storage, the 'm' table and the Prometheus
+ * text exposition file and its writer thread (see metrics.h).
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "metrics.h"
+
+static LaneMetrics *lanes    = NULL;
+static int          capacity = 0;
+static uint64_t     last_export_ns = 0;
+
+/* A live lane as the writer sees it */
+typedef struct {
+    int             lane;
+    int             phase;
+    const TaskType *type;
+    LaneMetrics     m;
+} SnapLane;
+
+typedef struct {
+    SnapLane *v;
+    int       n, cap;
+} Snapshot;
+
+/* snap[0] is filled by the scheduler, snap[1] written out by the writer;
+ * they swap under snap_lock */
+static Snapshot        snap[2];
+static int             snap_fresh, writer_stop, writer_running, write_failed;
+static const char     *prom_path;
+static pthread_t       writer;
+static pthread_mutex_t snap_lock  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  snap_ready = PTHREAD_COND_INITIALIZER;
+
+LaneMetrics *metrics_lane(int lane)
+{
+    if (lane < 0)
+        return NULL;
+    if (lane >= capacity) {
+        int cap = capacity ? capacity : 16;
+        while (cap <= lane) cap *= 2;
+        LaneMetrics *buf = realloc(lanes, cap * sizeof(LaneMetrics));
+        if (!buf) return NULL;
+        memset(buf + capacity, 0, (cap - capacity) * sizeof(LaneMetrics));
+        lanes    = buf;
+        capacity = cap;
+    }
+    return &lanes[lane];
+}
+
+LaneMetrics *metrics_clear(int lane)
+{
+    LaneMetrics *m = metrics_lane(lane);
+    if (!m) return NULL;
+    memset(m, 0, sizeof(*m));
+    m->final_mse = NAN;
+    return m;
+}
+
+uint64_t metrics_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_quantum(LaneMetrics *m, uint64_t cpu_ns)
+{
+    uint64_t wall = 0;
+    for (int p = 0; p < TASK_MAX_PHASES; p++)
+        wall += m->quantum_ns[p];
+    for (int p = 0; p < TASK_MAX_PHASES; p++) {
+        if (m->quantum_ns[p])
+            m->phase_ns[p] += wall ? (uint64_t)((double)cpu_ns * m->quantum_ns[p] / wall) : 0;
+        m->quantum_ns[p] = 0;
+    }
+}
+
+void metrics_ready(LaneMetrics *m, int tick, uint64_t now_ns)
+{
+    m->ready_tick = tick;
+    m->ready_ns   = now_ns;
+}
+
+void metrics_dispatch(LaneMetrics *m, int tick, uint64_t now_ns)
+{
+    if (tick > m->ready_tick)
+        m->wait_ticks += (uint64_t)(tick - m->ready_tick);
+
+    uint64_t ns = now_ns > m->ready_ns ? now_ns - m->ready_ns : 0;
+    m->wait_ns += ns;
+
+    int b = 0;
+    for (uint64_t bound = 1000; b < METRICS_BUCKETS - 1 && ns > bound; bound *= 4)
+        b++;
+    m->lat_bucket[b]++;
+    m->lat_count++;
+    if (ns > m->lat_max_ns)
+        m->lat_max_ns = ns;
+}
+
+/* CPU time per phase goes last, named by each task's kind */
+void metrics_print(FILE *fp, Task_List *tl)
+{
+    fprintf(fp, "lane phase    steps  wait_ticks  lat_avg_us  lat_max_us resets rates"
+                "  final_mse  cpu_ms by phase\n");
+    for (int i = 0; i < tl->task_buffer_size && i < capacity; i++) {
+        Task *t = &tl->task_buffer[i];
+        if (!t->task_data) continue;
+        const LaneMetrics *m = &lanes[i];
+        fprintf(fp, "%4d %-5s %8llu %11llu %11.1f %11.1f %6u %5u  %9.3e ",
+                i, t->type->phase_name(t->type->phase(t->task_data)),
+                (unsigned long long)m->steps, (unsigned long long)m->wait_ticks,
+                m->lat_count ? m->wait_ns / 1e3 / m->lat_count : 0.0,
+                m->lat_max_ns / 1e3, m->resets, m->rate_changes, m->final_mse);
+        for (int p = 0; p < t->type->n_phases; p++)
+            fprintf(fp, " %s=%.2f", t->type->phase_name(p), m->phase_ns[p] / 1e6);
+        fprintf(fp, "\n");
+    }
+}
+
+/* ── Prometheus text format ───────────────────────────────────────────
+ *  One metric family at a time: HELP, TYPE, then a sample per lane.
+ */
+static void family(FILE *fp, const char *name, const char *type, const char *help)
+{
+    fprintf(fp, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void sample(FILE *fp, const char *name, int lane, double v)
+{
+    if (v != v)
+        fprintf(fp, "%s{lane=\"%d\"} NaN\n", name, lane);
+    else
+        fprintf(fp, "%s{lane=\"%d\"} %.17g\n", name, lane, v);
+}
+
+static double m_steps (const LaneMetrics *m) { return (double)m->steps; }
+static double m_waitt (const LaneMetrics *m) { return (double)m->wait_ticks; }
+static double m_waits (const LaneMetrics *m) { return m->wait_ns / 1e9; }
+static double m_resets(const LaneMetrics *m) { return m->resets; }
+static double m_rates (const LaneMetrics *m) { return m->rate_changes; }
+static double m_links (const LaneMetrics *m) { return m->linkups; }
+static double m_mse   (const LaneMetrics *m) { return m->final_mse; }
+
+static const struct {
+    const char *name, *type, *help;
+    double (*value)(const LaneMetrics *m);
+} simple[] = {
+    { "sched_lane_steps_total", "counter",
+      "Scheduler steps executed.", m_steps },
+    { "sched_lane_runnable_wait_ticks_total", "counter",
+      "Ticks the lane was runnable but not scheduled.", m_waitt },
+    { "sched_lane_runnable_wait_seconds_total", "counter",
+      "Wall time the lane was runnable but not scheduled.", m_waits },
+    { "sched_lane_resets_total", "counter",
+      "Soft resets.", m_resets },
+    { "sched_lane_rate_changes_total", "counter",
+      "Data-rate changes.", m_rates },
+    { "sched_lane_linkups_total", "counter",
+      "Trainings that finished.", m_links },
+    { "sched_lane_final_mse", "gauge",
+      "Figure of merit at the end of the last training (lanes: RX equaliser MSE; NaN before).", m_mse },
+};
+
+static void write_prom(FILE *fp, const Snapshot *s)
+{
+    const LaneMetrics *m;
+
+    family(fp, "sched_lane_phase", "gauge",
+           "Phase index of the task's kind (lanes: 0=INIT 1=CTLE 2=RX 3=DONE 4=ERROR).");
+    for (int k = 0; k < s->n; k++)
+        sample(fp, "sched_lane_phase", s->v[k].lane, s->v[k].phase);
+
+    for (size_t f = 0; f < sizeof(simple) / sizeof(simple[0]); f++) {
+        family(fp, simple[f].name, simple[f].type, simple[f].help);
+        for (int k = 0; k < s->n; k++)
+            sample(fp, simple[f].name, s->v[k].lane, simple[f].value(&s->v[k].m));
+    }
+
+    family(fp, "sched_lane_cpu_seconds_total", "counter",
+           "CPU time spent in the lane's steps, by training phase.");
+    for (int k = 0; k < s->n; k++) {
+        int i = s->v[k].lane;
+        m = &s->v[k].m;
+        for (int p = 0; p < s->v[k].type->n_phases; p++)
+            fprintf(fp, "sched_lane_cpu_seconds_total{lane=\"%d\",phase=\"%s\"} %.9f\n",
+                    i, s->v[k].type->phase_name(p), m->phase_ns[p] / 1e9);
+    }
+
+    family(fp, "sched_lane_sched_latency_seconds", "histogram",
+           "Wall time from becoming runnable to being dispatched.");
+    for (int k = 0; k < s->n; k++) {
+        int i = s->v[k].lane;
+        m = &s->v[k].m;
+        uint64_t cum = 0;
+        double bound = 1e-6;
+        for (int b = 0; b < METRICS_BUCKETS - 1; b++, bound *= 4) {
+            cum += m->lat_bucket[b];
+            fprintf(fp, "sched_lane_sched_latency_seconds_bucket{lane=\"%d\",le=\"%g\"} %llu\n",
+                    i, bound, (unsigned long long)cum);
+        }
+        fprintf(fp, "sched_lane_sched_latency_seconds_bucket{lane=\"%d\",le=\"+Inf\"} %llu\n",
+                i, (unsigned long long)m->lat_count);
+        fprintf(fp, "sched_lane_sched_latency_seconds_sum{lane=\"%d\"} %.9f\n", i,
+                m->wait_ns / 1e9);
+        fprintf(fp, "sched_lane_sched_latency_seconds_count{lane=\"%d\"} %llu\n", i,
+                (unsigned long long)m->lat_count);
+    }
+}
+
+static int write_file(const Snapshot *s)
+{
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", prom_path);
+    FILE *fp = fopen(tmp, "w");
+    if (!fp)
+        return -1;
+
+    write_prom(fp, s);
+    if (fclose(fp) != 0 || rename(tmp, prom_path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&snap_lock);
+    for (;;) {
+        while (!snap_fresh && !writer_stop)
+            pthread_cond_wait(&snap_ready, &snap_lock);
+        if (!snap_fresh)
+            break;
+        Snapshot t = snap[0];
+        snap[0] = snap[1];
+        snap[1] = t;
+        snap_fresh = 0;
+        pthread_mutex_unlock(&snap_lock);
+
+        int rc = write_file(&snap[1]);
+
+        pthread_mutex_lock(&snap_lock);
+        write_failed = rc != 0;
+    }
+    pthread_mutex_unlock(&snap_lock);
+    return NULL;
+}
+
+int metrics_start(const char *path)
+{
+    prom_path   = path;
+    writer_stop = 0;
+    if (pthread_create(&writer, NULL, writer_main, NULL) != 0) {
+        perror("pthread_create(metrics)");
+        return -1;
+    }
+    writer_running = 1;
+    return 0;
+}
+
+/* Copy the live lanes into snap[0]; called with snap_lock held */
+static void take_snapshot(Task_List *tl)
+{
+    Snapshot *s = &snap[0];
+    if (s->cap < tl->task_buffer_size) {
+        SnapLane *v = realloc(s->v, tl->task_buffer_size * sizeof(SnapLane));
+        if (!v)
+            return;                 /* the writer keeps the previous one  */
+        s->v   = v;
+        s->cap = tl->task_buffer_size;
+    }
+    s->n = 0;
+    for (int i = 0; i < tl->task_buffer_size && i < capacity; i++) {
+        Task *t = &tl->task_buffer[i];
+        if (!t->task_data) continue;
+        s->v[s->n++] = (SnapLane){ .lane = i, .phase = t->type->phase(t->task_data),
+                                   .type = t->type, .m = lanes[i] };
+    }
+    snap_fresh = 1;
+    pthread_cond_signal(&snap_ready);
+}
+
+void metrics_export(Task_List *tl, uint64_t now_ns)
+{
+    if (!writer_running ||
+        now_ns - last_export_ns < (uint64_t)METRICS_PERIOD_MS * 1000000)
+        return;
+    last_export_ns = now_ns;
+
+    pthread_mutex_lock(&snap_lock);
+    take_snapshot(tl);
+    pthread_mutex_unlock(&snap_lock);
+}
+
+int metrics_stop(Task_List *tl)
+{
+    if (!writer_running)
+        return 0;
+    pthread_mutex_lock(&snap_lock);
+    take_snapshot(tl);
+    writer_stop = 1;
+    pthread_cond_signal(&snap_ready);
+    pthread_mutex_unlock(&snap_lock);
+    pthread_join(writer, NULL);
+    writer_running = 0;
+    return write_failed ? -1 : 0;
+}
+
+void metrics_free(void)
+{
+    free(lanes);
+    lanes    = NULL;
+    capacity = 0;
+    for (int k = 0; k < 2; k++) {
+        free(snap[k].v);
+        snap[k] = (Snapshot){ 0 };
+    }
+}
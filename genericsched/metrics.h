@@ -0,0 +1,118 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "task.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Per-lane runtime metrics
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Always on: the scheduler loop already times every step, so a step
+ *  costs two adds and a dispatch one histogram increment.  The records
+ *  live in their own array indexed by lane ID rather than in Task, so
+ *  the policies' scans over the task list stay compact.
+ *
+ *  CPU time is the scheduler thread's CPU clock, read once per quantum
+ *  (a read costs several times a wall-clock one) and split between the
+ *  phases the quantum ran in proportion to their steps' wall time; a
+ *  quantum rarely spans two.  Time the thread spent preempted is not
+ *  counted, unlike in the wall-time step costs --bench reports.
+ *
+ *  A lane is "ready" from the tick it becomes runnable (added, reset,
+ *  end of its previous quantum) until its next dispatch.  That gap is
+ *  its runnable wait, counted in ticks and in wall time; the wall time
+ *  of each gap also goes into the scheduling-latency histogram.
+ *
+ *  Exposition:
+ *    'm' command           table on stdout
+ *    -M <file.prom>        Prometheus text format, rewritten every
+ *                          METRICS_PERIOD_MS and at exit; written to
+ *                          <file>.tmp and rename()d over <file> so a
+ *                          scraper never sees a partial file
+ *
+ *  The file is written by a thread of its own: the scheduler only copies
+ *  the live lanes' records into a snapshot when a write is due, so it
+ *  never waits for the disk (as with sched.log, see lane_log.h).
+ */
+#define METRICS_PERIOD_MS   1000
+#define METRICS_BUCKETS     12      /* 1 us · 4^k, k = 0..10, then +Inf  */
+
+typedef struct {
+    uint64_t steps;
+    uint64_t phase_ns[TASK_MAX_PHASES];     /* CPU time of steps, by phase */
+    uint64_t quantum_ns[TASK_MAX_PHASES];   /* wall time of this quantum's */
+                                            /* steps                       */
+    uint64_t wait_ticks;            /* runnable but not scheduled         */
+    uint64_t wait_ns;
+    uint64_t lat_bucket[METRICS_BUCKETS];   /* non-cumulative counts      */
+    uint64_t lat_count;
+    uint64_t lat_max_ns;
+    uint32_t resets;
+    uint32_t rate_changes;
+    uint32_t linkups;
+    int      ready_tick;            /* first tick the lane could run      */
+    uint64_t ready_ns;
+    double   final_mse;             /* at the last finish (the kind's     */
+                                    /* quality()); NAN before             */
+} LaneMetrics;
+
+/* Record of `lane`, growing the array as needed (NULL if out of memory;
+ * never for a lane metrics_clear() succeeded on).  The pointer is valid
+ * until the next call with a larger lane ID. */
+LaneMetrics *metrics_lane(int lane);
+
+/* Fresh record for a newly added lane; NULL if out of memory. */
+LaneMetrics *metrics_clear(int lane);
+
+/* Lane became runnable (added or reset) at `tick`. */
+void metrics_ready(LaneMetrics *m, int tick, uint64_t now_ns);
+
+/* Lane dispatched at `tick`: account the runnable wait. */
+void metrics_dispatch(LaneMetrics *m, int tick, uint64_t now_ns);
+
+static inline void metrics_step(LaneMetrics *m, int phase, uint64_t ns)
+{
+    m->steps++;
+    if (phase >= 0 && phase < TASK_MAX_PHASES)
+        m->quantum_ns[phase] += ns;
+}
+
+/* The calling thread's CPU clock, ns */
+uint64_t metrics_cpu_ns(void);
+
+/* Quantum over: it took `cpu_ns` of CPU time (metrics_cpu_ns() deltas). */
+void metrics_quantum(LaneMetrics *m, uint64_t cpu_ns);
+
+/* Quantum ended after the step at `tick`; still runnable. */
+static inline void metrics_yield(LaneMetrics *m, int tick, uint64_t now_ns)
+{
+    m->ready_tick = tick + 1;
+    m->ready_ns   = now_ns;
+}
+
+static inline void metrics_done(LaneMetrics *m, double mse)
+{
+    m->linkups++;
+    m->final_mse = mse;
+}
+
+/* 'm' command: one row per lane. */
+void metrics_print(FILE *fp, Task_List *tl);
+
+/* Start the -M writer thread for `path`.  Returns 0, or -1. */
+int  metrics_start(const char *path);
+
+/* Hand the writer a snapshot if METRICS_PERIOD_MS has passed since the
+ * last one.  No-op unless started. */
+void metrics_export(Task_List *tl, uint64_t now_ns);
+
+/* Final snapshot, written before the writer is joined.  Returns 0, or
+ * -1 if the last write failed. */
+int  metrics_stop(Task_List *tl);
+
+void metrics_free(void);
+
+#endif /* METRICS_H */
@@ -0,0 +1,265 @@
+/*
+ * port.c
+ *
+ * Multi-lane ports: layout, gang scheduling and port-level link-up
+ * statistics (see port.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "port.h"
+
+PortTable ports = { .cur = -1 };
+
+/* one entry per port bring-up */
+static int      *up_ticks = NULL;
+static int      *up_skew  = NULL;
+static uint64_t *up_fw    = NULL;
+static int       up_count = 0;
+static int       up_cap   = 0;
+
+static int port_add(int first, int width)
+{
+    if (ports.n == PORT_MAX || width < 1)
+        return -1;
+    Port *p = &ports.port[ports.n++];
+    memset(p, 0, sizeof(*p));
+    p->first      = first;
+    p->width      = width;
+    p->down_tick  = 0;
+    p->first_done = -1;
+    return 0;
+}
+
+int port_parse(const char *spec, int num_lanes, int gang)
+{
+    int widths[PORT_MAX], n = 0;
+    const char *s = spec;
+
+    while (*s) {
+        if (*s == 'x' || *s == 'X') s++;
+        char *end;
+        long w = strtol(s, &end, 10);
+        if (end == s || w < 1 || w > 64 || n == PORT_MAX)
+            return -1;
+        widths[n++] = (int)w;
+        s = end;
+        if (*s == ',') s++;
+        else if (*s) return -1;
+    }
+    if (n == 0)
+        return -1;
+
+    ports.n = 0;
+    int lane = 0;
+    if (n == 1) {
+        /* one width: as many full ports as the start-up lanes hold */
+        for (; lane + widths[0] <= num_lanes && ports.n < PORT_MAX; lane += widths[0])
+            port_add(lane, widths[0]);
+    } else {
+        for (int i = 0; i < n; lane += widths[i++])
+            port_add(lane, widths[i]);
+    }
+    ports.gang = gang;
+    ports.cur  = -1;
+    return 0;
+}
+
+int port_of(int lane)
+{
+    for (int i = 0; i < ports.n; i++)
+        if (lane >= ports.port[i].first && lane < ports.port[i].first + ports.port[i].width)
+            return i;
+    return -1;
+}
+
+/* ── Gang scheduling ──────────────────────────────────────────────────
+ *  lagging(): runnable member with the most training left, lowest lane
+ *  on a tie.
+ */
+static int lagging(Task_List *tl, const Port *p, int *runnable)
+{
+    int chosen = -1, most = -1;
+    *runnable = 0;
+    for (int i = p->first; i < p->first + p->width && i < tl->task_buffer_size; i++) {
+        const Task *t = &tl->task_buffer[i];
+        if (!t->task_data || t->is_active != 1)
+            continue;
+        (*runnable)++;
+        int left = t->type->remaining(t->task_data);
+        if (left > most) {
+            most   = left;
+            chosen = i;
+        }
+    }
+    return chosen;
+}
+
+int port_continue(Task_List *tl)
+{
+    if (!ports.gang || ports.cur < 0)
+        return -1;
+    int n, lane = -1;
+    if (ports.left > 0)
+        lane = lagging(tl, &ports.port[ports.cur], &n);
+    if (lane < 0) {
+        ports.cur = -1;
+        return -1;
+    }
+    ports.left--;
+    return lane;
+}
+
+int port_enter(Task_List *tl, int lane)
+{
+    int p = lane >= 0 && ports.gang ? port_of(lane) : -1;
+    if (p < 0)
+        return lane;
+
+    int n, member = lagging(tl, &ports.port[p], &n);
+    if (member < 0)
+        return lane;
+    ports.cur  = p;
+    ports.left = n - 1;
+    return member;
+}
+
+/* ── Link-up accounting ───────────────────────────────────────────────*/
+void port_enqueue(int lane, int now, uint64_t fw)
+{
+    int i = port_of(lane);
+    if (i < 0) return;
+    Port *p = &ports.port[i];
+    if (p->up) {
+        p->up         = 0;
+        p->down_tick  = now;
+        p->down_fw    = fw;
+        p->first_done = -1;
+    }
+}
+
+static void record(int ticks, int skew, uint64_t fw)
+{
+    if (up_count == up_cap) {
+        int cap = up_cap ? up_cap * 2 : 16;
+        int *t = realloc(up_ticks, cap * sizeof(int));
+        if (!t) return;
+        up_ticks = t;
+        int *s = realloc(up_skew, cap * sizeof(int));
+        if (!s) return;
+        up_skew = s;
+        uint64_t *f = realloc(up_fw, cap * sizeof(uint64_t));
+        if (!f) return;
+        up_fw  = f;
+        up_cap = cap;
+    }
+    up_ticks[up_count] = ticks;
+    up_skew[up_count]  = skew;
+    up_fw[up_count++]  = fw;
+}
+
+/* Off the run queue because its step failed (phase n_phases + 1), not
+ * because it finished */
+static int member_failed(const Task *t)
+{
+    return t->type->phase(t->task_data) == t->type->n_phases + 1;
+}
+
+/* Port comes up once no present member is still training or failed. */
+static void settle(Task_List *tl, Port *p, int now, uint64_t fw)
+{
+    int present = 0;
+    for (int i = p->first; i < p->first + p->width && i < tl->task_buffer_size; i++) {
+        const Task *t = &tl->task_buffer[i];
+        if (!t->task_data) continue;
+        if (t->is_active || member_failed(t)) return;
+        present++;
+    }
+    if (p->up || present == 0)
+        return;
+
+    p->up = 1;
+    p->linkups++;
+    p->last_ticks = now - p->down_tick + 1;
+    int skew = p->first_done >= 0 ? now - p->first_done : 0;
+    record(p->last_ticks, skew, fw - p->down_fw);
+}
+
+void port_complete(Task_List *tl, int lane, int now, uint64_t fw)
+{
+    int i = port_of(lane);
+    if (i < 0) return;
+    Port *p = &ports.port[i];
+    if (p->first_done < 0)
+        p->first_done = now;
+    settle(tl, p, now, fw);
+}
+
+void port_removed(Task_List *tl, int lane, int now, uint64_t fw)
+{
+    int i = port_of(lane);
+    if (i >= 0)
+        settle(tl, &ports.port[i], now, fw);
+}
+
+/* ── Reports ──────────────────────────────────────────────────────────*/
+void port_print(FILE *fp, Task_List *tl)
+{
+    if (ports.n == 0) {
+        fprintf(fp, "No ports defined (-g/-G)\n");
+        return;
+    }
+    fprintf(fp, "port lanes  width state  trained  linkups  last_ticks\n");
+    for (int i = 0; i < ports.n; i++) {
+        const Port *p = &ports.port[i];
+        int present = 0, trained = 0;
+        for (int l = p->first; l < p->first + p->width && l < tl->task_buffer_size; l++) {
+            const Task *t = &tl->task_buffer[l];
+            if (!t->task_data) continue;
+            present++;
+            if (!t->is_active && !member_failed(t)) trained++;
+        }
+        fprintf(fp, "%4d %2d-%-3d    x%-2d %-5s  %3d/%-3d %8d  %10d\n",
+                i, p->first, p->first + p->width - 1, p->width,
+                p->up ? "UP" : "DOWN", trained, present, p->linkups, p->last_ticks);
+    }
+}
+
+void port_report(FILE *fp, unsigned fw_mhz)
+{
+    if (ports.n == 0)
+        return;
+    fprintf(fp, "Ports [%s, %d]: ", ports.gang ? "gang" : "independent", ports.n);
+    int n = up_count;
+    if (n == 0) {
+        fprintf(fp, "no port came up\n");
+        return;
+    }
+
+    qsort(up_ticks, n, sizeof(int), bench_cmp_int);
+    qsort(up_skew,  n, sizeof(int), bench_cmp_int);
+    qsort(up_fw,    n, sizeof(uint64_t), bench_cmp_u64);
+    double sum = 0.0, skew = 0.0, fw = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum  += up_ticks[i];
+        skew += up_skew[i];
+        fw   += up_fw[i];
+    }
+    double ms = fw_mhz * 1e3;
+    fprintf(fp, "linkups=%d mean=%.1f p50=%d p90=%d max=%d ticks"
+                " | firmware mean=%.3f max=%.3f ms | skew mean=%.1f max=%d ticks\n",
+            n, sum / n, up_ticks[bench_rank(n, 50)], up_ticks[bench_rank(n, 90)], up_ticks[n - 1],
+            fw / n / ms, up_fw[n - 1] / ms, skew / n, up_skew[n - 1]);
+}
+
+void port_free(void)
+{
+    free(up_ticks);
+    free(up_skew);
+    free(up_fw);
+    up_ticks = up_skew = NULL;
+    up_fw    = NULL;
+    up_count = up_cap = 0;
+}
@@ -0,0 +1,84 @@
+#ifndef PORT_H
+#define PORT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "task.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Multi-lane ports and gang scheduling
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  A port bundles consecutive lanes (x4, x8, …) and is only up when every
+ *  member lane has trained.  -g defines the ports for reporting only;
+ *  -G also gang-schedules them:
+ *
+ *    - when the policy picks a member of a port, the port holds the CPU
+ *      for one round: as many consecutive decisions as it has runnable
+ *      members, so its lanes train together instead of interleaved with
+ *      other ports;
+ *    - every decision of the round goes to the member with the most
+ *      training left (TaskType.remaining), so a lagging lane catches up
+ *      instead of holding the whole port back.
+ *
+ *  The policy still decides which port runs and is charged for the steps
+ *  of whichever member actually ran.
+ *
+ *  A port goes down when a member becomes runnable (added, reset, rate
+ *  change) while it was up, and comes up when the last present member
+ *  reaches DONE or is removed, unless one has failed (a lane in ERROR
+ *  keeps it down until it is reset and trains, or is removed).  Its link-up time runs from going down to
+ *  coming up; the skew is the gap between the first and the last member
+ *  finishing in that bring-up.
+ *
+ *  Spec: "4" or "x4" repeats x4 ports over the start-up lanes; "4,4,8"
+ *  lays out the listed widths from lane 0.  Lanes beyond the last port
+ *  are scheduled on their own.
+ */
+#define PORT_MAX    64
+
+typedef struct {
+    int      first, width;          /* lanes first .. first + width − 1   */
+    int      up;
+    int      down_tick;             /* tick it last went down             */
+    uint64_t down_fw;               /* … and the firmware clock           */
+    int      first_done;            /* first member DONE since; −1 if none */
+    int      linkups;
+    int      last_ticks;            /* link-up time of the last bring-up  */
+} Port;
+
+typedef struct {
+    Port     port[PORT_MAX];
+    int      n;
+    int      gang;                  /* -G                                 */
+    int      cur;                   /* port holding the CPU, −1 if none   */
+    int      left;                  /* decisions left in its round        */
+} PortTable;
+
+extern PortTable ports;
+
+/* Lay out ports from `spec` over `num_lanes` start-up lanes.
+ * Returns 0 on success, -1 on a malformed spec. */
+int  port_parse(const char *spec, int num_lanes, int gang);
+
+int  port_of(int lane);                 /* −1 if the lane is in no port   */
+
+/* Gang scheduling: next member of the port holding the CPU, or −1 when
+ * its round is over and the policy should pick. */
+int  port_continue(Task_List *tl);
+
+/* Policy picked `lane`: start its port's round, returning the member to
+ * run (the lane itself without gang scheduling or outside any port). */
+int  port_enter(Task_List *tl, int lane);
+
+/* Lane became runnable / reached DONE / was removed. */
+void port_enqueue (int lane, int now, uint64_t fw);
+void port_complete(Task_List *tl, int lane, int now, uint64_t fw);
+void port_removed (Task_List *tl, int lane, int now, uint64_t fw);
+
+void port_print (FILE *fp, Task_List *tl);  /* 'g' command               */
+void port_report(FILE *fp, unsigned fw_mhz);    /* summary at exit       */
+void port_free  (void);
+
+#endif /* PORT_H */
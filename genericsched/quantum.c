@@ -0,0 +1,76 @@
+/*
+ * quantum.c
+ *
+ * Steps per scheduling decision, from each lane's measured step cost and
+ * recent command activity (see quantum.h).
+ */
+
+#include "quantum.h"
+
+Quantum quantum;
+
+void quantum_init(int fixed)
+{
+    quantum.fixed   = fixed > 0 ? fixed : 0;
+    quantum.ceiling = QUANTUM_MAX;
+}
+
+int quantum_next(const Task *t, int pending)
+{
+    if (quantum.fixed)
+        return quantum.fixed;
+    if (pending)
+        return 1;           /* back to the command poll straight away */
+
+    int q = 1;
+    if (t->step_ns) {
+        uint64_t fit = (uint64_t)QUANTUM_TARGET_US * 1000 / t->step_ns;
+        q = fit < (uint64_t)quantum.ceiling ? (int)fit : quantum.ceiling;
+        if (q < 1) q = 1;
+    }
+
+    /* multiplicative recovery after a command burst */
+    quantum.ceiling = quantum.ceiling < QUANTUM_MAX / 2 ? quantum.ceiling * 2
+                                                        : QUANTUM_MAX;
+    return q;
+}
+
+int quantum_cut(int phase, int next_phase, uint64_t spent_ns)
+{
+    if (quantum.fixed)
+        return 0;
+    return next_phase != phase || spent_ns >= (uint64_t)QUANTUM_TARGET_US * 1000;
+}
+
+void quantum_command(void)
+{
+    quantum.ceiling = 1;
+}
+
+/* The lane's cost per step is the mean over its last quantum, so a
+ * phase change (an expensive INIT followed by cheap CTLE steps) is
+ * picked up at the next decision. */
+void quantum_account(Task *t, int steps, uint64_t cost_ns)
+{
+    if (steps <= 0) return;
+    t->step_ns = cost_ns / (uint64_t)steps;
+    if (t->step_ns == 0) t->step_ns = 1;
+
+    quantum.decisions++;
+    quantum.steps += (uint64_t)steps;
+    if (steps > quantum.max_q)
+        quantum.max_q = steps;
+}
+
+void quantum_report(FILE *fp)
+{
+    if (quantum.fixed)
+        fprintf(fp, "Quantum [fixed %d]:", quantum.fixed);
+    else
+        fprintf(fp, "Quantum [adaptive, %d us]:", QUANTUM_TARGET_US);
+    fprintf(fp, " decisions=%llu steps=%llu mean=%.1f max=%d\n",
+            (unsigned long long)quantum.decisions,
+            (unsigned long long)quantum.steps,
+            quantum.decisions ? (double)quantum.steps / quantum.decisions : 0.0,
+            quantum.max_q);
+}
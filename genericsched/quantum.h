@@ -0,0 +1,56 @@
+#ifndef QUANTUM_H
+#define QUANTUM_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "task.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Adaptive scheduling quantum
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Each scheduling decision (policy pick, stdin poll, time-slice sleep)
+ *  runs the chosen lane for a quantum of up to q steps, one tick each.
+ *
+ *  q is sized so that a quantum takes about QUANTUM_TARGET_US of CPU
+ *  time at the lane's measured cost per step, so commands are still
+ *  picked up within roughly that latency while bulk training pays the
+ *  per-decision overhead once per quantum instead of once per step.
+ *  A command (from stdin or a script) collapses the ceiling to one step
+ *  (more commands usually follow); it then doubles every decision back
+ *  up to QUANTUM_MAX.  Input already waiting when a quantum is granted
+ *  gets a single step too, so it is not held behind a long quantum.  A
+ *  lane without a measurement yet runs a single step.
+ *
+ *  The cost a quantum is sized from is that of the lane's last one, so
+ *  a quantum is cut short when the lane changes phase, or once it has
+ *  taken QUANTUM_TARGET_US anyway (cheap INIT_LOAD polls followed by
+ *  CDR chunks within INIT): a wrong guess costs one target's worth of
+ *  latency, not QUANTUM_MAX expensive steps.
+ *
+ *  -q <n> fixes q instead; -q 1 is the classic one-step loop.
+ */
+#define QUANTUM_TARGET_US   2000    /* CPU time per decision when idle    */
+#define QUANTUM_MAX         1024    /* steps per decision                 */
+
+typedef struct {
+    int      fixed;                 /* -q; 0 → adaptive                   */
+    int      ceiling;               /* current upper bound on q           */
+    uint64_t decisions;
+    uint64_t steps;
+    int      max_q;                 /* largest quantum actually run       */
+} Quantum;
+
+extern Quantum quantum;
+
+void quantum_init   (int fixed);
+/* steps to give the picked lane; `pending`: input is already waiting */
+int  quantum_next   (const Task *t, int pending);
+/* after a step that ran in `phase`: stop the quantum here? */
+int  quantum_cut    (int phase, int next_phase, uint64_t spent_ns);
+void quantum_command(void);             /* a command was just handled     */
+void quantum_account(Task *t, int steps, uint64_t cost_ns);
+void quantum_report (FILE *fp);
+
+#endif /* QUANTUM_H */
@@ -1,49 +1,676 @@
-// TODO: change sched.c to use the generic tasks and strip references to the lanestate directly
-
+#include <limits.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/select.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "serdes_sim.h"
-
-#define NUM_LANES 16
+#include "lane_log.h"
+#include "task.h"
+#include "sched_policy.h"
+#include "deadline.h"
+#include "quantum.h"
+#include "bench.h"
+#include "script.h"
+#include "event.h"
+#include "port.h"
+#include "chan_load.h"
+#include "init_memo.h"
+#include "metrics.h"
+
+#define DEFAULT_NUM_LANES 16
 #define DEFAULT_DATA_RATE 60
 #define LOG_FILE "sched.log"
+#define DEFER_MAX 64              /* deferred commands held for retry     */
+#define DEFER_RETRY_TICKS 256     /* … retried at least this often        */
+#define MAX_RATES 64
 
-typedef struct {
-    void *task_data; // Pointer to this task struct
-    int (*task_run)(void *task_data, void *task_args); // Function pointer to the task's run function
-    int priority;
-    char is_active; // 1 if the task should be sccheduled, 0 if it is done or should not be scheduled
-} Task;
-
-int rr_index = 0;
 int pll_enabled = 1;
 FILE *logfp = NULL;
+FILE *tracefp = NULL;
 int tick = 0;
 
-typedef struct {
-    Task *task_buffer; // Initialized in main as an arrayList of Task structs
-    int task_buffer_size;
-    int task_buffer_capacity; 
-} Task_List;
+Task_List taskList;
+const char *channel_file = NULL;
+int random_prio = 0;
+const SchedPolicy *policy = NULL;
+int link_budget = 0;              /* -D in ticks; 0 → from the lane count */
+int budget_lanes = 0;             /* lanes the default budget shares with */
+AdmitMode admit_mode = ADMIT_OFF;
+const TaskType *lane_type = &serdes_lane_type;   /* -K / -C: default kind */
+
+/* commands held back by admission control in defer mode */
+char deferred[DEFER_MAX][128];
+int n_deferred = 0;
+int retry_armed = 0;              /* TIMER_DEFER_RETRY pending            */
+
+/* --bench: no stdin, no sleeps, JSON results at the end */
+int bench = 0;
+BenchStats bench_stats;
+
+/* -S: tick-stamped command replay; wall-time inputs are replaced by a
+ * fixed model (one-step quantum unless -q, modelled step cost) */
+Script script;
+int scripted = 0;
+
+/* discrete-event core: pending events and the virtual firmware clock */
+EventQueue events;
+unsigned fw_mhz = FW_CLOCK_MHZ;   /* -F                                   */
+uint64_t fw_cycles = 0;
+#define FW_TICK_CYCLES ((uint64_t)TICK_US * fw_mhz)   /* one idle tick    */
+
+/* -M: Prometheus text file with per-lane metrics */
+const char *metrics_file = NULL;
+
+/* -R: data rates of the start-up lanes, cycled */
+int rates[MAX_RATES] = { DEFAULT_DATA_RATE };
+int n_rates = 1;
+
+/* link-up time (ticks from becoming runnable to DONE) of every completion,
+ * and the same in firmware time (ms) */
+int *linkup = NULL;
+double *linkup_fw = NULL;
+int linkup_count = 0;
+int linkup_capacity = 0;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double fw_ms(uint64_t cycles)
+{
+    return cycles / (fw_mhz * 1e3);
+}
+
+static void linkup_record(int ticks, uint64_t fw)
+{
+    if (linkup_count == linkup_capacity) {
+        int cap = linkup_capacity ? linkup_capacity * 2 : 64;
+        int *buf = realloc(linkup, cap * sizeof(int));
+        if (!buf) return;
+        linkup = buf;
+        double *fbuf = realloc(linkup_fw, cap * sizeof(double));
+        if (!fbuf) return;
+        linkup_fw = fbuf;
+        linkup_capacity = cap;
+    }
+    linkup_fw[linkup_count] = fw_ms(fw);
+    linkup[linkup_count++] = ticks;
+}
+
+static void linkup_report(FILE *fp)
+{
+    if (linkup_count == 0) {
+        fprintf(fp, "Link-up [%s]: no lane completed\n", policy->name);
+        return;
+    }
+    qsort(linkup, linkup_count, sizeof(int), bench_cmp_int);
+    double sum = 0.0;
+    for (int i = 0; i < linkup_count; i++)
+        sum += linkup[i];
+    fprintf(fp, "Link-up [%s]: lanes=%d mean=%.1f p50=%d p90=%d p99=%d max=%d ticks\n",
+            policy->name, linkup_count, sum / linkup_count,
+            linkup[bench_rank(linkup_count, 50)], linkup[bench_rank(linkup_count, 90)],
+            linkup[bench_rank(linkup_count, 99)], linkup[linkup_count - 1]);
+
+    qsort(linkup_fw, linkup_count, sizeof(double), bench_cmp_double);
+    sum = 0.0;
+    for (int i = 0; i < linkup_count; i++)
+        sum += linkup_fw[i];
+    fprintf(fp, "Link-up [%s]: firmware mean=%.3f p50=%.3f p90=%.3f p99=%.3f max=%.3f ms\n",
+            policy->name, sum / linkup_count,
+            linkup_fw[bench_rank(linkup_count, 50)], linkup_fw[bench_rank(linkup_count, 90)],
+            linkup_fw[bench_rank(linkup_count, 99)], linkup_fw[linkup_count - 1]);
+}
+
+/* the wall-time ratio is left out of -S runs so their output stays
+ * reproducible byte for byte */
+static void fw_report(FILE *fp, uint64_t wall_ns)
+{
+    double fw_s = fw_ms(fw_cycles) / 1e3;
+    fprintf(fp, "Firmware time: %.3f s simulated at %u MHz over %d ticks",
+            fw_s, fw_mhz, tick);
+    if (!scripted && wall_ns)
+        fprintf(fp, " (%.1fx wall)", fw_s / (wall_ns / 1e9));
+    fprintf(fp, "\n");
+}
+
+static const char *admit_mode_name(void)
+{
+    switch (admit_mode) {
+        case ADMIT_REFUSE: return "refuse";
+        case ADMIT_DEFER:  return "defer";
+        default:           return "off";
+    }
+}
+
+/* ── Task list ────────────────────────────────────────────────────────
+ *  The slot index is the lane ID.  Removed lanes leave a hole
+ *  (task_data == NULL) that the next added lane reuses, so lane IDs
+ *  stay stable; the buffer grows by doubling.
+ */
+static int task_list_slot(Task_List *tl)
+{
+    for (int i = 0; i < tl->task_buffer_size; i++)
+        if (tl->task_buffer[i].task_data == NULL)
+            return i;
+
+    if (tl->task_buffer_size == tl->task_buffer_capacity) {
+        int cap = tl->task_buffer_capacity ? tl->task_buffer_capacity * 2 : DEFAULT_NUM_LANES;
+        Task *buf = realloc(tl->task_buffer, cap * sizeof(Task));
+        if (!buf) {
+            perror("realloc(task_buffer)");
+            return -1;
+        }
+        memset(buf + tl->task_buffer_capacity, 0,
+               (cap - tl->task_buffer_capacity) * sizeof(Task));
+        tl->task_buffer = buf;
+        tl->task_buffer_capacity = cap;
+    }
+    return tl->task_buffer_size++;
+}
+
+static Task *lane_task(int lane)
+{
+    if (lane < 0 || lane >= taskList.task_buffer_size)
+        return NULL;
+    Task *t = &taskList.task_buffer[lane];
+    return t->task_data ? t : NULL;
+}
+
+static int lane_priority(void)
+{
+    return random_prio ? (rand() % DEFAULT_NUM_LANES) : 1;
+}
+
+/* Default budget for a new task of `type`: one full run for every task
+ * sharing the CPU (the live ones and this one, or at least as many as
+ * there were start-up lanes), so tasks that start together can all make
+ * it, plus EDF_DEADLINE_UNIT per priority level so that priorities still
+ * order the deadlines. */
+static int lane_budget(int priority, const TaskType *type)
+{
+    if (link_budget)
+        return link_budget;
+    long long work = type->full_work();
+    int lanes = 1;
+    for (int i = 0; i < taskList.task_buffer_size; i++) {
+        const Task *t = &taskList.task_buffer[i];
+        if (t->task_data) {
+            work += t->type->full_work();
+            lanes++;
+        }
+    }
+    if (lanes < budget_lanes)
+        work += (long long)(budget_lanes - lanes) * type->full_work();
+    long long b = work + (long long)priority * EDF_DEADLINE_UNIT;
+    return b < INT_MAX / 2 ? (int)b : INT_MAX / 2;
+}
+
+static int lane_add(int rate, int priority, const TaskType *type)
+{
+    int budget = lane_budget(priority, type);
+    int lane = task_list_slot(&taskList);
+    if (lane < 0)
+        return -1;
+
+    Task *cur_task = &taskList.task_buffer[lane];
+    cur_task->type = type;
+    cur_task->task_data = cur_task->type->create(&(LaneInitArgs){.dataRateGbps = rate, .channel_file = channel_file, .id = lane});
+    if (!cur_task->task_data) {
+        cur_task->type = NULL;
+        if (lane == taskList.task_buffer_size - 1)
+            taskList.task_buffer_size--;
+        return -1;
+    }
+    if (!metrics_clear(lane)) {
+        cur_task->type->destroy(cur_task->task_data);
+        memset(cur_task, 0, sizeof(*cur_task));
+        if (lane == taskList.task_buffer_size - 1)
+            taskList.task_buffer_size--;
+        return -1;
+    }
+    cur_task->priority = priority;
+    cur_task->weight = sched_policy_weight(cur_task->priority);
+    cur_task->budget = budget;
+    cur_task->is_active = 1;
+    cur_task->enqueued = tick;
+    cur_task->enqueued_ns = now_ns();
+    cur_task->enqueued_fw = fw_cycles;
+    deadline_arm(cur_task, tick);
+    port_enqueue(lane, tick, fw_cycles);
+    metrics_ready(metrics_lane(lane), tick, cur_task->enqueued_ns);
+    policy->enqueue(&taskList, lane, tick);
+    return lane;
+}
+
+static void lane_remove(int lane)
+{
+    Task *t = &taskList.task_buffer[lane];
+    if (t->is_active)
+        policy->on_complete(&taskList, lane, tick);
+    t->type->destroy(t->task_data);
+    memset(t, 0, sizeof(*t));
+
+    /* trim trailing holes so scans stay short */
+    while (taskList.task_buffer_size > 0 &&
+           taskList.task_buffer[taskList.task_buffer_size - 1].task_data == NULL)
+        taskList.task_buffer_size--;
+    port_removed(&taskList, lane, tick, fw_cycles);
+}
+
+/* Lane to run next: the policy's choice, or under gang scheduling the
+ * member of the port whose round is in progress. */
+static int pick_lane(void)
+{
+    int lane = port_continue(&taskList);
+    return lane >= 0 ? lane : port_enter(&taskList, policy->pick(&taskList, tick));
+}
+
+/* Restart training: link-up clock, deadline and policy state too. */
+static void lane_restart(int lane)
+{
+    Task *t = &taskList.task_buffer[lane];
+    t->type->command(t->task_data, TASK_RESET, 0);
+    t->is_active = 1;
+    t->enqueued = tick;
+    t->enqueued_ns = now_ns();
+    t->enqueued_fw = fw_cycles;
+    deadline_arm(t, tick);
+    port_enqueue(lane, tick, fw_cycles);
+    metrics_ready(metrics_lane(lane), tick, t->enqueued_ns);
+    policy->enqueue(&taskList, lane, tick);
+}
+
+/* ── Admission control ────────────────────────────────────────────────
+ *  Returns 1 if a request that (re)starts `work` steps of training may
+ *  go ahead now.  Otherwise it is refused or, in defer mode, its command
+ *  line is queued and retried whenever a lane completes and on a
+ *  TIMER_DEFER_RETRY event every DEFER_RETRY_TICKS ticks.  `retry` is set for queued commands,
+ *  which are re-queued silently.
+ */
+static void retry_arm(void)
+{
+    if (retry_armed || n_deferred == 0)
+        return;
+    if (evq_push(&events, tick + DEFER_RETRY_TICKS, EV_TIMER, TIMER_DEFER_RETRY, NULL) == 0)
+        retry_armed = 1;
+}
+
+static int admit(const char *buf, int lane, int work, int budget, int retry)
+{
+    if (admit_mode == ADMIT_OFF ||
+        deadline_admit(&taskList, tick, lane, work, budget))
+        return 1;
+
+    int len = (int)strcspn(buf, "\n");
+    if (admit_mode == ADMIT_DEFER && (retry || n_deferred < DEFER_MAX)) {
+        snprintf(deferred[n_deferred++], sizeof(deferred[0]), "%.*s", len, buf);
+        retry_arm();
+        if (retry)
+            return 0;
+        deadline_stats.deferred++;
+        printf("'%.*s' deferred: would miss a link-up budget\n", len, buf);
+        lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO, lane < 0
+                      ? "CMD: add lane deferred (link-up budget)\n"
+                      : "CMD: lane %d request deferred (link-up budget)\n", lane, 0, 0);
+        return 0;
+    }
+
+    deadline_stats.refused++;
+    printf("'%.*s' refused: would miss a link-up budget\n", len, buf);
+    lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO, lane < 0
+                  ? "CMD: add lane refused (link-up budget)\n"
+                  : "CMD: lane %d request refused (link-up budget)\n", lane, 0, 0);
+    return 0;
+}
+
+static void handle_command(const char *buf, int retry);
+
+static void deferred_retry(void)
+{
+    char pending[DEFER_MAX][128];
+    int n = n_deferred;
+    memcpy(pending, deferred, n * sizeof(pending[0]));
+    n_deferred = 0;
+    for (int i = 0; i < n; i++)
+        handle_command(pending[i], 1);
+}
+
+static void pll_toggle(void)
+{
+    pll_enabled = !pll_enabled;
+    printf("PLL %s\n", pll_enabled ? "ON" : "OFF");
+    lane_log_text(tick, -1, LOG_CAT_CMD, LOG_INFO, pll_enabled ? "CMD: PLL ON\n"
+                                                              : "CMD: PLL OFF\n", 0, 0, 0);
+}
+
+/* ── Command interpreter ──────────────────────────────────────────────
+ *  One line of operator input, e.g. "d 3 56".  `retry` is set when a
+ *  command deferred by admission control is tried again.
+ */
+static void handle_command(const char *buf, int retry)
+{
+    /* simple parsing */
+    if (buf[0] == 's') {
+        int lane = -1;
+        if (sscanf(buf, "s %d", &lane) == 1) {
+            Task *t = lane_task(lane);
+            if (t) {
+                t->type->status(t->task_data);
+                lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO,
+                              "CMD: status query lane %d\n", lane, 0, 0);
+            } else {
+                printf("Invalid lane %d\n", lane);
+            }
+        } else {
+            /* print all lanes */
+            for (int i = 0; i < taskList.task_buffer_size; i++) {
+                Task *t = lane_task(i);
+                if (!t) continue;
+                t->type->status(t->task_data);
+            }
+            lane_log_text(tick, -1, LOG_CAT_CMD, LOG_INFO,
+                          "CMD: status query ALL\n", 0, 0, 0);
+        }
+    }
+    else if (buf[0] == 'd') {
+        int lane, rate;
+        if (sscanf(buf, "d %d %d", &lane, &rate) == 2) {
+            Task *t = lane_task(lane);
+            if (t) {
+                /* the new rate only takes effect through a retrain */
+                if (!admit(buf, lane, t->type->full_work(), t->budget, retry))
+                    return;
+                if (t->type->command(t->task_data, TASK_SET_RATE, rate) != 0) {
+                    printf("Lane %d has no data rate\n", lane);
+                    return;
+                }
+                lane_restart(lane);
+                LaneMetrics *m = metrics_lane(lane);
+                if (m)
+                    m->rate_changes++;
+                lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO,
+                              "CMD: lane %d rate → %d Gbps (soft reset)\n", lane, rate, 0);
+            } else {
+                printf("Invalid lane %d\n", lane);
+            }
+        } else {
+            printf("Usage: d <lane> <rate>\n");
+        }
+    }
+    else if (buf[0] == 'r') {
+        int lane;
+        if (sscanf(buf, "r %d", &lane) == 1) {
+            Task *t = lane_task(lane);
+            if (t) {
+                if (!admit(buf, lane, t->type->full_work(), t->budget, retry))
+                    return;
+                lane_restart(lane);
+                LaneMetrics *m = metrics_lane(lane);
+                if (m)
+                    m->resets++;
+                lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO,
+                              "CMD: lane %d soft reset\n", lane, 0, 0);
+            } else {
+                printf("Invalid lane %d\n", lane);
+            }
+        } else {
+            printf("Usage: r <lane>\n");
+        }
+    }
+    else if (buf[0] == 'a') {
+        int rate = DEFAULT_DATA_RATE;
+        char kind[32] = "";
+        sscanf(buf, "a %d %31s", &rate, kind);
+        const TaskType *type = kind[0] ? task_type_find(kind) : lane_type;
+        if (!type) {
+            printf("Unknown task kind '%s'\n", kind);
+            return;
+        }
+        int prio = lane_priority();
+        if (!admit(buf, -1, type->full_work(), lane_budget(prio, type), retry))
+            return;
+        int lane = lane_add(rate, prio, type);
+        if (lane >= 0) {
+            if (type == lane_type)
+                printf("Lane %d added (%d Gbps)\n", lane, rate);
+            else
+                printf("Lane %d added (%d Gbps, %s)\n", lane, rate, type->name);
+            lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO,
+                          "CMD: lane %d added (%d Gbps)\n", lane, rate, 0);
+        } else {
+            printf("Could not add lane\n");
+        }
+    }
+    else if (buf[0] == 'x') {
+        int lane;
+        if (sscanf(buf, "x %d", &lane) == 1) {
+            if (lane_task(lane)) {
+                lane_remove(lane);
+                printf("Lane %d removed\n", lane);
+                lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO,
+                              "CMD: lane %d removed\n", lane, 0, 0);
+            } else {
+                printf("Invalid lane %d\n", lane);
+            }
+        } else {
+            printf("Usage: x <lane>\n");
+        }
+    }
+    else if (buf[0] == 'm') {
+        metrics_print(stdout, &taskList);
+        lane_log_text(tick, -1, LOG_CAT_CMD, LOG_INFO,
+                      "CMD: metrics\n", 0, 0, 0);
+    }
+    else if (buf[0] == 'g') {
+        port_print(stdout, &taskList);
+        lane_log_text(tick, -1, LOG_CAT_CMD, LOG_INFO,
+                      "CMD: port report\n", 0, 0, 0);
+    }
+    else if (buf[0] == 'k') {
+        deadline_report(stdout, &taskList, tick);
+        lane_log_text(tick, -1, LOG_CAT_CMD, LOG_INFO,
+                      "CMD: slack report\n", 0, 0, 0);
+    }
+    else if (buf[0] == 'p') {
+        pll_toggle();
+    }
+}
+
+/* A line (or EOF) is waiting on stdin */
+static int stdin_pending(void)
+{
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(STDIN_FILENO, &readfds);
+    struct timeval tv = {0, 0};
+    return select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv) > 0;
+}
+
+static void dispatch_event(const Event *ev)
+{
+    switch (ev->type) {
+        case EV_COMMAND:
+            handle_command(ev->cmd, 0);
+            quantum_command();
+            break;
+        case EV_PLL:
+            pll_toggle();
+            break;
+        case EV_TIMER:
+            if (ev->timer == TIMER_DEFER_RETRY) {
+                retry_armed = 0;
+                deferred_retry();
+                retry_arm();
+            }
+            break;
+    }
+}
+
+static void print_banner(unsigned seed, int fixed_quantum)
+{
+    printf("Scheduler started with channel '%s'.\n", channel_file);
+    printf("Priority mode: %s\n", random_prio ? "RANDOM" : "EQUAL");
+    printf("Policy: %s   Seed: %u   Lane tasks: %s\n", policy->name, seed, lane_type->name);
+    if (link_budget)
+        printf("Link-up budget: %d ticks   Admission: %s\n", link_budget, admit_mode_name());
+    else
+        printf("Link-up budget: %d lanes x %d + priority x %d ticks   Admission: %s\n",
+               budget_lanes, lane_type->full_work(), EDF_DEADLINE_UNIT, admit_mode_name());
+    if (fixed_quantum > 0)
+        printf("Quantum: %d steps\n", fixed_quantum);
+    else
+        printf("Quantum: adaptive (%d us per decision, max %d steps)\n",
+               QUANTUM_TARGET_US, QUANTUM_MAX);
+    if (ports.n)
+        printf("Ports: %d, %s scheduling\n", ports.n, ports.gang ? "gang" : "independent");
+    printf("Logs → %s\n", LOG_FILE);
+
+    /* print initial priorities */
+    printf("Initial priorities:");
+    for (int i = 0; i < taskList.task_buffer_size; i++)
+        printf(" [%d]=%d", i, taskList.task_buffer[i].priority);
+    printf("\n");
+
+    printf("Commands:\n");
+    printf("  s [lane]          - show status (all lanes, or one lane)\n");
+    printf("  d <lane> <rate>   - change data rate for a lane\n");
+    printf("  r <lane>          - soft reset a lane\n");
+    printf("  a [rate] [kind]   - add a lane (of another task kind)\n");
+    printf("  x <lane>          - remove a lane\n");
+    printf("  k                 - show link-up slack per lane\n");
+    printf("  m                 - show per-lane metrics\n");
+    printf("  g                 - show ports\n");
+    printf("  p                 - turn PLL on/off\n");
+}
 
 int main(int argc, char *argv[]) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <channel_taps.txt> [-r]\n", argv[0]);
+        fprintf(stderr, "Usage: %s <channel_taps.txt> [-r] [-n <lanes>] [-P <policy>] [-s <seed>]\n"
+                        "          [-R <rate,...>] [-D <budget>] [-A off|refuse|defer] [-q <steps>]\n"
+                        "          [-v <spec>] [-t <trace.bin>] [-S <script>] [-M <metrics.prom>] [-C|-K <kind>]\n"
+                        "          [-F <MHz>] [-g|-G <widths>] [--no-memo]\n"
+                        "          [--bench [-o <out.json>]]\n", argv[0]);
         fprintf(stderr, "  -r   assign random initial priorities to each lane\n");
+        sched_policy_usage(stderr);
+        fprintf(stderr, "  -s   random seed (priorities, PRBS, lottery); default: time\n");
+        fprintf(stderr, "  -n   number of lanes at start-up (default %d)\n", DEFAULT_NUM_LANES);
+        fprintf(stderr, "  -R   data rates (Gbps) of the start-up lanes, cycled (default %d)\n",
+                DEFAULT_DATA_RATE);
+        fprintf(stderr, "  -D   link-up budget per lane: <ticks> or <n>us|ms|s at %d us/tick\n"
+                        "       (default: a full run per lane, plus priority x %d ticks)\n",
+                TICK_US, EDF_DEADLINE_UNIT);
+        fprintf(stderr, "  -A   admission control for a, r and d commands (default off)\n");
+        fprintf(stderr, "  -q   steps per scheduling decision (default 0 = adaptive)\n");
+        fprintf(stderr, "  -t   write a binary trace instead of per-step text (see trace_decode)\n");
+        fprintf(stderr, "  -S   replay a command script (\"@<tick> <cmd>\" lines) instead of stdin;\n"
+                        "       with -s the run is reproducible bit for bit\n");
+        fprintf(stderr, "  -M   write per-lane metrics in Prometheus text format every %d ms\n",
+                METRICS_PERIOD_MS);
+        fprintf(stderr, "  -F   modelled firmware clock for simulated time (default %d MHz)\n",
+                FW_CLOCK_MHZ);
+        fprintf(stderr, "  -g   group lanes into ports, e.g. 4 (x4 ports) or 4,4,8, for port link-up stats\n");
+        fprintf(stderr, "  -G   as -g, and gang-schedule each port's lanes, lagging members first\n");
+        fprintf(stderr, "  -C   run lane training as coroutines (same results, cheaper re-entry);\n"
+                        "       short for -K serdes-coro\n");
+        task_type_usage(stderr);
+        fprintf(stderr, "  --no-memo  recompute the CDR in every lane's INIT\n");
+        fprintf(stderr, "  --bench  run headless to completion (no stdin, no sleeps, no sched.log)\n"
+                        "           and write JSON results to stdout, or to -o <file>\n");
+        lane_log_usage(stderr);
         return 1;
     }
 
     /* parse args */
-    const char *channel_file = NULL;
-    int random_prio = 0;
+    const char *trace_file = NULL;
+    int num_lanes = DEFAULT_NUM_LANES;
+    int fixed_quantum = 0;
+    const char *policy_name = "prio";
+    const char *rates_arg = NULL;
+    const char *bench_out = NULL;
+    const char *port_spec = NULL;
+    int gang = 0;
+    unsigned seed = (unsigned)time(NULL);
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-r") == 0)
             random_prio = 1;
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            num_lanes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc)
+            policy_name = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = (unsigned)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            trace_file = argv[++i];
+        else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+            if (deadline_parse_budget(argv[++i], &link_budget) != 0) {
+                fprintf(stderr, "Error: bad link-up budget '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            rates_arg = argv[++i];
+            n_rates = bench_parse_rates(rates_arg, rates, MAX_RATES);
+            if (n_rates == 0) {
+                fprintf(stderr, "Error: bad rate list '%s'\n", rates_arg);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            if (script_load(&script, argv[++i]) != 0 ||
+                evq_load(&events, &script) != 0)
+                return 1;
+            scripted = 1;
+        }
+        else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc)
+            metrics_file = argv[++i];
+        else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            fw_mhz = (unsigned)strtoul(argv[++i], NULL, 0);
+            if (fw_mhz == 0) {
+                fprintf(stderr, "Error: bad firmware clock '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if ((strcmp(argv[i], "-g") == 0 || strcmp(argv[i], "-G") == 0) && i + 1 < argc) {
+            gang = argv[i][1] == 'G';
+            port_spec = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-memo") == 0)
+            init_memo_enable(0);
+        else if (strcmp(argv[i], "-C") == 0)
+            lane_type = &serdes_coro_type;
+        else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc) {
+            lane_type = task_type_find(argv[++i]);
+            if (!lane_type) {
+                fprintf(stderr, "Error: unknown task kind '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--bench") == 0)
+            bench = 1;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            bench_out = argv[++i];
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc)
+            fixed_quantum = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-A") == 0 && i + 1 < argc) {
+            if (deadline_parse_mode(argv[++i], &admit_mode) != 0) {
+                fprintf(stderr, "Error: bad admission mode '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+            if (lane_log_config(argv[++i]) != 0) {
+                fprintf(stderr, "Error: bad log spec '%s'\n", argv[i]);
+                return 1;
+            }
+        }
         else
             channel_file = argv[i];
     }
@@ -53,60 +680,75 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (num_lanes < 0) {
+        fprintf(stderr, "Error: lane count must be >= 0.\n");
+        return 1;
+    }
 
-    srand((unsigned)time(NULL));
-    setvbuf(stdout, NULL, _IOLBF, 0);
+    if (port_spec && port_parse(port_spec, num_lanes, gang) != 0) {
+        fprintf(stderr, "Error: bad port layout '%s'\n", port_spec);
+        return 1;
+    }
 
-    logfp = fopen(LOG_FILE, "w");
-    if (!logfp)
-        fprintf(stderr, "Warning: could not open %s for writing\n", LOG_FILE);
+    policy = sched_policy_find(policy_name);
+    if (!policy) {
+        fprintf(stderr, "Error: unknown policy '%s'.\n", policy_name);
+        return 1;
+    }
 
-    setLogFile(logfp);
-    fd_set readfds;
+    srand(seed);
+    if (scripted && fixed_quantum <= 0)
+        fixed_quantum = 1;    /* the adaptive quantum follows wall time */
+    quantum_init(fixed_quantum);
+    sched_policy_seed(seed);
+    setvbuf(stdout, NULL, _IOLBF, 0);
 
-    Task_List taskList;
-    taskList.task_buffer_capacity = NUM_LANES;
-    taskList.task_buffer = calloc(taskList.task_buffer_capacity, sizeof(Task));
-    if (!taskList.task_buffer) {
-        perror("calloc(task_buffer)");
+    /* scripted runs wait for each load so ticks don't depend on the disk;
+     * no watcher: a lane takes a changed file when it is reset ('r') */
+    if (chan_load_start(scripted, 0) != 0)
         return 1;
-    }
-    taskList.task_buffer_size = 0;
 
-    /* Initialize all lanes */
-    for (int i = 0; i < NUM_LANES; i++) {
-        Task *cur_task = &taskList.task_buffer[i];      // <- FIXED pointer arithmetic
-        /* pass the LaneContext pointer, not the address of the pointer */
-        generic_lane_init(&cur_task->task_data, &(LaneInitArgs){.dataRateGbps = DEFAULT_DATA_RATE, .channel_file = channel_file});
-        cur_task->task_run = generic_lane_step;
-        cur_task->priority = random_prio ? (rand() % NUM_LANES) : 1;
-        cur_task->is_active = 1;
+    if (bench) {
+        lane_console = 0;
+    } else {
+        logfp = fopen(LOG_FILE, "w");
+        if (!logfp)
+            fprintf(stderr, "Warning: could not open %s for writing\n", LOG_FILE);
     }
-    taskList.task_buffer_size = NUM_LANES; // set size explicitly
 
-    printf("Scheduler started with channel '%s'.\n", channel_file);
-    printf("Priority mode: %s\n", random_prio ? "RANDOM" : "EQUAL");
-    printf("Logs → %s\n", LOG_FILE);
+    memset(&taskList, 0, sizeof(taskList));
 
-    /* print initial priorities */
-    printf("Initial priorities:");
-    for (int i = 0; i < NUM_LANES; i++)
-        printf(" [%d]=%d", i, taskList.task_buffer[i].priority);
-    printf("\n");
+    /* Initialize all lanes */
+    budget_lanes = num_lanes;
+    for (int i = 0; i < num_lanes; i++) {
+        if (lane_add(rates[i % n_rates], lane_priority(), lane_type) < 0) {
+            fprintf(stderr, "Error: could not allocate lane %d\n", i);
+            return 1;
+        }
+    }
 
-    printf("Commands:\n");
-    printf("  s [lane]          - show status (all lanes, or one lane)\n");
-    printf("  d <lane> <rate>   - change data rate for a lane\n");
-    printf("  r <lane>          - soft reset a lane\n");
-    printf("  p                 - turn PLL on/off\n");
+    if (!bench)
+        print_banner(seed, fixed_quantum);
 
     if (logfp) {
         fprintf(logfp, "=== Scheduler started ===\n");
         fprintf(logfp, "Channel file: %s\n", channel_file);
         fprintf(logfp, "Priority mode: %s\n", random_prio ? "RANDOM" : "EQUAL");
-        fprintf(logfp, "Lanes: %d   Data rate: %d Gbps\n", NUM_LANES, DEFAULT_DATA_RATE);
+        fprintf(logfp, "Policy: %s   Seed: %u\n", policy->name, seed);
+        if (link_budget)
+            fprintf(logfp, "Link-up budget: %d ticks   Admission: %s\n",
+                    link_budget, admit_mode_name());
+        else
+            fprintf(logfp, "Link-up budget: %d lanes x %d + priority x %d ticks   Admission: %s\n",
+                    budget_lanes, lane_type->full_work(), EDF_DEADLINE_UNIT,
+                    admit_mode_name());
+        fprintf(logfp, "Lanes: %d   Data rate: %s Gbps\n", taskList.task_buffer_size,
+                rates_arg ? rates_arg : "60");
+        if (ports.n)
+            fprintf(logfp, "Ports: %d, %s scheduling\n", ports.n,
+                    ports.gang ? "gang" : "independent");
         fprintf(logfp, "Initial priorities:");
-        for (int i = 0; i < NUM_LANES; i++)
+        for (int i = 0; i < taskList.task_buffer_size; i++)
             fprintf(logfp, " [%d]=%d", i, taskList.task_buffer[i].priority);
         fprintf(logfp, "\n");
         fprintf(logfp, "OSF=%d  N_BIT=%d  ADC_BITS=%d  NUM_LEVELS=%d\n",
@@ -118,139 +760,200 @@ int main(int argc, char *argv[]) {
                 CTLE_NA, CTLE_NZ, CTLE_WINDOW);
         fprintf(logfp, "Step size: %d samples/step\n\n", STEP_SIZE);
         fflush(logfp);
+
+        /* from here on, sched.log is written by the background logger */
+        tracefp = trace_file ? fopen(trace_file, "wb") : NULL;
+        if (trace_file && !tracefp)
+            fprintf(stderr, "Warning: could not open %s for writing\n", trace_file);
+        if (tracefp) {
+            lane_log_trace(tracefp);
+            fprintf(logfp, "Binary trace: %s\n\n", trace_file);
+        }
+        lane_log_start(logfp);
     }
 
-    int stdin_open = 1;
+    /* interactive runs are paced by wall time; everything else runs on
+     * the virtual clock as fast as the host allows */
+    const int interactive = !bench && !scripted;
+    int stdin_open = interactive;
+    if (interactive)
+        setvbuf(stdin, NULL, _IONBF, 0);   /* so select() sees every pending line */
+    if (metrics_file && metrics_start(metrics_file) != 0)
+        fprintf(stderr, "Warning: no metrics writer; %s will not be written\n", metrics_file);
+    bench_start(&bench_stats);
+    uint64_t wall_t0 = now_ns();
 
     while (1) {
-        tick++;
-        updateLaneTick();
+        task_tick = ++tick;
 
         /* -------- INTERRUPT HANDLING -------- */
         if (stdin_open) {
-           FD_ZERO(&readfds);
-            FD_SET(STDIN_FILENO, &readfds);
-            struct timeval tv = {0, 0};
-
-            int ret = select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv);
-
-            if (ret > 0) {
+            if (stdin_pending()) {
                 char buf[128];
                 if (!fgets(buf, sizeof(buf), stdin)) {
                     stdin_open = 0;   /* EOF — stop polling */
                 } else {
-                    LaneStepArgs step_args;
-                    memset(&step_args, 0, sizeof(step_args));
-
-                    /* simple parsing */
-                    if (buf[0] == 's') {
-                        int lane = -1;
-                        if (sscanf(buf, "s %d", &lane) == 1) {
-                            if (lane >= 0 && lane < NUM_LANES) {
-                                step_args.flags = PRINT_STATUS;
-                                Task *t = &taskList.task_buffer[lane];
-                                t->task_run(t->task_data, &step_args);
-                                if (logfp) fprintf(logfp, "[tick %8d] CMD: status query lane %d\n", tick, lane);
-                            } else {
-                                printf("Invalid lane %d\n", lane);
-                            }
-                        } else {
-                            /* print all lanes */
-                            for (int i = 0; i < NUM_LANES; i++) {
-                                step_args.flags = PRINT_STATUS;
-                                Task *t = &taskList.task_buffer[i];
-                                t->task_run(t->task_data, &step_args);
-                            }
-                            if (logfp) fprintf(logfp, "[tick %8d] CMD: status query ALL\n", tick);
-                        }
-                    }
-                    else if (buf[0] == 'd') {
-                        int lane, rate;
-                        if (sscanf(buf, "d %d %d", &lane, &rate) == 2) {
-                            if (lane >= 0 && lane < NUM_LANES) {
-                                step_args.flags = DATA_RATE_CHANGE;
-                                step_args.dataRateGbps = rate;
-                                Task *t = &taskList.task_buffer[lane];
-                                t->task_run(t->task_data, &step_args);
-                                if (logfp) fprintf(logfp, "[tick %8d] CMD: lane %d rate → %d Gbps\n", tick, lane, rate);
-                            } else {
-                                printf("Invalid lane %d\n", lane);
-                            }
-                        } else {
-                            printf("Usage: d <lane> <rate>\n");
-                        }
-                    }
-                    else if (buf[0] == 'r') {
-                        int lane;
-                        if (sscanf(buf, "r %d", &lane) == 1) {
-                            if (lane >= 0 && lane < NUM_LANES) {
-                                step_args.flags = SOFT_RESET;
-                                Task *t = &taskList.task_buffer[lane];
-                                t->task_run(t->task_data, &step_args);
-                                if (logfp) fprintf(logfp, "[tick %8d] CMD: lane %d soft reset\n", tick, lane);
-                            } else {
-                                printf("Invalid lane %d\n", lane);
-                            }
-                        } else {
-                            printf("Usage: r <lane>\n");
-                        }
-                    }
-                    else if (buf[0] == 'p') {
-                        pll_enabled = !pll_enabled;
-                        printf("PLL %s\n", pll_enabled ? "ON" : "OFF");
-                        if (logfp) fprintf(logfp, "[tick %8d] CMD: PLL %s\n", tick, pll_enabled ? "ON" : "OFF");
-                    }
+                    handle_command(buf, 0);
+                    quantum_command();
                 }
             }
         }
 
-        /* -------- SCHEDULING -------- */
+        /* -------- EVENTS (commands, PLL, timers) -------- */
+        Event ev;
+        while (evq_pop(&events, tick, &ev))
+            dispatch_event(&ev);
 
-        int best = 999999;
-        int chosen = -1;
+        /* -------- SCHEDULING -------- */
 
-        /* Find best priority */
-        for (int i = 0; i < NUM_LANES; i++) {
-            if (taskList.task_buffer[i].is_active == 1 &&
-                taskList.task_buffer[i].priority < best)
-            {
-                best = taskList.task_buffer[i].priority;
-            }
+        if (!pll_enabled && !interactive) {
+            /* nothing runs until an event turns the PLL back on */
+            if (evq_inputs(&events) == 0)
+                goto exit;
+            fw_cycles += (uint64_t)(evq_next_tick(&events) - tick) * FW_TICK_CYCLES;
+            tick = evq_next_tick(&events) - 1;
+            task_tick = tick;
+            continue;
         }
-
-        /* Round-robin among best */
-        for (int k = 0; k < NUM_LANES; k++) {
-            int i = (rr_index + k) % NUM_LANES;
-
-            if (taskList.task_buffer[i].is_active == 1 &&
-                taskList.task_buffer[i].priority == best)
-            {
-                chosen = i;
-                break;
+        if (!pll_enabled)
+            fw_cycles += FW_TICK_CYCLES;
+
+        if (pll_enabled) {
+            int chosen = pick_lane();
+            if (chosen < 0 && n_deferred) {
+                /* nothing left to protect: deferred work may fit now */
+                deferred_retry();
+                chosen = pick_lane();
             }
-        }
+            if (chosen < 0 && evq_inputs(&events) > 0) {
+                /* idle: jump straight to the next event */
+                fw_cycles += (uint64_t)(evq_next_tick(&events) - tick) * FW_TICK_CYCLES;
+                tick = evq_next_tick(&events) - 1;
+                task_tick = tick;
+                continue;
+            }
+            if (chosen < 0)
+                goto exit;
 
-        if (chosen >= 0 && pll_enabled) {
-            rr_index = (chosen + 1) % NUM_LANES;
             Task *t = &taskList.task_buffer[chosen];
 
-            LaneStepArgs step_args;
-            memset(&step_args, 0, sizeof(step_args));
-            step_args.flags = NO_INTERRUPT; /* normal scheduled step; use other flags for interrupts */
+            /* run one quantum: each step is a tick of its own */
+            LaneMetrics *lm = metrics_lane(chosen);
+            metrics_dispatch(lm, tick, now_ns());
+            int q = quantum_next(t, stdin_open && stdin_pending());
+            int until = evq_next_tick(&events) - tick;
+            if (until > 0 && until < q)
+                q = until;    /* stop right before the next event */
+            int steps = 0, ret = 0;
+            uint64_t spent = 0, cpu0 = metrics_cpu_ns();
+            int phase = t->type->phase(t->task_data);
+            while (1) {
+                uint64_t t0 = now_ns();
+                ret = t->type->step(t->task_data);
+                uint64_t cost = now_ns() - t0;
+                uint64_t cyc = t->type->cycles(t->task_data, phase);
+                fw_cycles += cyc;
+                policy->tick(&taskList, chosen, tick,
+                             scripted ? cyc * 1000 / fw_mhz : cost);
+                bench_step(&bench_stats, phase, cost);
+                metrics_step(lm, phase, cost);
+                spent += cost;
+                steps++;
+                if (ret != 0 || steps == q)
+                    break;
+                int next = t->type->phase(t->task_data);
+                if (quantum_cut(phase, next, spent))
+                    break;
+                phase = next;
+                task_tick = ++tick;
+            }
+            quantum_account(t, steps, spent);
+            metrics_quantum(lm, metrics_cpu_ns() - cpu0);
+            if (ret > 0)
+                metrics_done(lm, t->type->quality(t->task_data));
+            else if (ret == 0)
+                metrics_yield(lm, tick, now_ns());
 
-            int ret = t->task_run(t->task_data, &step_args);
-            if (ret != 0) {
+            if (ret > 0) {
                 t->is_active = 0; // Mark task as inactive if it returns DONE
+                linkup_record(tick - t->enqueued + 1, fw_cycles - t->enqueued_fw);
+                bench_linkup(&bench_stats, tick - t->enqueued + 1,
+                             now_ns() - t->enqueued_ns);
+                deadline_complete(t, tick);
+                policy->on_complete(&taskList, chosen, tick);
+                port_complete(&taskList, chosen, tick, fw_cycles);
+                if (n_deferred)
+                    deferred_retry();
+            } else if (ret < 0) {
+                /* failed (lane: channel not loadable): off the run queue
+                 * without a link-up, until 'r' restarts it */
+                t->is_active = 0;
+                policy->on_complete(&taskList, chosen, tick);
+                if (n_deferred)
+                    deferred_retry();
             }
         }
 
-        if (chosen < 0 && pll_enabled) {
-            goto exit;
-        }
+        metrics_export(&taskList, now_ns());
 
-        usleep(10);    /* simulate firmware time slice */
+        if (interactive)
+            usleep(10);    /* simulate firmware time slice (once per quantum) */
     }
 
-exit:
+exit:;
+    uint64_t wall_ns = now_ns() - wall_t0;
+    if (bench) {
+        FILE *out = bench_out ? fopen(bench_out, "w") : stdout;
+        if (!out) {
+            perror(bench_out);
+        } else {
+            BenchInfo info = { .program = "genericsched", .channel = channel_file,
+                               .policy = policy->name, .rates = rates_arg ? rates_arg : "60",
+                               .lanes = num_lanes, .random_prio = random_prio, .seed = seed };
+            bench_write(out, &bench_stats, &info);
+            if (out != stdout) fclose(out);
+        }
+    }
+
+    if (metrics_stop(&taskList) != 0)
+        fprintf(stderr, "Warning: could not write %s\n", metrics_file);
+
+    /* in bench mode stdout may carry the JSON: summaries go to stderr */
+    FILE *con = bench ? stderr : stdout;
+    linkup_report(con);
+    deadline_summary(con);
+    quantum_report(con);
+    port_report(con, fw_mhz);
+    init_memo_report(con);
+    chan_load_report(con);
+    fw_report(con, wall_ns);
+    if (n_deferred)
+        fprintf(con, "%d deferred command(s) never admitted\n", n_deferred);
+    lane_log_stop();
+    if (logfp) {
+        linkup_report(logfp);
+        deadline_summary(logfp);
+        quantum_report(logfp);
+        port_report(logfp, fw_mhz);
+        init_memo_report(logfp);
+        chan_load_report(logfp);
+        fw_report(logfp, wall_ns);
+    }
+    if (tracefp) fclose(tracefp);
+    if (logfp) fclose(logfp);
+    for (int i = 0; i < taskList.task_buffer_size; i++)
+        if (taskList.task_buffer[i].task_data)
+            taskList.task_buffer[i].type->destroy(taskList.task_buffer[i].task_data);
+    free(taskList.task_buffer);
+    lane_slabs_free();
+    chan_load_stop();
+    bench_free(&bench_stats);
+    script_free(&script);
+    evq_free(&events);
+    port_free();
+    init_memo_free();
+    free(linkup);
+    free(linkup_fw);
+    metrics_free();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,215 @@
+/*
+ * sched_policy.c
+ *
+ * Scheduling policies for the generic scheduler.  Every policy works on
+ * the shared Task_List and keeps its per-lane state in the Task itself
+ * (weight / deadline / vstart / vfinish), plus a few globals below.
+ * A task is runnable when is_active == 1.
+ */
+
+#include <string.h>
+
+#include "sched_policy.h"
+
+#define STRIDE1     (1u << 20)      /* stride = STRIDE1 / weight          */
+#define WFQ_SCALE   16              /* fixed-point scale for wfq tags     */
+
+static int      rr_index     = 0;   /* round-robin cursor for ties        */
+static uint64_t stride_pass  = 0;   /* global pass of the stride policy   */
+static uint64_t wfq_vtime    = 0;   /* wfq system virtual time            */
+static uint64_t lottery_rng  = 1;   /* xorshift64* state                  */
+
+int sched_policy_weight(int priority)
+{
+    int w = 16 - priority;
+    return w > 0 ? w : 1;
+}
+
+void sched_policy_seed(uint64_t seed)
+{
+    lottery_rng = seed ? seed : 1;
+}
+
+static int runnable(const Task *t)
+{
+    return t->is_active == 1;
+}
+
+/* Lane with the smallest key, round-robin among equal keys. */
+static int pick_min(Task_List *tl, uint64_t (*key)(const Task *))
+{
+    int n = tl->task_buffer_size;
+    int chosen = -1;
+    uint64_t best = UINT64_MAX;
+
+    for (int k = 0; k < n; k++) {
+        int i = (rr_index + k) % n;
+        const Task *t = &tl->task_buffer[i];
+        if (runnable(t) && (chosen < 0 || key(t) < best)) {
+            best   = key(t);
+            chosen = i;
+        }
+    }
+    if (chosen >= 0)
+        rr_index = (chosen + 1) % n;
+    return chosen;
+}
+
+static void nop_enqueue (Task_List *tl, int lane, int now) { (void)tl; (void)lane; (void)now; }
+static void nop_tick    (Task_List *tl, int lane, int now, uint64_t cost_ns)
+                        { (void)tl; (void)lane; (void)now; (void)cost_ns; }
+static void nop_complete(Task_List *tl, int lane, int now) { (void)tl; (void)lane; (void)now; }
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  prio — lowest priority value, round-robin among ties
+ * ═══════════════════════════════════════════════════════════════════════ */
+static uint64_t prio_key(const Task *t)
+{
+    return (uint64_t)(int64_t)t->priority + ((uint64_t)1 << 63);
+}
+
+static int prio_pick(Task_List *tl, int now)
+{
+    (void)now;
+    return pick_min(tl, prio_key);
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  edf — earliest deadline first
+ *
+ *  The deadline itself is armed by the scheduler (deadline_arm) from
+ *  the lane's link-up budget, so edf has no state of its own.
+ * ═══════════════════════════════════════════════════════════════════════ */
+static uint64_t edf_key(const Task *t)
+{
+    return (uint64_t)(uint32_t)t->deadline;
+}
+
+static int edf_pick(Task_List *tl, int now)
+{
+    (void)now;
+    return pick_min(tl, edf_key);
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  stride — deterministic proportional share
+ * ═══════════════════════════════════════════════════════════════════════ */
+static void stride_enqueue(Task_List *tl, int lane, int now)
+{
+    (void)now;
+    Task *t = &tl->task_buffer[lane];
+    /* join at the current global pass so a new lane cannot monopolise */
+    if (t->vstart < stride_pass)
+        t->vstart = stride_pass;
+}
+
+static uint64_t pass_key(const Task *t)
+{
+    return t->vstart;
+}
+
+static int stride_pick(Task_List *tl, int now)
+{
+    (void)now;
+    int lane = pick_min(tl, pass_key);
+    if (lane >= 0)
+        stride_pass = tl->task_buffer[lane].vstart;
+    return lane;
+}
+
+static void stride_tick(Task_List *tl, int lane, int now, uint64_t cost_ns)
+{
+    (void)now; (void)cost_ns;
+    Task *t = &tl->task_buffer[lane];
+    t->vstart += STRIDE1 / (uint64_t)t->weight;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  wfq — weighted fair queuing with start-time tags
+ *
+ *  A lane's tags advance by the CPU time its step actually used divided
+ *  by its weight, so an expensive INIT step is charged for what it cost
+ *  instead of counting as one quantum.
+ * ═══════════════════════════════════════════════════════════════════════ */
+static void wfq_enqueue(Task_List *tl, int lane, int now)
+{
+    (void)now;
+    Task *t = &tl->task_buffer[lane];
+    t->vstart = t->vfinish > wfq_vtime ? t->vfinish : wfq_vtime;
+}
+
+static int wfq_pick(Task_List *tl, int now)
+{
+    (void)now;
+    int lane = pick_min(tl, pass_key);
+    if (lane >= 0)
+        wfq_vtime = tl->task_buffer[lane].vstart;
+    return lane;
+}
+
+static void wfq_tick(Task_List *tl, int lane, int now, uint64_t cost_ns)
+{
+    (void)now;
+    Task *t = &tl->task_buffer[lane];
+    t->vfinish = t->vstart + cost_ns * WFQ_SCALE / (uint64_t)t->weight;
+    t->vstart  = t->vfinish;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  lottery — randomised proportional share
+ * ═══════════════════════════════════════════════════════════════════════ */
+static uint64_t lottery_next(void)
+{
+    lottery_rng ^= lottery_rng >> 12;
+    lottery_rng ^= lottery_rng << 25;
+    lottery_rng ^= lottery_rng >> 27;
+    return lottery_rng * 0x2545F4914F6CDD1Dull;
+}
+
+static int lottery_pick(Task_List *tl, int now)
+{
+    (void)now;
+    uint64_t total = 0;
+    for (int i = 0; i < tl->task_buffer_size; i++)
+        if (runnable(&tl->task_buffer[i]))
+            total += (uint64_t)tl->task_buffer[i].weight;
+    if (total == 0)
+        return -1;
+
+    uint64_t ticket = lottery_next() % total;
+    for (int i = 0; i < tl->task_buffer_size; i++) {
+        const Task *t = &tl->task_buffer[i];
+        if (!runnable(t)) continue;
+        if (ticket < (uint64_t)t->weight)
+            return i;
+        ticket -= (uint64_t)t->weight;
+    }
+    return -1;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Registry
+ * ═══════════════════════════════════════════════════════════════════════ */
+static const SchedPolicy policies[] = {
+    { "prio",    nop_enqueue,    prio_pick,    nop_tick,    nop_complete },
+    { "edf",     nop_enqueue,    edf_pick,     nop_tick,    nop_complete },
+    { "stride",  stride_enqueue, stride_pick,  stride_tick, nop_complete },
+    { "wfq",     wfq_enqueue,    wfq_pick,     wfq_tick,    nop_complete },
+    { "lottery", nop_enqueue,    lottery_pick, nop_tick,    nop_complete },
+};
+
+const SchedPolicy *sched_policy_find(const char *name)
+{
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+        if (strcmp(policies[i].name, name) == 0)
+            return &policies[i];
+    return NULL;
+}
+
+void sched_policy_usage(FILE *fp)
+{
+    fprintf(fp, "  -P   scheduling policy:");
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+        fprintf(fp, " %s", policies[i].name);
+    fprintf(fp, " (default prio)\n");
+}
@@ -0,0 +1,50 @@
+#ifndef SCHED_POLICY_H
+#define SCHED_POLICY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "task.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Pluggable scheduling policies
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  The scheduler loop only ever asks the policy which lane to run next.
+ *
+ *  enqueue(tl, lane, now)        Lane became runnable (added or reset).
+ *  pick(tl, now)                 Lane to run this tick, -1 if none.
+ *  tick(tl, lane, now, cost_ns)  The picked lane ran one step that took
+ *                                cost_ns of CPU time.
+ *  on_complete(tl, lane, now)    Lane finished (DONE) or was removed.
+ *
+ *  Available policies:
+ *    prio     lowest priority value first, round-robin among ties
+ *    edf      earliest deadline first (deadline = enqueue + budget)
+ *    stride   stride scheduling, one pass unit per step
+ *    wfq      weighted fair queuing on measured step cost
+ *    lottery  proportional-share lottery over weights
+ */
+typedef struct {
+    const char *name;
+    void (*enqueue)    (Task_List *tl, int lane, int now);
+    int  (*pick)       (Task_List *tl, int now);
+    void (*tick)       (Task_List *tl, int lane, int now, uint64_t cost_ns);
+    void (*on_complete)(Task_List *tl, int lane, int now);
+} SchedPolicy;
+
+/* Spacing of the default link-up budgets between priority levels, in
+ * ticks (≈ one lane's full CTLE + RX training when it has the CPU to
+ * itself); a lane with priority p gets p units on top of a full run per
+ * lane unless -D sets a budget. */
+#define EDF_DEADLINE_UNIT   4096
+
+/* Weight used by the proportional-share policies for a given priority
+ * (lower priority value → larger share). */
+int sched_policy_weight(int priority);
+
+const SchedPolicy *sched_policy_find(const char *name);
+void               sched_policy_seed(uint64_t seed);
+void               sched_policy_usage(FILE *fp);
+
+#endif /* SCHED_POLICY_H */
@@ -0,0 +1,99 @@
+#ifndef SCHED_TRACE_H
+#define SCHED_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "lane_log.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Binary scheduler trace
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  A trace is the lane_log record stream, re-encoded into 8-byte words:
+ *
+ *    file header   "RVSTRC01" + u32 version + u32 word size
+ *    record        one header word + a fixed number of payload words
+ *                  for its type
+ *
+ *  Header word:  u8 type | u8 aux | u16 lane | u32 arg
+ *
+ *  The common case — one scheduler step of a lane — is a single
+ *  TR_STEP word holding 16-bit deltas of tick and pt against the lane's
+ *  previous record.  A TR_KEY keyframe (absolute tick, pt, N_samp) is
+ *  written whenever a delta does not fit, the phase or N_samp changes,
+ *  or TRACE_KEY_INTERVAL steps have passed since the lane's last key.
+ *  Strings (channel path, command formats) are interned once with
+ *  TR_STR and referenced by id.
+ */
+
+#define TRACE_MAGIC         "RVSTRC01"
+#define TRACE_VERSION       1
+#define TRACE_KEY_INTERVAL  256
+#define TRACE_MAX_STRINGS   256
+#define TRACE_MAX_LANES     65536
+#define TRACE_AUX_PRIO      0x80    /* step is followed by a TR_PRIO word */
+
+typedef enum {
+    TR_KEY = 1,       /* aux=phase  arg=tick   +1: pt, n_samp          */
+    TR_STEP,          /* aux=phase  arg=dtick:16 | dpt:16              */
+    TR_PRIO,          /* arg=priority; follows a KEY/STEP whose aux
+                         has TRACE_AUX_PRIO set                        */
+    TR_GRID,          /* arg=tick   +1: old,new  +5 doubles            */
+    TR_RX_PROGRESS,   /* arg=tick   +1: pct      +2 doubles            */
+    TR_VEC,           /* aux=vec id arg=tick  +1: start,total  +n dbl  */
+    TR_TRANS,         /* aux=prev   arg=tick  +1: next                 */
+    TR_TRANS_INIT,    /* arg=tick   +1: L,rate  +1: instant,lag
+                                    +1: Fs  +1: file str id            */
+    TR_TRANS_CTLE,    /* arg=tick   +3 doubles                         */
+    TR_TRANS_END,     /* arg=tick                                      */
+    TR_TEXT,          /* arg=tick   +1: fmt id, a0  +1: a1, a2         */
+    TR_STR            /* arg=id     +1: len  +ceil(len/8) words        */
+} TraceType;
+
+typedef struct {
+    int32_t  pt, n_samp;
+    uint8_t  phase;
+    uint8_t  valid;
+    uint16_t since_key;
+} TraceLaneState;
+
+typedef struct {
+    FILE           *fp;
+    uint32_t        tick;           /* tick of the previous record       */
+    TraceLaneState *lanes;          /* [TRACE_MAX_LANES]                  */
+    const char     *strings[TRACE_MAX_STRINGS];
+    int             n_strings;
+    uint64_t        words;          /* payload words written              */
+} TraceWriter;
+
+typedef struct {
+    FILE           *fp;
+    uint32_t        tick;
+    TraceLaneState *lanes;
+    char           *strings[TRACE_MAX_STRINGS];
+} TraceReader;
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  API
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  trace_writer_open()   Write the file header; returns 0 on success.
+ *  trace_encode()        Append one lane_log record.
+ *  trace_writer_close()  Flush and release encoder state (fp stays open).
+ *
+ *  trace_reader_open()   Validate the header; returns 0 on success.
+ *  trace_read()          Decode the next record back into a LogRecord.
+ *                        Returns 1 on success, 0 at end of file and -1
+ *                        on a corrupt stream.
+ *  trace_reader_close()  Release decoder state.
+ */
+int  trace_writer_open (TraceWriter *tw, FILE *fp);
+void trace_encode      (TraceWriter *tw, const LogRecord *r);
+void trace_writer_close(TraceWriter *tw);
+
+int  trace_reader_open (TraceReader *tr, FILE *fp);
+int  trace_read        (TraceReader *tr, LogRecord *r);
+void trace_reader_close(TraceReader *tr);
+
+#endif /* SCHED_TRACE_H */
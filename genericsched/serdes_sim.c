@@ -6,21 +6,46 @@
  * State machine driven by the scheduler in sched.c:
  *
  *   INIT  →  CTLE  →  RX  →  DONE
+ *     └──→  ERROR   (channel file cannot be loaded; see chan_load.h)
  *
  *   lane_init()        →  allocate buffers, enter INIT (no DSP work)
- *   lane_step_init()   →  generate PRBS, build channel, run CDR → CTLE
+ *   lane_step_init()   →  one chunk of INIT: taps, CDR, PRBS → CTLE
  *   lane_step_ctle()   →  advance CTLE sweep by STEP_SIZE samples
  *   lane_step_rx()     →  advance RX FFE+DFE training by STEP_SIZE samples
- *   lane_soft_reset()  →  restart from INIT (keeps channel if loaded)
+ *   lane_soft_reset()  →  restart from INIT (channel asked for again)
  *   lane_destroy()     →  free heap memory
  *
  * TX FFE taps are pre-programmed (unit tap at pre-cursor position).
  */
 
-#include "serdes_sim.h"
+#include <errno.h>
 
-int lane_tick = 0;
-FILE *lane_logfp = NULL;
+#include "serdes_sim.h"
+#include "chan_load.h"
+#include "init_memo.h"
+#include "lane_log.h"
+#include "slab.h"
+
+int lane_console = 1;
+
+/* Carve lane contexts out of cache-line aligned slabs so lanes can come
+ * and go without heap churn and every hot block starts on a line.  The
+ * PRBS buffers (bits + bits_osf, 272 KiB a lane) come from a slab of
+ * their own, so a thousand lanes are a few dozen large chunks instead of
+ * two thousand separate heap blocks. */
+#define LANE_SLAB_CHUNK 16
+#define LANE_BITS_SIZE  ((size_t)N_BIT * (1 + OSF) * sizeof(double))
+static Slab lane_slab;
+static Slab bits_slab;
+static int  lane_slab_ready = 0;
+
+static void lane_slabs_init(void)
+{
+    if (lane_slab_ready) return;
+    slab_init(&lane_slab, sizeof(LaneContext), LANE_CACHE_LINE, LANE_SLAB_CHUNK);
+    slab_init(&bits_slab, LANE_BITS_SIZE, LANE_CACHE_LINE, LANE_SLAB_CHUNK);
+    lane_slab_ready = 1;
+}
 
 /* ═══════════════════════════════════════════════════════════════════════
  *  Utility helpers
@@ -87,20 +112,6 @@ double ctle_step(CTLEFilter *ctle, double x)
     return y;
 }
 
-int load_channel_taps(const char *filename, double *h_fir, int max_taps)
-{
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        fprintf(stderr, "ERROR: cannot open '%s'\n", filename);
-        return -1;
-    }
-    int L = 0;
-    while (L < max_taps && fscanf(fp, "%lf", &h_fir[L]) == 1)
-        L++;
-    fclose(fp);
-    return L;
-}
-
 double adc_quantize(double x, int B)
 {
     double clamped = x;
@@ -159,90 +170,216 @@ static double apply_tx_ffe(const LaneContext *ctx, int pt)
  * ═══════════════════════════════════════════════════════════════════════ */
 static double apply_channel(LaneContext *ctx, double sample_in)
 {
-    memmove(ctx->channel_buffer + 1, ctx->channel_buffer,
-            (ctx->L - 1) * sizeof(double));
-    ctx->channel_buffer[0] = sample_in;
+    double *line = ctx->channel_buffer;
+
+    if (ctx->cb_pos == 0) {
+        memcpy(line + ctx->L, line, (ctx->L - 1) * sizeof(double));
+        ctx->cb_pos = ctx->L;
+    }
+    double *win = line + --ctx->cb_pos;
+    win[0] = sample_in;
 
     double y = 0.0;
     for (int k = 0; k < ctx->L; k++)
-        y += ctx->h_fir[k] * ctx->channel_buffer[k];
+        y += ctx->h_fir[k] * win[k];
     return y;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════
- *  Internal: generate PAM-4 PRBS
- * ═══════════════════════════════════════════════════════════════════════ */
-static void generate_prbs(LaneContext *ctx)
+ *  Internal: size the channel block for L taps
+ * ═══════════════════════════════════════════════════════════════════════
+ *  h_fir[L] and channel_buffer[2L] share one aligned allocation, each
+ *  rounded up to whole cache lines.  One spare line between them keeps the two
+ *  arrays from sitting a power of two apart (the FIR loop reads both at
+ *  the same index, which would alias in L1).  Kept across reloads while
+ *  L fits.
+ */
+static int channel_reserve(LaneContext *ctx, int L)
 {
-    for (int i = 0; i < N_BIT; i++) {
-        int sym = rand() % NUM_LEVELS;
-        ctx->bits[i] = (2.0 * sym - (NUM_LEVELS - 1)) / (NUM_LEVELS - 1);
-        for (int j = 0; j < OSF; j++)
-            ctx->bits_osf[i * OSF + j] = ctx->bits[i];
-    }
+    const int per_line = LANE_CACHE_LINE / sizeof(double);
+    int cap = (L + per_line - 1) / per_line * per_line;
+
+    if (ctx->h_fir && cap <= ctx->taps_cap)
+        return 0;
+
+    double *block = aligned_alloc(LANE_CACHE_LINE,
+                                  (3 * cap + per_line) * sizeof(double));
+    if (!block)
+        return -1;
+    free(ctx->h_fir);
+    ctx->h_fir          = block;
+    ctx->channel_buffer = block + cap + per_line;
+    ctx->taps_cap       = cap;
+    return 0;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════
- *  Internal: run CDR
- * ═══════════════════════════════════════════════════════════════════════ */
-static void run_cdr(LaneContext *ctx)
+ *  Internal: resumable INIT sub-phases
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Each *_chunk() does at most one step's worth of work (see
+ *  STEP_SIZE in serdes_sim.h), keeps its position in init_pt, adds what
+ *  it did to init_work (for serdes_cycles) and returns nonzero when its
+ *  sub-phase is complete.  Together they compute exactly what the
+ *  former one-shot load, run_cdr() and PRBS did.
+ */
+#if LEN_CDR > N_BIT
+#error "the CDR edge trace is kept in bits_osf and needs LEN_CDR <= N_BIT"
+#endif
+
+static void begin_init_phase(LaneContext *ctx, InitPhase phase)
 {
-    int total_cdr = LEN_CDR * OSF;
+    ctx->init_phase = phase;
+    ctx->init_pt    = 0;
+}
 
-    double *cb = (double *)calloc(ctx->L, sizeof(double));
-    double *d_edge = (double *)malloc(total_cdr * sizeof(double));
+/* Work units per step for the scans and the PRBS: one CTLE/RX step's
+ * worth (STEP_SIZE samples through the L-tap channel) */
+static int init_budget(const LaneContext *ctx)
+{
+    return STEP_SIZE * ctx->L;
+}
 
-    double post_channel = 0.0;
+/* Taps from the I/O thread (chan_load.h) into the channel block: 1 when
+ * they are in h_fir, 0 while the load is in flight, -1 if it failed
+ * (ctx->load_err; ENOMEM if the block could not be sized). */
+static int load_chunk(LaneContext *ctx)
+{
+    static double taps[MAX_CHANNEL_TAPS];
+    int L;
+
+    if (!ctx->load_gen)
+        ctx->load_entry = chan_load_request(ctx->channel_file, &ctx->load_gen);
+
+    switch (chan_load_result(ctx->load_entry, ctx->load_gen, taps, &L,
+                             &ctx->load_err, &ctx->taps_version)) {
+        case CHAN_PENDING:
+            return 0;
+        case CHAN_READY:
+            ctx->load_gen = 0;
+            break;
+        default:
+            ctx->load_gen = 0;
+            return -1;
+    }
+    if (channel_reserve(ctx, L) != 0) {
+        ctx->load_err = ENOMEM;
+        return -1;
+    }
+    memcpy(ctx->h_fir, taps, L * sizeof(double));
+    ctx->L = L;
+    return 1;
+}
 
-    for (int pt = 0; pt < total_cdr; pt++) {
+/* Drive the CDR clock pattern (alternating symbols) through the channel
+ * and record the output's first difference in d_edge. */
+static int cdr_chunk(LaneContext *ctx)
+{
+    int     total_cdr = LEN_CDR * OSF;
+    double *d_edge    = ctx->bits_osf;
+
+    int end = ctx->init_pt + STEP_SIZE;
+    if (end > total_cdr) end = total_cdr;
+
+    for (int pt = ctx->init_pt; pt < end; pt++) {
         int sym_pair = pt / OSF;
         int clk_val  = (sym_pair % 2);
 
-        memmove(cb + 1, cb, (ctx->L - 1) * sizeof(double));
-        cb[0] = clk_val;
+        double post_prev = ctx->cdr_post;
+        ctx->cdr_post = apply_channel(ctx, clk_val);
+        d_edge[pt] = ctx->cdr_post - post_prev;
+    }
+    ctx->init_work = (uint64_t)(end - ctx->init_pt) * ctx->L;
+    ctx->init_pt = end;
+    return end >= total_cdr;
+}
 
-        double post_prev = post_channel;
-        post_channel = 0.0;
-        for (int k = 0; k < ctx->L; k++)
-            post_channel += ctx->h_fir[k] * cb[k];
+/* Zero crossings of d_edge, binned by sample phase (pt % OSF), and its
+ * maximum.  The most common phase is the sampling instant. */
+static int edges_chunk(LaneContext *ctx)
+{
+    int           total_cdr = LEN_CDR * OSF;
+    const double *d_edge    = ctx->bits_osf;
 
-        d_edge[pt] = post_channel - post_prev;
+    if (ctx->init_pt == 0) {
+        memset(ctx->cross_hist, 0, sizeof(ctx->cross_hist));
+        ctx->edge_max = -DBL_MAX;
     }
 
-    /* find zero crossings */
-    int *cross_raw = (int *)malloc(total_cdr * sizeof(int));
-    int  n_cross = 0;
-    for (int i = 0; i < total_cdr - 1; i++) {
-        if (d_edge[i] * d_edge[i + 1] <= 0.0) {
+    int end = ctx->init_pt + init_budget(ctx);
+    if (end > total_cdr) end = total_cdr;
+
+    for (int i = ctx->init_pt; i < end; i++) {
+        if (i < total_cdr - 1 && d_edge[i] * d_edge[i + 1] <= 0.0) {
             int zc = (fabs(d_edge[i]) <= fabs(d_edge[i + 1])) ? i : i + 1;
-            cross_raw[n_cross++] = zc;
+            ctx->cross_hist[zc % OSF]++;
+        }
+        if (!isnan(d_edge[i]) && d_edge[i] > ctx->edge_max)
+            ctx->edge_max = d_edge[i];
+    }
+    ctx->init_work = end - ctx->init_pt;
+    ctx->init_pt = end;
+    if (end < total_cdr)
+        return 0;
+
+    /* mode, lowest phase on ties (as int_mode() does) */
+    int best_cnt = 0;
+    ctx->sample_instant = 0;
+    for (int i = 0; i < OSF; i++) {
+        if (ctx->cross_hist[i] > best_cnt) {
+            best_cnt = ctx->cross_hist[i];
+            ctx->sample_instant = i;
         }
     }
+    return 1;
+}
 
-    int *cross_mod = (int *)malloc(n_cross * sizeof(int));
-    for (int i = 0; i < n_cross; i++)
-        cross_mod[i] = cross_raw[i] % OSF;
-    ctx->sample_instant = int_mode(cross_mod, n_cross);
+/* Lag: first edge above 0.8 of the maximum, less half the instant. */
+static int lag_chunk(LaneContext *ctx)
+{
+    int           total_cdr = LEN_CDR * OSF;
+    const double *d_edge    = ctx->bits_osf;
 
-    double d_max = -DBL_MAX;
-    for (int i = 0; i < total_cdr; i++)
-        if (!isnan(d_edge[i]) && d_edge[i] > d_max)
-            d_max = d_edge[i];
+    int end = ctx->init_pt + init_budget(ctx);
+    if (end > total_cdr) end = total_cdr;
 
-    int first_high = 0;
-    for (int i = 0; i < total_cdr; i++) {
-        if (!isnan(d_edge[i]) && d_edge[i] > d_max * 0.8) {
+    int first_high = -1;
+    for (int i = ctx->init_pt; i < end; i++) {
+        if (!isnan(d_edge[i]) && d_edge[i] > ctx->edge_max * 0.8) {
             first_high = i;
             break;
         }
     }
+    ctx->init_work = (first_high < 0 ? end : first_high + 1) - ctx->init_pt;
+    ctx->init_pt = end;
+    if (first_high < 0 && end < total_cdr)
+        return 0;
+
+    if (first_high < 0)
+        first_high = 0;
     ctx->lag = first_high -
                (int)round((double)ctx->sample_instant / 2.0);
+    return 1;
+}
+
+/* PAM-4 PRBS, symbol by symbol into bits and (held OSF times) bits_osf */
+static int prbs_chunk(LaneContext *ctx)
+{
+    int n = init_budget(ctx) / OSF;
+    if (n < 1) n = 1;
+
+    int end = ctx->init_pt + n;
+    if (end > N_BIT) end = N_BIT;
 
-    free(cross_raw);
-    free(cross_mod);
-    free(d_edge);
-    free(cb);
+    for (int i = ctx->init_pt; i < end; i++) {
+        int sym = rand() % NUM_LEVELS;
+        ctx->bits[i] = (2.0 * sym - (NUM_LEVELS - 1)) / (NUM_LEVELS - 1);
+        for (int j = 0; j < OSF; j++)
+            ctx->bits_osf[i * OSF + j] = ctx->bits[i];
+    }
+    ctx->init_work = (uint64_t)(end - ctx->init_pt) * OSF;
+    ctx->init_pt = end;
+    return end >= N_BIT;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════
@@ -250,7 +387,8 @@ static void run_cdr(LaneContext *ctx)
  * ═══════════════════════════════════════════════════════════════════════ */
 static void reset_signal_path(LaneContext *ctx)
 {
-    memset(ctx->channel_buffer, 0, ctx->L * sizeof(double));
+    memset(ctx->channel_buffer, 0, 2 * ctx->L * sizeof(double));
+    ctx->cb_pos = ctx->L;
     memset(ctx->rx_buffer, 0, sizeof(ctx->rx_buffer));
     memset(ctx->d_hist,    0, sizeof(ctx->d_hist));
 }
@@ -307,6 +445,10 @@ static void enter_rx_phase(LaneContext *ctx)
     ctx->mu_ffe  = 0.01;
     ctx->mu_dfe  = 0.005;
 
+    ctx->rx_err_acc = 0.0;
+    ctx->rx_err_cnt = 0;
+    ctx->rx_mse     = NAN;
+
     ctle_design(&ctx->ctle, ctx->Fs,
                 ctx->ctle_z, ctx->ctle_p, ctx->ctle_A);
 
@@ -331,19 +473,48 @@ void lane_init(LaneContext *ctx, int dataRateGbps, const char *channel_file)
     ctx->Fs           = (double)OSF * (double)dataRateGbps * 1e9;
     ctx->channel_file = channel_file;
 
-    ctx->bits     = (double *)malloc(N_BIT * sizeof(double));
-    ctx->bits_osf = (double *)malloc(N_BIT * OSF * sizeof(double));
+    lane_slabs_init();
+    ctx->bits     = slab_alloc(&bits_slab);
+    ctx->bits_osf = ctx->bits ? ctx->bits + N_BIT : NULL;
 
     /* pre-programmed TX FFE: unit tap at pre-cursor position */
     memset(ctx->TX_FFE, 0, sizeof(ctx->TX_FFE));
     ctx->TX_FFE[TX_FFE_PRE] = 1.0;
 }
 
+/* CDR results from the INIT memo, else run the CDR: at once, or once
+ * the lane already running it for the same key has put them (cdr_wait:
+ * ask again each step) */
+static void cdr_claim(LaneContext *ctx)
+{
+    int r = init_memo_cdr_get(ctx->taps_hash, ctx->L, ctx->dataRateGbps, ctx,
+                              &ctx->sample_instant, &ctx->lag);
+    ctx->cdr_wait = r == INIT_MEMO_WAIT;
+    if (r == INIT_MEMO_HIT) {
+        begin_init_phase(ctx, INIT_PRBS);
+        return;
+    }
+    if (r == INIT_MEMO_MISS) {
+        reset_signal_path(ctx);
+        ctx->cdr_post = 0.0;
+    }
+    begin_init_phase(ctx, INIT_CDR);
+}
+
 /* ── lane_step_init ───────────────────────────────────────────────────
- *  Generate PRBS, build default channel (if none loaded from file),
- *  run CDR, then transition → CTLE.
+ *  Advance INIT by one chunk of its current sub-phase:
  *
- *  Completes in a single call (CDR is inherently a batch operation).
+ *    INIT_LOAD → INIT_CDR → INIT_EDGES → INIT_LAG → INIT_PRBS → CTLE
+ *
+ *  INIT_LOAD only checks on the I/O thread (chan_load.h): it stays put
+ *  while the load is in flight and goes to ERROR if the file cannot be
+ *  loaded.  Once it has the taps (sizing the channel block to L) it
+ *  takes the CDR results from the INIT memo when another lane has
+ *  already locked to the same channel and rate (see init_memo.h), and
+ *  then goes straight to INIT_PRBS; while another lane is still running
+ *  that CDR it waits in INIT_CDR for the results instead.  Each other call costs about one
+ *  CTLE/RX step, so a lane in INIT never holds the scheduler for the
+ *  whole CDR.
  */
 void lane_step_init(LaneContext *ctx)
 {
@@ -352,32 +523,206 @@ void lane_step_init(LaneContext *ctx)
     /* recompute Fs in case dataRateGbps changed */
     ctx->Fs = (double)OSF * (double)ctx->dataRateGbps * 1e9;
 
-    /* load channel FIR taps from file */
-    int L = load_channel_taps(ctx->channel_file, ctx->h_fir, MAX_CHANNEL_TAPS);
-    if (L <= 0) {
-        fprintf(stderr, "lane_step_init: failed to load '%s'\n",
-                ctx->channel_file);
-        return;   /* stay in INIT — scheduler will retry */
-    }
-    ctx->L = L;
-
-    generate_prbs(ctx);
-    run_cdr(ctx);
+    switch (ctx->init_phase) {
+        case INIT_LOAD: {
+            int r = load_chunk(ctx);
+            ctx->init_work = r > 0 ? (uint64_t)ctx->L : 0;
+            if (r < 0) {
+                ctx->state = ERROR;   /* until 'r' asks for the file again */
+                return;
+            }
+            if (r == 0)
+                break;
 
-    enter_ctle_phase(ctx);
+            /* the PRBS is per lane; CDR only depends on channel and rate */
+            ctx->taps_hash = init_memo_hash(ctx->channel_file, ctx->load_entry,
+                                            ctx->taps_version, ctx->h_fir, ctx->L);
+            cdr_claim(ctx);
+            break;
+        }
+        case INIT_CDR:
+            if (ctx->cdr_wait) {
+                ctx->init_work = 0;
+                cdr_claim(ctx);
+            } else if (cdr_chunk(ctx))
+                begin_init_phase(ctx, INIT_EDGES);
+            break;
+        case INIT_EDGES:
+            if (edges_chunk(ctx))
+                begin_init_phase(ctx, INIT_LAG);
+            break;
+        case INIT_LAG:
+            if (lag_chunk(ctx)) {
+                init_memo_cdr_put(ctx->taps_hash, ctx->L, ctx->dataRateGbps, ctx,
+                                  ctx->sample_instant, ctx->lag);
+                begin_init_phase(ctx, INIT_PRBS);
+            }
+            break;
+        case INIT_PRBS:
+            if (prbs_chunk(ctx)) {
+                begin_init_phase(ctx, INIT_LOAD);
+                enter_ctle_phase(ctx);
+            }
+            break;
+    }
 }
 
 /* ── lane_soft_reset ──────────────────────────────────────────────────
- *  Restart link training from INIT.  Keeps loaded channel taps (if any)
- *  so CDR and training re-run against the same channel.
+ *  Restart link training from INIT, at its first sub-phase: the channel
+ *  is asked for again (the loader re-reads it only if it changed, and
+ *  answers from its cached failure while backing off), so a lane in
+ *  ERROR retries and an edited tap file takes effect.
  */
 void lane_soft_reset(LaneContext *ctx)
 {
+    ctx->load_gen = 0;    /* ask for the file afresh */
+    init_memo_cdr_drop(ctx);
+    ctx->cdr_wait = 0;
+    begin_init_phase(ctx, INIT_LOAD);
+
     /* reset TX FFE to pre-programmed values */
     memset(ctx->TX_FFE, 0, sizeof(ctx->TX_FFE));
     ctx->TX_FFE[TX_FFE_PRE] = 1.0;
 
     ctx->state = INIT;
+    ctx->coro_line = 0;
+}
+
+/* ── CTLE / RX per-sample work ────────────────────────────────────────
+ *  Shared by the state machine below and by the coroutine in
+ *  lane_train(); inlined into both loops.
+ */
+static inline void ctle_sample(LaneContext *ctx, int pt)
+{
+    double tx_out = apply_tx_ffe(ctx, pt);
+    double post_ch = apply_channel(ctx, tx_out);
+    post_ch = ctle_step(&ctx->ctle, post_ch);
+
+    if (pt % OSF == ctx->sample_instant &&
+        (pt - ctx->lag - TX_FFE_PRE * OSF > 0))
+    {
+        int lag_idx = pt - ctx->lag;
+        if (lag_idx > 0 && lag_idx < N_BIT * OSF) {
+            double desired   = ctx->bits_osf[lag_idx];
+            double bit_error = desired - post_ch;
+
+            if (!ctx->ctle_train_done) {
+                ctx->ctle_cnt++;
+                ctx->err_acc += bit_error * bit_error;
+
+                if (ctx->ctle_cnt == CTLE_WINDOW) {
+                    ctx->J[ctx->ia][ctx->iz] =
+                        ctx->err_acc / CTLE_WINDOW;
+                    ctx->ctle_cnt = 0;
+                    ctx->err_acc  = 0.0;
+
+                    ctx->ia++;
+                    if (ctx->ia >= CTLE_NA) {
+                        ctx->ia = 0;
+                        ctx->iz++;
+                    }
+                    if (ctx->iz >= CTLE_NZ) {
+                        /* sweep complete — pick best */
+                        double best_J = 1e30;
+                        int ia_best = 0, iz_best = 0;
+                        for (int a = 0; a < CTLE_NA; a++)
+                            for (int z = 0; z < CTLE_NZ; z++)
+                                if (ctx->J[a][z] < best_J) {
+                                    best_J  = ctx->J[a][z];
+                                    ia_best = a;
+                                    iz_best = z;
+                                }
+                        ctx->ctle_A = ctx->A_vec[ia_best];
+                        ctx->ctle_z = ctx->z_vec[iz_best];
+                        ctle_design(&ctx->ctle, ctx->Fs,
+                                    ctx->ctle_z, ctx->ctle_p,
+                                    ctx->ctle_A);
+                        ctx->ctle_train_done = 1;
+                    } else {
+                        ctx->ctle_A = ctx->A_vec[ctx->ia];
+                        ctx->ctle_z = ctx->z_vec[ctx->iz];
+                        ctle_design(&ctx->ctle, ctx->Fs,
+                                    ctx->ctle_z, ctx->ctle_p,
+                                    ctx->ctle_A);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Sweep finished or samples exhausted: settle on the best point → RX. */
+static void ctle_finish(LaneContext *ctx)
+{
+    if (!ctx->ctle_train_done) {
+        double best_J = 1e30;
+        int ia_best = 0, iz_best = 0;
+        for (int a = 0; a < CTLE_NA; a++)
+            for (int z = 0; z < CTLE_NZ; z++)
+                if (ctx->J[a][z] < best_J) {
+                    best_J  = ctx->J[a][z];
+                    ia_best = a;
+                    iz_best = z;
+                }
+        ctx->ctle_A = ctx->A_vec[ia_best];
+        ctx->ctle_z = ctx->z_vec[iz_best];
+    }
+    enter_rx_phase(ctx);
+}
+
+static inline void rx_sample(LaneContext *ctx, int pt)
+{
+    double tx_out = apply_tx_ffe(ctx, pt);
+    double post_ch = apply_channel(ctx, tx_out);
+    post_ch = ctle_step(&ctx->ctle, post_ch);
+    post_ch = adc_quantize(post_ch, ADC_BITS);
+
+    memmove(ctx->rx_buffer + 1, ctx->rx_buffer,
+            (RX_FFE_LEN - 1) * sizeof(double));
+    ctx->rx_buffer[0] = post_ch;
+
+    if (pt % OSF == ctx->sample_instant && (pt - ctx->lag > 0)) {
+
+        double y_ffe = 0.0;
+        for (int k = 0; k < RX_FFE_LEN; k++)
+            y_ffe += ctx->RX_FFE[k] * ctx->rx_buffer[k];
+
+        double y = y_ffe;
+        if (ctx->en_DFE) {
+            for (int k = 0; k < N_DFE; k++)
+                y -= ctx->DFE[k] * ctx->d_hist[k];
+        }
+
+        double d_hat = (y < 0.0) ? -1.0 : 1.0;
+
+        int lag_idx = pt - ctx->lag;
+        if (lag_idx >= 0 && lag_idx < N_BIT * OSF) {
+            double desired   = ctx->bits_osf[lag_idx];
+            double bit_error = desired - y;
+
+            ctx->rx_err_acc += bit_error * bit_error;
+            if (++ctx->rx_err_cnt == RX_MSE_WINDOW) {
+                ctx->rx_mse     = ctx->rx_err_acc / RX_MSE_WINDOW;
+                ctx->rx_err_acc = 0.0;
+                ctx->rx_err_cnt = 0;
+            }
+
+            for (int k = 0; k < RX_FFE_LEN; k++)
+                ctx->RX_FFE[k] += ctx->mu_ffe * bit_error *
+                                  ctx->rx_buffer[k];
+
+            if (ctx->en_DFE) {
+                for (int k = 0; k < N_DFE; k++)
+                    ctx->DFE[k] -= ctx->mu_dfe * bit_error *
+                                    ctx->d_hist[k];
+            }
+        }
+
+        if (N_DFE > 0)
+            memmove(ctx->d_hist + 1, ctx->d_hist,
+                    (N_DFE - 1) * sizeof(double));
+        ctx->d_hist[0] = d_hat;
+    }
 }
 
 /* ── lane_step_ctle ───────────────────────────────────────────────────
@@ -392,83 +737,12 @@ void lane_step_ctle(LaneContext *ctx)
     int end = ctx->pt + STEP_SIZE;
     if (end > ctx->N_samp) end = ctx->N_samp;
 
-    for (; ctx->pt < end; ctx->pt++) {
-        int pt = ctx->pt;
-
-        double tx_out = apply_tx_ffe(ctx, pt);
-        double post_ch = apply_channel(ctx, tx_out);
-        post_ch = ctle_step(&ctx->ctle, post_ch);
-
-        if (pt % OSF == ctx->sample_instant &&
-            (pt - ctx->lag - TX_FFE_PRE * OSF > 0))
-        {
-            int lag_idx = pt - ctx->lag;
-            if (lag_idx > 0 && lag_idx < N_BIT * OSF) {
-                double desired   = ctx->bits_osf[lag_idx];
-                double bit_error = desired - post_ch;
-
-                if (!ctx->ctle_train_done) {
-                    ctx->ctle_cnt++;
-                    ctx->err_acc += bit_error * bit_error;
-
-                    if (ctx->ctle_cnt == CTLE_WINDOW) {
-                        ctx->J[ctx->ia][ctx->iz] =
-                            ctx->err_acc / CTLE_WINDOW;
-                        ctx->ctle_cnt = 0;
-                        ctx->err_acc  = 0.0;
-
-                        ctx->ia++;
-                        if (ctx->ia >= CTLE_NA) {
-                            ctx->ia = 0;
-                            ctx->iz++;
-                        }
-                        if (ctx->iz >= CTLE_NZ) {
-                            /* sweep complete — pick best */
-                            double best_J = 1e30;
-                            int ia_best = 0, iz_best = 0;
-                            for (int a = 0; a < CTLE_NA; a++)
-                                for (int z = 0; z < CTLE_NZ; z++)
-                                    if (ctx->J[a][z] < best_J) {
-                                        best_J  = ctx->J[a][z];
-                                        ia_best = a;
-                                        iz_best = z;
-                                    }
-                            ctx->ctle_A = ctx->A_vec[ia_best];
-                            ctx->ctle_z = ctx->z_vec[iz_best];
-                            ctle_design(&ctx->ctle, ctx->Fs,
-                                        ctx->ctle_z, ctx->ctle_p,
-                                        ctx->ctle_A);
-                            ctx->ctle_train_done = 1;
-                        } else {
-                            ctx->ctle_A = ctx->A_vec[ctx->ia];
-                            ctx->ctle_z = ctx->z_vec[ctx->iz];
-                            ctle_design(&ctx->ctle, ctx->Fs,
-                                        ctx->ctle_z, ctx->ctle_p,
-                                        ctx->ctle_A);
-                        }
-                    }
-                }
-            }
-        }
-    }
+    for (; ctx->pt < end; ctx->pt++)
+        ctle_sample(ctx, ctx->pt);
 
     /* Transition when sweep finished or samples exhausted */
-    if (ctx->ctle_train_done || ctx->pt >= ctx->N_samp) {
-        if (!ctx->ctle_train_done) {
-            double best_J = 1e30;
-            int ia_best = 0, iz_best = 0;
-            for (int a = 0; a < CTLE_NA; a++)
-                for (int z = 0; z < CTLE_NZ; z++)
-                    if (ctx->J[a][z] < best_J) {
-                        best_J  = ctx->J[a][z];
-                        ia_best = a;
-                        iz_best = z;
-                    }
-            ctx->ctle_A = ctx->A_vec[ia_best];
-            ctx->ctle_z = ctx->z_vec[iz_best];
-        }
-        enter_rx_phase(ctx);
-    }
+    if (ctx->ctle_train_done || ctx->pt >= ctx->N_samp)
+        ctle_finish(ctx);
 }
 
 /* ── lane_step_rx ─────────────────────────────────────────────────────
@@ -482,57 +756,80 @@ void lane_step_rx(LaneContext *ctx)
     int end = ctx->pt + STEP_SIZE;
     if (end > ctx->N_samp) end = ctx->N_samp;
 
-    for (; ctx->pt < end; ctx->pt++) {
-        int pt = ctx->pt;
-
-        double tx_out = apply_tx_ffe(ctx, pt);
-        double post_ch = apply_channel(ctx, tx_out);
-        post_ch = ctle_step(&ctx->ctle, post_ch);
-        post_ch = adc_quantize(post_ch, ADC_BITS);
+    for (; ctx->pt < end; ctx->pt++)
+        rx_sample(ctx, ctx->pt);
 
-        memmove(ctx->rx_buffer + 1, ctx->rx_buffer,
-                (RX_FFE_LEN - 1) * sizeof(double));
-        ctx->rx_buffer[0] = post_ch;
-
-        if (pt % OSF == ctx->sample_instant && (pt - ctx->lag > 0)) {
-
-            double y_ffe = 0.0;
-            for (int k = 0; k < RX_FFE_LEN; k++)
-                y_ffe += ctx->RX_FFE[k] * ctx->rx_buffer[k];
-
-            double y = y_ffe;
-            if (ctx->en_DFE) {
-                for (int k = 0; k < N_DFE; k++)
-                    y -= ctx->DFE[k] * ctx->d_hist[k];
-            }
+    if (ctx->pt >= ctx->N_samp)
+        ctx->state = DONE;
+}
 
-            double d_hat = (y < 0.0) ? -1.0 : 1.0;
+/* ── lane_train ───────────────────────────────────────────────────────
+ *  The same training as one straight-line stackless coroutine: INIT,
+ *  the CTLE sweep and RX adaptation in sequence, suspending after every
+ *  CORO_BUDGET samples.  Resuming is a jump to the last suspension
+ *  point, without the per-step phase dispatch and state checks of the
+ *  lane_step_*() path.  Anything live across a yield is kept in
+ *  LaneContext; coro_line is the resume point (0 → start).
+ *
+ *  With CORO_BUDGET == STEP_SIZE each resume does exactly the work of
+ *  one lane_step_*() call, so results and step counts are identical.
+ *  Returns 1 once the lane is DONE, -1 while it is in ERROR
+ *  (lane_soft_reset() starts the coroutine over).
+ */
+#define CORO_BUDGET     STEP_SIZE
 
-            int lag_idx = pt - ctx->lag;
-            if (lag_idx >= 0 && lag_idx < N_BIT * OSF) {
-                double desired   = ctx->bits_osf[lag_idx];
-                double bit_error = desired - y;
+#define CORO_BEGIN(c)   switch ((c)->coro_line) { case 0:
+#define CORO_YIELD(c)   do { (c)->coro_line = __LINE__; return 0; \
+                             case __LINE__:; } while (0)
+#define CORO_END(c)     } (c)->coro_line = 0
 
-                for (int k = 0; k < RX_FFE_LEN; k++)
-                    ctx->RX_FFE[k] += ctx->mu_ffe * bit_error *
-                                      ctx->rx_buffer[k];
+int lane_train(LaneContext *ctx)
+{
+    if (ctx->state == DONE)
+        return 1;
+    if (ctx->state == ERROR)
+        return -1;
 
-                if (ctx->en_DFE) {
-                    for (int k = 0; k < N_DFE; k++)
-                        ctx->DFE[k] -= ctx->mu_dfe * bit_error *
-                                        ctx->d_hist[k];
-                }
-            }
+    CORO_BEGIN(ctx);
 
-            if (N_DFE > 0)
-                memmove(ctx->d_hist + 1, ctx->d_hist,
-                        (N_DFE - 1) * sizeof(double));
-            ctx->d_hist[0] = d_hat;
-        }
+    /* INIT: one sub-phase chunk per resume (lane_step_init) */
+    for (;;) {
+        lane_step_init(ctx);
+        if (ctx->state == ERROR)
+            return -1;
+        if (ctx->state != INIT)
+            break;
+        CORO_YIELD(ctx);
+    }
+    CORO_YIELD(ctx);
+
+    /* CTLE sweep */
+    for (;;) {
+        int end = ctx->pt + CORO_BUDGET;
+        if (end > ctx->N_samp) end = ctx->N_samp;
+        for (; ctx->pt < end; ctx->pt++)
+            ctle_sample(ctx, ctx->pt);
+        if (ctx->ctle_train_done || ctx->pt >= ctx->N_samp)
+            break;
+        CORO_YIELD(ctx);
     }
+    ctle_finish(ctx);
+    CORO_YIELD(ctx);
+
+    /* RX FFE + DFE adaptation */
+    for (;;) {
+        int end = ctx->pt + CORO_BUDGET;
+        if (end > ctx->N_samp) end = ctx->N_samp;
+        for (; ctx->pt < end; ctx->pt++)
+            rx_sample(ctx, ctx->pt);
+        if (ctx->pt >= ctx->N_samp)
+            break;
+        CORO_YIELD(ctx);
+    }
+    ctx->state = DONE;
 
-    if (ctx->pt >= ctx->N_samp)
-        ctx->state = DONE;
+    CORO_END(ctx);
+    return 1;
 }
 
 /* ── lane_destroy ─────────────────────────────────────────────────────
@@ -540,10 +837,14 @@ void lane_step_rx(LaneContext *ctx)
  */
 void lane_destroy(LaneContext *ctx)
 {
-    free(ctx->bits);
-    free(ctx->bits_osf);
+    init_memo_cdr_drop(ctx);
+    slab_free(&bits_slab, ctx->bits);
+    free(ctx->h_fir);
     ctx->bits     = NULL;
     ctx->bits_osf = NULL;
+    ctx->h_fir    = NULL;
+    ctx->channel_buffer = NULL;
+    ctx->taps_cap = 0;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════
@@ -558,6 +859,10 @@ void print_lane_status(const LaneContext *l)
     if (l->state == CTLE || l->state == RX || l->state == DONE)
         printf(" | CDR instant=%d lag=%d", l->sample_instant, l->lag);
 
+    if (l->state == ERROR)
+        printf(" | cannot load '%s': %s", l->channel_file,
+               l->load_err ? strerror(l->load_err) : "no taps");
+
     if (l->state == CTLE)
         printf(" | sweep [%d,%d]/%d", l->ia + l->iz * CTLE_NA,
                CTLE_NA * CTLE_NZ, CTLE_NA * CTLE_NZ);
@@ -583,100 +888,70 @@ const char *state_name(LaneState s)
         case CTLE: return "CTLE";
         case RX:   return "RX";
         case DONE: return "DONE";
+        case ERROR: return "ERROR";
     }
     return "?";
 }
 
-void generic_lane_init(void **p_ctx, void *args)
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Scheduler task kind: SerDes lane
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static void *serdes_create(const void *args)
 {
-    *p_ctx = malloc(sizeof(LaneContext));
-    LaneContext *lane_ctx = (LaneContext *)*p_ctx;
-    LaneInitArgs *init_args = (LaneInitArgs *)args;
+    const LaneInitArgs *init_args = (const LaneInitArgs *)args;
+
+    lane_slabs_init();
+    LaneContext *lane_ctx = slab_alloc(&lane_slab);
+    if (!lane_ctx) return NULL;
 
     lane_init(lane_ctx, init_args->dataRateGbps, init_args->channel_file);
+    if (!lane_ctx->bits) {
+        slab_free(&lane_slab, lane_ctx);
+        return NULL;
+    }
+    lane_ctx->id = init_args->id;
+    return lane_ctx;
 }
 
-// Returns 0 if the lane is still active; else, returns 1 if the lane is DONE
-int generic_lane_step(void *ctx, void *args)
+static void serdes_destroy(void *ctx)
 {
-    LaneContext *lane_ctx = (LaneContext *)ctx;
-    LaneStepArgs *step_args = (LaneStepArgs *)args;
-
-    LaneState prev = lane_ctx->state;
-    int prev_pt = lane_ctx->pt;
-    int prev_ia = lane_ctx->ia;
-    int prev_iz = lane_ctx->iz;
-
-    switch (step_args->flags) {
-        case SOFT_RESET:
-            lane_soft_reset(lane_ctx);
-            break;
-        case DATA_RATE_CHANGE:
-            lane_ctx->dataRateGbps = step_args->dataRateGbps;
-            break;
-        case PRINT_STATUS:
-            print_lane_status(lane_ctx);
-            break;
-        default:
-            if (lane_ctx->state == INIT) {
-                lane_step_init(lane_ctx);
-            }
-            else if (lane_ctx->state == CTLE) {
-                lane_step_ctle(lane_ctx);
-            }
-            else if (lane_ctx->state == RX) {
-                lane_step_rx(lane_ctx);
-            }
-    }
+    if (!ctx) return;
+    lane_destroy((LaneContext *)ctx);
+    slab_free(&lane_slab, ctx);
+}
 
-        /* ── Verbose file log: every step ── */
-    if (lane_logfp) {
-        fprintf(lane_logfp, "[tick %8d] Lane %2d  state=%-4s  pt=%d/%d\n",
-                lane_tick, lane_ctx->id, state_name(lane_ctx->state),
-                lane_ctx->pt, lane_ctx->N_samp);
-
-        /* CTLE sweep: log when a grid point completes (ia or iz advanced) */
-        if (lane_ctx->state == CTLE && prev == CTLE) {
-            int old_grid = prev_ia + prev_iz * CTLE_NA;
-            int new_grid = lane_ctx->ia + lane_ctx->iz * CTLE_NA;
-            if (new_grid != old_grid) {
-                fprintf(lane_logfp, "             Lane %2d  CTLE sweep: completed grid [%d/%d]"
-                        "  A=%.4f z=%.3e  MSE=%.6f\n",
-                        lane_ctx->id, old_grid + 1, CTLE_NA * CTLE_NZ,
-                        lane_ctx->A_vec[prev_ia], lane_ctx->z_vec[prev_iz],
-                        lane_ctx->J[prev_ia][prev_iz]);
-                fprintf(lane_logfp, "             Lane %2d  CTLE sweep: now testing [%d/%d]"
-                        "  A=%.4f z=%.3e\n",
-                        lane_ctx->id, new_grid + 1, CTLE_NA * CTLE_NZ,
-                        lane_ctx->ctle_A, lane_ctx->ctle_z);
-            }
-        }
+void lane_slabs_free(void)
+{
+    if (!lane_slab_ready) return;
+    slab_destroy(&lane_slab);
+    slab_destroy(&bits_slab);
+    lane_slab_ready = 0;
+}
 
-        /* RX progress: log taps every 25% */
-        if (lane_ctx->state == RX && prev == RX) {
-            int quarter = lane_ctx->N_samp / 4;
-            if (quarter > 0 && prev_pt / quarter != lane_ctx->pt / quarter) {
-                int pct = (lane_ctx->pt * 100) / lane_ctx->N_samp;
-                fprintf(lane_logfp, "             Lane %2d  RX training %d%%  RX_FFE[main]=%.6f"
-                        "  DFE[0]=%.6f\n",
-                        lane_ctx->id, pct,
-                        lane_ctx->RX_FFE[RX_FFE_PRE], lane_ctx->DFE[0]);
-                fprintf(lane_logfp, "               RX_FFE = [");
-                for (int k = 0; k < RX_FFE_LEN; k++)
-                    fprintf(lane_logfp, "%s%+.6f", k ? ", " : "", lane_ctx->RX_FFE[k]);
-                fprintf(lane_logfp, "]\n");
-            }
-        }
-    }
+/* Log what one step or command did; on a state change also print the
+ * concise console line. */
+static void serdes_report(const LaneContext *lane_ctx, LaneState prev,
+                          int prev_pt, int prev_ia, int prev_iz)
+{
+    /* ── Verbose file log: every step (queued, formatted off-thread) ── */
+    lane_log_step(task_tick, lane_ctx->id, lane_ctx);
+    lane_log_progress(task_tick, lane_ctx->id, lane_ctx,
+                      prev, prev_pt, prev_ia, prev_iz);
 
-    /* ── State transition: console + file ── */
-    if (lane_ctx->state != prev) {
+    if (lane_ctx->state == prev)
+        return;
 
-        /* --- Console (concise) --- */
+    /* ── State transition: console (concise; off in bench mode) ── */
+    if (lane_console) {
         printf("[Lane %2d] %s → %s", lane_ctx->id,
                state_name(prev), state_name(lane_ctx->state));
 
-        if (prev == INIT)
+        if (prev == INIT && lane_ctx->state == ERROR)
+            printf("  (cannot load '%s': %s; 'r %d' retries)", lane_ctx->channel_file,
+                   lane_ctx->load_err ? strerror(lane_ctx->load_err) : "no taps",
+                   lane_ctx->id);
+        else if (prev == INIT)
             printf("  (loaded %d taps, CDR instant=%d lag=%d)",
                    lane_ctx->L, lane_ctx->sample_instant, lane_ctx->lag);
 
@@ -695,65 +970,191 @@ int generic_lane_step(void *ctx, void *args)
         }
         printf("\n");
         fflush(stdout);
+    }
 
-        /* --- Log file (verbose) --- */
-        if (lane_logfp) {
-            fprintf(lane_logfp, "========== Lane %2d TRANSITION: %s → %s (tick %d) ==========\n",
-                    lane_ctx->id, state_name(prev), state_name(lane_ctx->state), lane_tick);
-
-            if (prev == INIT) {
-                fprintf(lane_logfp, "  Channel:  %s (%d taps)\n",
-                        lane_ctx->channel_file, lane_ctx->L);
-                fprintf(lane_logfp, "  Data rate: %d Gbps  Fs=%.3e Hz\n",
-                        lane_ctx->dataRateGbps, lane_ctx->Fs);
-                fprintf(lane_logfp, "  CDR:       sample_instant=%d  lag=%d\n",
-                        lane_ctx->sample_instant, lane_ctx->lag);
-                fprintf(lane_logfp, "  TX FFE:    [");
-                for (int k = 0; k < TX_FFE_LEN; k++)
-                    fprintf(lane_logfp, "%s%+.6f", k ? ", " : "", lane_ctx->TX_FFE[k]);
-                fprintf(lane_logfp, "]\n");
-            }
+    /* ── … and file (verbose) ── */
+    lane_log_transition(task_tick, lane_ctx->id, lane_ctx, prev);
+}
 
-            if (prev == CTLE) {
-                fprintf(lane_logfp, "  Best CTLE: A=%.6f  z=%.6e  p=%.6e\n",
-                        lane_ctx->ctle_A, lane_ctx->ctle_z, lane_ctx->ctle_p);
-                fprintf(lane_logfp, "  Sweep MSE grid (A rows x z cols):\n");
-                for (int a = 0; a < CTLE_NA; a++) {
-                    fprintf(lane_logfp, "    A=%.4f |", lane_ctx->A_vec[a]);
-                    for (int z = 0; z < CTLE_NZ; z++) {
-                        if (lane_ctx->J[a][z] < 1e20)
-                            fprintf(lane_logfp, " %10.6f", lane_ctx->J[a][z]);
-                        else
-                            fprintf(lane_logfp, "        N/A");
-                    }
-                    fprintf(lane_logfp, "\n");
-                }
-            }
+// Returns 0 if the lane is still active; else, returns 1 if the lane is DONE
+// and -1 if it is in ERROR
+static int serdes_step(void *ctx)
+{
+    LaneContext *lane_ctx = (LaneContext *)ctx;
 
-            if (prev == RX) {
-                fprintf(lane_logfp, "  RX FFE taps (%d total):\n", RX_FFE_LEN);
-                for (int k = 0; k < RX_FFE_LEN; k++)
-                    fprintf(lane_logfp, "    RX_FFE[%2d] = %+.8f%s\n", k, lane_ctx->RX_FFE[k],
-                            k == RX_FFE_PRE ? "  <-- main cursor" : "");
-                fprintf(lane_logfp, "  DFE taps (%d total):\n", N_DFE);
-                for (int k = 0; k < N_DFE; k++)
-                    fprintf(lane_logfp, "    DFE[%d]    = %+.8f\n", k, lane_ctx->DFE[k]);
-            }
+    LaneState prev = lane_ctx->state;
+    int prev_pt = lane_ctx->pt;
+    int prev_ia = lane_ctx->ia;
+    int prev_iz = lane_ctx->iz;
 
-            fprintf(lane_logfp, "==========================================================\n");
-            fflush(lane_logfp);
-        }
+    switch (lane_ctx->state) {
+        case INIT: lane_step_init(lane_ctx); break;
+        case CTLE: lane_step_ctle(lane_ctx); break;
+        case RX:   lane_step_rx(lane_ctx);   break;
+        case DONE:
+        case ERROR: break;
+    }
+
+    serdes_report(lane_ctx, prev, prev_pt, prev_ia, prev_iz);
+    return lane_ctx->state == DONE ? 1 : lane_ctx->state == ERROR ? -1 : 0;
+}
+
+static int serdes_coro_step(void *ctx)
+{
+    LaneContext *lane_ctx = (LaneContext *)ctx;
+
+    LaneState prev = lane_ctx->state;
+    int prev_pt = lane_ctx->pt;
+    int prev_ia = lane_ctx->ia;
+    int prev_iz = lane_ctx->iz;
+
+    int done = lane_train(lane_ctx);
+
+    serdes_report(lane_ctx, prev, prev_pt, prev_ia, prev_iz);
+    return done;
+}
+
+static int serdes_command(void *ctx, TaskCommand cmd, int arg)
+{
+    LaneContext *lane_ctx = (LaneContext *)ctx;
+
+    LaneState prev = lane_ctx->state;
+    int prev_pt = lane_ctx->pt;
+    int prev_ia = lane_ctx->ia;
+    int prev_iz = lane_ctx->iz;
+
+    switch (cmd) {
+        case TASK_RESET:
+            lane_soft_reset(lane_ctx);
+            break;
+        case TASK_SET_RATE:
+            lane_ctx->dataRateGbps = arg;
+            break;
+        default:
+            return -1;
     }
-    return (lane_ctx->state == DONE) ? 1 : 0;
+
+    serdes_report(lane_ctx, prev, prev_pt, prev_ia, prev_iz);
+    return 0;
+}
+
+static void serdes_status(void *ctx)
+{
+    print_lane_status((const LaneContext *)ctx);
+}
+
+/* CTLE and RX each consume N_samp points, STEP_SIZE per step; the CTLE
+ * sweep may finish early, so this is an upper bound. */
+#define SERDES_PHASE_STEPS (((N_BIT - TX_FFE_POST) * OSF + STEP_SIZE - 1) / STEP_SIZE)
+
+/* INIT steps from sub-phase `from`, `pt` into it, for an L-tap channel:
+ * the CDR goes STEP_SIZE samples a step, the scans and the PRBS
+ * init_budget() units a step (the lag scan may stop early). */
+static int init_steps_left(InitPhase from, int pt, int L)
+{
+    int unit = STEP_SIZE * L;
+    int sym  = unit / OSF > 0 ? unit / OSF : 1;
+    const int total[] = { 1, LEN_CDR * OSF, LEN_CDR * OSF, LEN_CDR * OSF, N_BIT };
+    const int per[]   = { 1, STEP_SIZE, unit, unit, sym };
+
+    int left = 0;
+    for (int p = from; p <= INIT_PRBS; p++, pt = 0)
+        left += (total[p] - pt + per[p] - 1) / per[p];
+    return left;
 }
 
-void updateLaneTick()
+/* The channel length is not known before the load: assume a long one,
+ * where the scans and the PRBS take a step each and the CDR dominates. */
+static int serdes_full_work(void)
 {
-    lane_tick++;
+    return init_steps_left(INIT_LOAD, 0, MAX_CHANNEL_TAPS) + 2 * SERDES_PHASE_STEPS;
 }
 
-void setLogFile(FILE *fp)
+static int serdes_remaining(const void *ctx)
 {
-    lane_logfp = fp;
+    const int phase = SERDES_PHASE_STEPS;
+    const LaneContext *l = (const LaneContext *)ctx;
+
+    if (l->state == INIT)
+        return l->init_phase == INIT_LOAD ? serdes_full_work() :
+               init_steps_left(l->init_phase, l->init_pt, l->L) + 2 * phase;
+    if (l->state == DONE || l->state == ERROR)
+        return 0;
+
+    int left = (l->N_samp - l->pt + STEP_SIZE - 1) / STEP_SIZE;
+    if (left < 1) left = 1;
+    return l->state == CTLE ? left + phase : left;
+}
+
+static int serdes_phase(const void *ctx)
+{
+    return ((const LaneContext *)ctx)->state;
+}
+
+static const char *serdes_phase_name(int phase)
+{
+    return state_name((LaneState)phase);
+}
+
+static double serdes_mse(const void *ctx)
+{
+    const LaneContext *l = (const LaneContext *)ctx;
+    return (l->state == RX || l->state == DONE) ? l->rx_mse : NAN;
+}
+
+/* INIT: what the sub-phase chunk did (init_work: CDR MACs, scan
+ * entries, PRBS samples).  CTLE and RX: STEP_SIZE samples through TX
+ * FFE, channel and CTLE; RX adds the FFE/DFE output and update once per
+ * symbol. */
+static uint64_t serdes_cycles(const void *ctx, int phase)
+{
+    const LaneContext *l = (const LaneContext *)ctx;
+    uint64_t per_sample = (uint64_t)l->L + TX_FFE_LEN + FW_CTLE_MACS;
+    uint64_t c = FW_STEP_OVERHEAD;
+
+    switch (phase) {
+        case INIT:
+            c += l->init_work;
+            break;
+        case CTLE:
+            c += STEP_SIZE * per_sample;
+            break;
+        case RX:
+            c += STEP_SIZE * per_sample +
+                 (STEP_SIZE / OSF) * 2 * (RX_FFE_LEN + N_DFE);
+            break;
+    }
+    return c;
 }
 
+const TaskType serdes_lane_type = {
+    .name       = "serdes",
+    .create     = serdes_create,
+    .step       = serdes_step,
+    .command    = serdes_command,
+    .status     = serdes_status,
+    .destroy    = serdes_destroy,
+    .remaining  = serdes_remaining,
+    .full_work  = serdes_full_work,
+    .phase      = serdes_phase,
+    .phase_name = serdes_phase_name,
+    .n_phases   = DONE,
+    .quality    = serdes_mse,
+    .cycles     = serdes_cycles,
+};
+
+const TaskType serdes_coro_type = {
+    .name       = "serdes-coro",
+    .create     = serdes_create,
+    .step       = serdes_coro_step,
+    .command    = serdes_command,
+    .status     = serdes_status,
+    .destroy    = serdes_destroy,
+    .remaining  = serdes_remaining,
+    .full_work  = serdes_full_work,
+    .phase      = serdes_phase,
+    .phase_name = serdes_phase_name,
+    .n_phases   = DONE,
+    .quality    = serdes_mse,
+    .cycles     = serdes_cycles,
+};
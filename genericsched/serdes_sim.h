@@ -7,6 +7,9 @@
 #include <math.h>
 #include <float.h>
 #include <time.h>
+#include <stddef.h>
+
+#include "task.h"
 
 /* ═══════════════════════════════════════════════════════════════════════
  *  Compile-time parameters
@@ -36,6 +39,7 @@
 #define CTLE_NA         7           /* # gain steps                       */
 #define CTLE_NZ         5           /* # zero-frequency steps             */
 #define CTLE_WINDOW     500         /* symbols per sweep point            */
+#define RX_MSE_WINDOW   500         /* symbols per RX MSE measurement     */
 
 /* Channel */
 #define MAX_CHANNEL_TAPS 4096
@@ -43,6 +47,11 @@
 /* Number of oversampled points processed per scheduler step call.      */
 #define STEP_SIZE       OSF
 
+/* Firmware cost model: one cycle per multiply-accumulate plus a fixed
+ * per-step overhead (see serdes_lane_type.cycles)                      */
+#define FW_STEP_OVERHEAD 200        /* dispatch + bookkeeping, cycles     */
+#define FW_CTLE_MACS     8          /* CTLE filter MACs per sample        */
+
 
 /* ══════════════════════════════════════════════════════════════════════
  *  Lane state machine
@@ -51,9 +60,19 @@ typedef enum {
     INIT,           /* generate PRBS, build channel, run CDR              */
     CTLE,           /* CTLE sweep / training                              */
     RX,             /* RX FFE + DFE adaptation                            */
-    DONE            /* link training complete                              */
+    DONE,           /* link training complete                              */
+    ERROR           /* channel file could not be loaded                   */
 } LaneState;
 
+/* INIT sub-phases, each resumable across scheduler steps */
+typedef enum {
+    INIT_LOAD,      /* wait for the channel taps; CDR from the memo       */
+    INIT_CDR,       /* clock pattern through the channel → d_edge         */
+    INIT_EDGES,     /* zero-crossing histogram and edge maximum           */
+    INIT_LAG,       /* first edge above 0.8 · max                         */
+    INIT_PRBS       /* generate PAM-4 PRBS                                */
+} InitPhase;
+
 /* ═══════════════════════════════════════════════════════════════════════
  *  CTLE filter structure
  * ═══════════════════════════════════════════════════════════════════════ */
@@ -73,57 +92,102 @@ typedef struct {
 
 /* ═══════════════════════════════════════════════════════════════════════
  *  Per-lane context  — holds ALL mutable state for one SerDes lane
- * ═══════════════════════════════════════════════════════════════════════ */
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Laid out by access frequency.  Contexts come from a cache-line aligned
+ *  slab, so the hot block below starts on a line boundary.
+ *
+ *    hot     everything a CTLE/RX step reads or writes   ≤ LANE_HOT_BYTES
+ *    cold    sweep grid, phase set-up, identity, results  next lines of
+ *                                                         the context
+ *    channel h_fir[L] + channel_buffer[2L], one aligned   3 · L · 8 B
+ *            block sized from the loaded channel
+ *    bits    bits[N_BIT] + bits_osf[N_BIT·OSF], one slot  16 KiB + 256 KiB
+ *            of a second slab
+ *
+ *  Per-lane budget: ~1 KiB context + 24·L bytes of channel + 272 KiB of
+ *  PRBS.  A step streams through bits_osf and the channel block once per
+ *  sample and otherwise stays inside the hot block's 8 lines.
+ *
+ *  The FIR delay line is a window sliding down a 2L buffer: each sample
+ *  is written one slot below the previous one, and only when the window
+ *  reaches the bottom are its L-1 newest samples copied back up.  That
+ *  replaces a memmove of the whole line per sample with one per L
+ *  samples; the window is read in the same order, so results are
+ *  unchanged.
+ */
+#define LANE_CACHE_LINE 64
+#define LANE_HOT_BYTES  (8 * LANE_CACHE_LINE)
+
 typedef struct {
+    /* ── Hot: per-sample state ──────────────────────────────────────── */
     LaneState state;
-    int       dataRateGbps;         /* symbol rate in Gbps               */
-    double    Fs;                   /* sample rate = OSF * dataRate       */
-    int       id;                   /* lane ID (for logging/debugging)   */
-
-    /* ── Channel ────────────────────────────────────────────────────── */
-    double h_fir[MAX_CHANNEL_TAPS]; /* FIR taps loaded from file          */
+    int    pt;                      /* current sample index in phase      */
+    int    N_samp;                  /* total samples for current phase    */
     int    L;                       /* number of channel taps             */
-    double channel_buffer[MAX_CHANNEL_TAPS]; /* FIR delay line            */
-    const char *channel_file;       /* path to channel taps file          */
+    int    sample_instant;          /* CDR results                        */
+    int    lag;
+    int    cb_pos;                  /* delay-line window start            */
+    int    coro_line;               /* lane_train() resume point          */
+    int    ctle_cnt;
+    int    ctle_train_done;
+    int    en_DFE;
+    int    rx_err_cnt;
 
-    /* ── Bitstream (heap-allocated in lane_init) ────────────────────── */
-    double *bits;                   /* [N_BIT]                            */
+    double *h_fir;                  /* [L] FIR taps loaded from file      */
+    double *channel_buffer;         /* [2L] FIR delay line                */
     double *bits_osf;               /* [N_BIT * OSF]                      */
 
-    /* ── CDR results ────────────────────────────────────────────────── */
-    int sample_instant;
-    int lag;
-
-    /* ── TX FFE (pre-programmed, not trained) ───────────────────────── */
-    double TX_FFE[TX_FFE_LEN];
+    double err_acc;                 /* CTLE sweep point, squared error    */
+    double rx_err_acc;              /* squared error, current window      */
+    double mu_ffe;
+    double mu_dfe;
 
-    /* ── CTLE ───────────────────────────────────────────────────────── */
+    double TX_FFE[TX_FFE_LEN];      /* pre-programmed, not trained        */
     CTLEFilter ctle;
-    double ctle_z;
-    double ctle_p;
-    double ctle_A;
-    double A_vec[CTLE_NA];
-    double z_vec[CTLE_NZ];
-    double J[CTLE_NA][CTLE_NZ];
-    int    ia, iz;
-    int    ctle_cnt;
-    double err_acc;
-    int    ctle_train_done;
-
-    /* ── RX FFE + DFE ──────────────────────────────────────────────── */
     double RX_FFE[RX_FFE_LEN];
+    double rx_buffer[RX_FFE_LEN];
     double DFE[N_DFE];
     double d_hist[N_DFE];
-    double rx_buffer[RX_FFE_LEN];
-    int    en_DFE;
-    double mu_ffe;
-    double mu_dfe;
 
-    /* ── Iteration bookkeeping ──────────────────────────────────────── */
-    int pt;                         /* current sample index in phase      */
-    int N_samp;                     /* total samples for current phase    */
+    /* ── Cold: touched at phase boundaries and by status/logging ────── */
+    _Alignas(LANE_CACHE_LINE)
+    double J[CTLE_NA][CTLE_NZ];     /* CTLE sweep cost grid               */
+    int    ia, iz;                  /* sweep position, once per window    */
+    double A_vec[CTLE_NA];
+    double z_vec[CTLE_NZ];
+    double ctle_z;
+    double ctle_p;
+    double ctle_A;
+    double rx_mse;                  /* last full window; NAN before one   */
+
+    int       dataRateGbps;         /* symbol rate in Gbps                */
+    double    Fs;                   /* sample rate = OSF * dataRate       */
+    int       id;                   /* lane ID (for logging/debugging)    */
+    int       taps_cap;             /* h_fir/channel_buffer capacity      */
+    const char *channel_file;       /* path to channel taps file          */
+    double   *bits;                 /* [N_BIT]                            */
+
+    /* ── INIT progress ──────────────────────────────────────────────────
+     *  The CDR runs before the PRBS so its d_edge trace can live in
+     *  bits_osf, and its delay line in the channel block.               */
+    InitPhase init_phase;
+    int       init_pt;              /* position within the sub-phase      */
+    uint64_t  init_work;            /* MACs / entries of the last chunk   */
+    int       load_entry;           /* chan_load entry and load awaited   */
+    unsigned  load_gen;             /* … 0 = none requested yet           */
+    int       load_err;             /* errno of the failed load (ERROR)   */
+    unsigned  taps_version;         /* chan_load version of h_fir         */
+    uint64_t  taps_hash;            /* INIT memo key of the loaded taps   */
+    int       cdr_wait;             /* INIT_CDR: another lane is on it    */
+    double    cdr_post;             /* previous clock-pattern output      */
+    double    edge_max;
+    int       cross_hist[OSF];      /* zero crossings by sample phase     */
 } LaneContext;
 
+_Static_assert(offsetof(LaneContext, J) <= LANE_HOT_BYTES,
+               "LaneContext hot block exceeds LANE_HOT_BYTES");
+
 /* ═══════════════════════════════════════════════════════════════════════
  *  Utility functions
  * ═══════════════════════════════════════════════════════════════════════ */
@@ -134,7 +198,6 @@ void   ctle_design(CTLEFilter *ctle, double Fs,
                    double zHz, double pHz, double A);
 double ctle_step  (CTLEFilter *ctle, double x);
 
-int    load_channel_taps(const char *filename, double *h_fir, int max_taps);
 double adc_quantize(double x, int B);
 int    int_mode(const int *arr, int n);
 
@@ -144,9 +207,12 @@ int    int_mode(const int *arr, int n);
  *
  *  lane_init()          Allocate buffers and enter INIT state.
  *                       Lightweight — no DSP work is performed.
+ *                       ctx->bits is NULL if out of memory.
  *
- *  lane_step_init()     Load channel taps from file, generate PRBS,
- *                       run CDR.  Transitions → CTLE.
+ *  lane_step_init()     Advance INIT by one sub-phase chunk: wait for
+ *                       the channel taps (sizing the channel block to
+ *                       L), run CDR, generate PRBS.  Transitions → CTLE,
+ *                       or → ERROR if the channel cannot be loaded.
  *
  *  lane_step_ctle()     Advance CTLE sweep by STEP_SIZE samples.
  *                       Transitions → RX when sweep is complete.
@@ -154,59 +220,61 @@ int    int_mode(const int *arr, int n);
  *  lane_step_rx()       Advance RX FFE + DFE training by STEP_SIZE
  *                       samples.  Transitions → DONE when complete.
  *
- *  lane_soft_reset()    Re-enter INIT (reloads channel on next step).
+ *  lane_train()         All of the above as one stackless coroutine:
+ *                       each call resumes where the last one yielded
+ *                       and does one step's worth of work.  Returns 1
+ *                       once DONE, -1 in ERROR.
+ *
+ *  lane_soft_reset()    Re-enter INIT at INIT_LOAD (asks for the channel
+ *                       again on the next step; retries a lane in ERROR).
  *
  *  lane_destroy()       Free heap memory owned by the context.
+ *
+ *  lane_slabs_free()    Return the context and PRBS slabs to the system
+ *                       once every lane has been destroyed (at exit).
  */
 void lane_init         (LaneContext *ctx, int dataRateGbps,
                         const char *channel_file);
 void lane_step_init    (LaneContext *ctx);
 void lane_step_ctle    (LaneContext *ctx);
 void lane_step_rx      (LaneContext *ctx);
+int  lane_train        (LaneContext *ctx);
 void lane_soft_reset   (LaneContext *ctx);
 void lane_destroy      (LaneContext *ctx);
+void lane_slabs_free   (void);
 void print_lane_status(const LaneContext *ctx);
 const char *state_name(LaneState s);
 
 /* ═══════════════════════════════════════════════════════════════════════
- *  Generic: provides generic interface to the scheudler using void pointers
- * ══════════════════════════════════════════════════════════════════════= 
+ *  Scheduler task kind: one SerDes lane (TaskType, see task.h)
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  step       one lane_step_*() call for the current state
+ *             (serdes_coro_type: one lane_train() resume instead);
+ *             -1 once the lane is in ERROR
+ *  command    TASK_RESET → lane_soft_reset(); TASK_SET_RATE takes
+ *             effect at the next INIT
+ *  remaining  INIT + CTLE + RX steps left (upper bound: the sweep may
+ *             end early, and a memo hit skips the CDR)
+ *  full_work  a full INIT, CTLE and RX
+ *  phase      LaneState: INIT, CTLE, RX; DONE once finished, ERROR if
+ *             the channel could not be loaded
+ *  quality    RX MSE over the last RX_MSE_WINDOW symbols; NAN before RX
+ *  cycles     per-phase MAC count of a step, at the loaded channel length;
+ *             in INIT, the work of the sub-phase chunk that ran
  */
+extern const TaskType serdes_lane_type;
+extern const TaskType serdes_coro_type;
 
- // ctx is a pointer to a LaneContext struct
-
- // args is a pointer to a LaneInitArgs struct
- void generic_lane_init(void **p_ctx, void* args);
- // 
- int generic_lane_step(void *ctx, void* args);
- void generic_print_lane_status(void *ctx, int lane_id);
-
- /* ══════════════════════════════════════════════════════════════════════
- *  Generic arg structs
- * ═══════════════════════════════════════════════════════════════════════ */
+/* serdes_lane_type.create() arguments */
 typedef struct {
     int dataRateGbps;
     const char *channel_file;
+    int id; // Lane ID used in console and log output
 } LaneInitArgs;
 
-typedef enum {
-    NO_INTERRUPT = 0,
-    SOFT_RESET   = 1,
-    DATA_RATE_CHANGE = 2,
-    PLL_TOGGLE = 3,
-    PRINT_STATUS = 4
-} InterruptType;
-
-typedef struct {
-    InterruptType flags; // 
-    int dataRateGbps; // Only used if flags=2 (data rate change interrupt)
-} LaneStepArgs;
-
-
 
-// Debugging
-void updateLaneTick();
-void setLogFile(FILE *fp);
+extern int lane_console;    // 0 → no per-transition console output (bench mode)
 
 
 #endif /* SERDES_SIM_H */
\ No newline at end of file
@@ -0,0 +1,76 @@
+/*
+ * slab.c
+ *
+ * Fixed-size slab allocator used for lane contexts.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "slab.h"
+
+struct SlabChunk {
+    SlabChunk *next;
+};
+
+void slab_init(Slab *s, size_t obj_size, size_t align, int per_chunk)
+{
+    memset(s, 0, sizeof(*s));
+    if (align < sizeof(void *)) align = sizeof(void *);
+    s->align     = align;
+    s->slot_size = (obj_size + align - 1) & ~(align - 1);
+    s->per_chunk = per_chunk > 0 ? per_chunk : 1;
+}
+
+/* chunk header occupies the first `align` bytes so every slot stays aligned */
+static int slab_grow(Slab *s)
+{
+    size_t hdr  = (sizeof(SlabChunk) + s->align - 1) & ~(s->align - 1);
+    size_t size = hdr + s->slot_size * (size_t)s->per_chunk;
+    size = (size + s->align - 1) & ~(s->align - 1);
+
+    SlabChunk *c = aligned_alloc(s->align, size);
+    if (!c) return -1;
+    c->next   = s->chunks;
+    s->chunks = c;
+
+    /* thread slots onto the free list in address order */
+    char *base = (char *)c + hdr;
+    for (int i = s->per_chunk - 1; i >= 0; i--) {
+        void *slot = base + (size_t)i * s->slot_size;
+        *(void **)slot = s->free_list;
+        s->free_list   = slot;
+    }
+    s->capacity += s->per_chunk;
+    return 0;
+}
+
+void *slab_alloc(Slab *s)
+{
+    if (!s->free_list && slab_grow(s) != 0)
+        return NULL;
+    void *obj    = s->free_list;
+    s->free_list = *(void **)obj;
+    s->in_use++;
+    return obj;
+}
+
+void slab_free(Slab *s, void *obj)
+{
+    if (!obj) return;
+    *(void **)obj = s->free_list;
+    s->free_list  = obj;
+    s->in_use--;
+}
+
+void slab_destroy(Slab *s)
+{
+    while (s->chunks) {
+        SlabChunk *next = s->chunks->next;
+        free(s->chunks);
+        s->chunks = next;
+    }
+    s->free_list = NULL;
+    s->in_use    = 0;
+    s->capacity  = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Fixed-size slab allocator
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Objects of one size are carved out of large aligned chunks.  Freed
+ *  slots go on a LIFO free list and are handed out again before a new
+ *  chunk is allocated, so adding and removing lanes at run time never
+ *  fragments the heap and a recycled slot is usually still cache-warm.
+ *  Chunks are only returned to the system by slab_destroy().
+ */
+typedef struct SlabChunk SlabChunk;
+
+typedef struct {
+    size_t     slot_size;           /* object size rounded up to align    */
+    size_t     align;               /* slot alignment (power of two)      */
+    int        per_chunk;           /* slots per chunk                    */
+    SlabChunk *chunks;              /* singly linked list of chunks       */
+    void      *free_list;           /* next pointer stored in the slot    */
+    int        in_use;              /* live objects                       */
+    int        capacity;            /* slots across all chunks            */
+} Slab;
+
+void  slab_init   (Slab *s, size_t obj_size, size_t align, int per_chunk);
+void *slab_alloc  (Slab *s);        /* NULL on out-of-memory              */
+void  slab_free   (Slab *s, void *obj);
+void  slab_destroy(Slab *s);
+
+#endif /* SLAB_H */
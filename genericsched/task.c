@@ -0,0 +1,33 @@
+/*
+ * task.c
+ *
+ * Registry of task kinds (see task.h).
+ */
+
+#include <string.h>
+
+#include "task.h"
+#include "serdes_sim.h"
+
+int task_tick = 0;
+
+static const TaskType *const kinds[] = {
+    &serdes_lane_type,
+    &serdes_coro_type,
+};
+
+const TaskType *task_type_find(const char *name)
+{
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++)
+        if (strcmp(kinds[i]->name, name) == 0)
+            return kinds[i];
+    return NULL;
+}
+
+void task_type_usage(FILE *fp)
+{
+    fprintf(fp, "  -K   task kind of the start-up lanes:");
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++)
+        fprintf(fp, " %s", kinds[i]->name);
+    fprintf(fp, " (default %s)\n", kinds[0]->name);
+}
@@ -0,0 +1,104 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Task kinds
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Every kind of task the scheduler can run registers one TaskType with
+ *  its own entry points in the table in task.c (today the SerDes lane as
+ *  a state machine and as a coroutine, see serdes_sim.h).  A Task points
+ *  at its kind, so the loop calls step() directly and tasks of different
+ *  kinds share one task list ('a <rate> <kind>' adds one of any kind).
+ *  The loop knows nothing else about a kind: phases are small integers
+ *  it counts by, named by the kind.
+ *
+ *  create(args)         New task state from kind-specific arguments,
+ *                       NULL if out of memory.
+ *  step(data)           One scheduler step; returns 1 when the task is
+ *                       finished, -1 when it has failed (it stays in the
+ *                       list, off the run queue, until TASK_RESET), else
+ *                       0.
+ *  command(data, c, v)  Operator command (TASK_RESET, TASK_SET_RATE);
+ *                       returns -1 if the kind does not support it.
+ *  status(data)         Print a status line to stdout.
+ *  destroy(data)        Release the state from create().
+ *  remaining(data)      Estimated steps until finished.
+ *  full_work()          Estimated steps of a full run from the start
+ *                       (admission of new or restarted tasks, default
+ *                       link-up budgets).
+ *  phase(data)          Phase for per-phase accounting: 0 .. n_phases-1
+ *                       while running, n_phases once finished,
+ *                       n_phases + 1 once failed.
+ *  phase_name(phase)    Name of a phase, up to and including n_phases + 1.
+ *  quality(data)        Kind-specific figure of merit reported at
+ *                       completion (lane: RX MSE); NAN if none.
+ *  cycles(data, phase)  Modelled firmware cycles of the step that just
+ *                       ran in `phase` (see event.h).
+ */
+typedef enum {
+    TASK_RESET,                     /* restart from the beginning         */
+    TASK_SET_RATE                   /* arg: new data rate, Gbps           */
+} TaskCommand;
+
+typedef struct {
+    const char *name;
+    void  *(*create)   (const void *args);
+    int    (*step)     (void *data);
+    int    (*command)  (void *data, TaskCommand cmd, int arg);
+    void   (*status)   (void *data);
+    void   (*destroy)  (void *data);
+    int    (*remaining)(const void *data);
+    int    (*full_work)(void);
+    int    (*phase)    (const void *data);
+    const char *(*phase_name)(int phase);
+    int      n_phases;              /* ≤ TASK_MAX_PHASES                  */
+    double (*quality)  (const void *data);
+    uint64_t (*cycles) (const void *data, int phase);
+} TaskType;
+
+#define TASK_MAX_PHASES 8
+
+/* Registered kind called `name`, NULL if none */
+const TaskType *task_type_find(const char *name);
+void            task_type_usage(FILE *fp);
+
+/* Tick of the step being run, set by the scheduler, for kinds that
+ * stamp their log records */
+extern int task_tick;
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Scheduler task list — shared by sched.c and the scheduling policies
+ * ═══════════════════════════════════════════════════════════════════════ */
+typedef struct {
+    void *task_data; // Pointer to this task struct (NULL if the slot is free)
+    const TaskType *type; // Kind of task: entry points for task_data
+    int priority;
+    char is_active; // 1 if the task should be sccheduled, 0 if it is done or should not be scheduled
+
+    /* ── Policy state (see sched_policy.h) ─────────────────────────── */
+    int      weight;        /* share for stride / wfq / lottery          */
+    int      deadline;      /* absolute tick, used by edf                */
+    uint64_t vstart;        /* stride pass / wfq virtual start tag       */
+    uint64_t vfinish;       /* wfq virtual finish tag                    */
+    int      enqueued;      /* tick the task last became runnable        */
+    uint64_t enqueued_ns;   /* … and the wall time, for --bench          */
+    uint64_t enqueued_fw;   /* … and the firmware clock, cycles          */
+
+    /* ── Link-up deadline (see deadline.h) ────────────────────────── */
+    int      budget;        /* link-up budget, ticks from enqueued       */
+
+    /* ── Quantum (see quantum.h) ───────────────────────────────────── */
+    uint64_t step_ns;       /* mean cost of one step, last quantum       */
+} Task;
+
+typedef struct {
+    Task *task_buffer; // Initialized in main as an arrayList of Task structs
+    int task_buffer_size;
+    int task_buffer_capacity;
+} Task_List;
+
+#endif /* TASK_H */
@@ -0,0 +1,142 @@
+/*
+ * yield_bench.c
+ *
+ * Per-yield cost of the two lane execution modes: the lane_step_*()
+ * state machine (serdes_lane_type) and the lane_train() coroutine
+ * (serdes_coro_type).
+ *
+ * Usage: yield_bench <channel_taps.txt> [taps] [lanes] [reps]
+ *
+ * The channel is cut to `taps` taps (default 1) so the DSP work per step
+ * is small next to the cost of suspending and resuming a lane.  Lanes
+ * are stepped round-robin, as the scheduler would, from the end of INIT
+ * to DONE; the best of `reps` runs is reported per mode.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "serdes_sim.h"
+#include "chan_load.h"
+#include "lane_log.h"
+#include "bench.h"
+
+#define SEED 1
+
+static double run(const TaskType *type, const char *channel, int lanes,
+                  long *steps)
+{
+    void **ctx = calloc(lanes, sizeof(void *));
+    int   *done = calloc(lanes, sizeof(int));
+    if (!ctx || !done) {
+        fprintf(stderr, "yield_bench: out of memory\n");
+        exit(1);
+    }
+
+    srand(SEED);
+    for (int i = 0; i < lanes; i++) {
+        ctx[i] = type->create(&(LaneInitArgs){ .dataRateGbps = 60,
+                                               .channel_file = channel, .id = i });
+        if (!ctx[i]) {
+            fprintf(stderr, "yield_bench: out of memory\n");
+            exit(1);
+        }
+        while (type->phase(ctx[i]) == INIT)
+            type->step(ctx[i]);         /* INIT: not part of the measurement */
+    }
+
+    long n = 0;
+    int left = lanes;
+    uint64_t t0 = bench_now_ns();
+    while (left > 0) {
+        for (int i = 0; i < lanes; i++) {
+            if (done[i]) continue;
+            n++;
+            if (type->step(ctx[i])) {
+                done[i] = 1;
+                left--;
+            }
+        }
+    }
+    uint64_t ns = bench_now_ns() - t0;
+
+    for (int i = 0; i < lanes; i++)
+        type->destroy(ctx[i]);
+    free(ctx);
+    free(done);
+    *steps = n;
+    return (double)ns / n;
+}
+
+/* First `taps` taps of `src` in a temporary file; returns its path.
+ * Read through the loader, which must be running (synchronously). */
+static const char *cut_channel(const char *src, int taps, char *path)
+{
+    static double h[MAX_CHANNEL_TAPS];
+    unsigned gen, version;
+    int L = 0, err = 0;
+    int e = chan_load_request(src, &gen);
+    if (chan_load_result(e, gen, h, &L, &err, &version) != CHAN_READY) {
+        fprintf(stderr, "yield_bench: cannot read taps from '%s'\n", src);
+        exit(1);
+    }
+    if (L > taps)
+        L = taps;
+
+    int fd = mkstemp(path);
+    FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!fp) {
+        perror(path);
+        exit(1);
+    }
+    for (int k = 0; k < L; k++)
+        fprintf(fp, "%.17g\n", h[k]);
+    fclose(fp);
+    return path;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <channel_taps.txt> [taps] [lanes] [reps]\n", argv[0]);
+        return 1;
+    }
+    int taps  = argc > 2 ? atoi(argv[2]) : 1;
+    int lanes = argc > 3 ? atoi(argv[3]) : 16;
+    int reps  = argc > 4 ? atoi(argv[4]) : 5;
+    if (taps < 1 || taps > MAX_CHANNEL_TAPS || lanes < 1 || reps < 1) {
+        fprintf(stderr, "yield_bench: bad arguments\n");
+        return 1;
+    }
+
+    lane_console = 0;
+    lane_log_config("lanes=off");
+
+    if (chan_load_start(1, 0) != 0)      /* INIT waits for each load */
+        return 1;
+    char path[] = "/tmp/yield_bench_XXXXXX";
+    const char *channel = cut_channel(argv[1], taps, path);
+
+    const TaskType *types[] = { &serdes_lane_type, &serdes_coro_type };
+    double best[2] = { 1e30, 1e30 };
+    long steps = 0;
+
+    /* alternate the modes so drift in machine load hits both */
+    for (int r = 0; r < reps; r++)
+        for (int m = 0; m < 2; m++) {
+            double ns = run(types[m], channel, lanes, &steps);
+            if (ns < best[m]) best[m] = ns;
+        }
+    remove(path);
+    lane_slabs_free();
+    chan_load_stop();
+
+    printf("yield_bench: %d lane(s), %d tap(s), %ld steps per run, best of %d\n",
+           lanes, taps, steps, reps);
+    printf("  %-12s %8.1f ns/step\n", types[0]->name, best[0]);
+    printf("  %-12s %8.1f ns/step\n", types[1]->name, best[1]);
+    printf("  difference   %8.1f ns per yield (%+.1f%%)\n",
+           best[0] - best[1], 100.0 * (best[1] - best[0]) / best[0]);
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * arena.c
+ *
+ * mmap()ed bump arena for lane storage, optionally on huge pages (see
+ * arena.h).
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "arena.h"
+
+int arena_parse_pages(const char *s, ArenaPages *pages)
+{
+    if (strcmp(s, "off") == 0)          *pages = ARENA_PAGES_OFF;
+    else if (strcmp(s, "thp") == 0)     *pages = ARENA_PAGES_THP;
+    else if (strcmp(s, "hugetlb") == 0) *pages = ARENA_PAGES_HUGETLB;
+    else return -1;
+    return 0;
+}
+
+const char *arena_pages_name(ArenaPages pages)
+{
+    switch (pages) {
+        case ARENA_PAGES_THP:     return "thp";
+        case ARENA_PAGES_HUGETLB: return "hugetlb";
+        default:                  return "off";
+    }
+}
+
+/* Anonymous mapping of `size` bytes starting on a huge-page boundary:
+ * over-map by one huge page and trim both ends. */
+static void *map_aligned(size_t size)
+{
+    size_t span = size + ARENA_HUGE_PAGE;
+    char *p = mmap(NULL, span, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        return NULL;
+
+    char *base = (char *)(((uintptr_t)p + ARENA_HUGE_PAGE - 1) &
+                          ~(uintptr_t)(ARENA_HUGE_PAGE - 1));
+    if (base > p)
+        munmap(p, base - p);
+    if (p + span > base + size)
+        munmap(base + size, p + span - (base + size));
+    return base;
+}
+
+int arena_init(Arena *a, size_t size, ArenaPages pages)
+{
+    memset(a, 0, sizeof(*a));
+    size = (size + ARENA_HUGE_PAGE - 1) & ~(size_t)(ARENA_HUGE_PAGE - 1);
+
+    void *p = NULL;
+    if (pages == ARENA_PAGES_HUGETLB) {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "Warning: no %zu MB of hugetlb pages (vm.nr_hugepages); using thp\n",
+                    size >> 20);
+            p = NULL;
+            pages = ARENA_PAGES_THP;
+        }
+    }
+    if (!p) {
+        p = map_aligned(size);
+        if (!p)
+            return -1;
+        if (pages == ARENA_PAGES_THP && madvise(p, size, MADV_HUGEPAGE) != 0)
+            pages = ARENA_PAGES_OFF;    /* kernel without THP */
+        else if (pages == ARENA_PAGES_OFF)
+            madvise(p, size, MADV_NOHUGEPAGE);
+    }
+
+    a->base  = p;
+    a->size  = size;
+    a->pages = pages;
+    return 0;
+}
+
+void *arena_alloc(Arena *a, size_t size, size_t align)
+{
+    size_t at = (a->used + align - 1) & ~(align - 1);
+    if (at > a->size || size > a->size - at)
+        return NULL;
+    a->used = at + size;
+    return a->base + at;    /* fresh anonymous memory is already zero */
+}
+
+void arena_prefault(Arena *a)
+{
+    size_t len = (a->used + 4095) & ~(size_t)4095;
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(a->base, len, MADV_POPULATE_WRITE) == 0)
+        return;
+#endif
+    /* older kernels: write each page's first byte back to it */
+    for (size_t off = 0; off < len; off += 4096) {
+        volatile char *c = a->base + off;
+        *c = *c;
+    }
+}
+
+void arena_report(FILE *fp, const Arena *a)
+{
+    unsigned long huge_kb = 0;
+    FILE *sm = fopen("/proc/self/smaps", "r");
+    if (sm) {
+        char line[256];
+        int in_arena = 0;
+        while (fgets(line, sizeof(line), sm)) {
+            unsigned long lo, hi, kb;
+            if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2)
+                in_arena = lo >= (uintptr_t)a->base && hi <= (uintptr_t)a->base + a->size;
+            else if (in_arena && (sscanf(line, "AnonHugePages: %lu kB", &kb) == 1 ||
+                                  sscanf(line, "Private_Hugetlb: %lu kB", &kb) == 1))
+                huge_kb += kb;
+        }
+        fclose(sm);
+    }
+    fprintf(fp, "Lane arena: %zu MB (%zu MB used), pages=%s, huge-backed %lu MB\n",
+            a->size >> 20, a->used >> 20, arena_pages_name(a->pages), huge_kb >> 10);
+}
+
+void arena_destroy(Arena *a)
+{
+    if (a->base)
+        munmap(a->base, a->size);
+    memset(a, 0, sizeof(*a));
+}
@@ -0,0 +1,63 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Lane arena
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  All lane storage comes from one mmap()ed region sized at start-up
+ *  from the lane count: the Task array (each with its LaneContext and
+ *  the two MAX_CHANNEL_TAPS arrays inside it), then every lane's PRBS
+ *  and oversampled bitstream.  Nothing lives on the stack or in
+ *  separate heap blocks, so the lane count is only limited by memory.
+ *
+ *  The region is aligned and sized to ARENA_HUGE_PAGE so it can be
+ *  backed by 2 MB pages: with one 4 KB page per 512 doubles, a lane's
+ *  ~340 KB of state spans ~85 pages and the TLB covers only a handful of
+ *  lanes; with 2 MB pages it covers all of them up to a few hundred.
+ *
+ *    off       4 KB pages
+ *    thp       madvise(MADV_HUGEPAGE): transparent huge pages when the
+ *              kernel has them (default)
+ *    hugetlb   MAP_HUGETLB from the reserved pool (vm.nr_hugepages);
+ *              falls back to thp with a warning when the pool is short
+ */
+#define ARENA_HUGE_PAGE     (2u << 20)
+
+typedef enum {
+    ARENA_PAGES_OFF,
+    ARENA_PAGES_THP,
+    ARENA_PAGES_HUGETLB
+} ArenaPages;
+
+typedef struct {
+    char       *base;
+    size_t      size;               /* mapped bytes (huge-page multiple)  */
+    size_t      used;
+    ArenaPages  pages;              /* what was actually obtained         */
+} Arena;
+
+int   arena_parse_pages(const char *s, ArenaPages *pages);
+const char *arena_pages_name(ArenaPages pages);
+
+/* Map `size` bytes (rounded up) with the requested page kind.
+ * Returns 0, or -1 if the mapping failed. */
+int   arena_init(Arena *a, size_t size, ArenaPages pages);
+
+/* Bump allocation, zero-filled; NULL when the arena is exhausted. */
+void *arena_alloc(Arena *a, size_t size, size_t align);
+
+/* Fault in every page handed out so far (--realtime): nothing in the
+ * arena is first touched while the lanes are stepping. */
+void  arena_prefault(Arena *a);
+
+/* One line: size, page kind and how much the kernel backs with huge
+ * pages right now (AnonHugePages / hugetlb from /proc/self/smaps). */
+void  arena_report(FILE *fp, const Arena *a);
+
+void  arena_destroy(Arena *a);
+
+#endif /* ARENA_H */
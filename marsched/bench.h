@@ -0,0 +1,79 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "serdes_sim.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Headless benchmark results (--bench)
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  In bench mode the scheduler does not poll stdin or sleep, keeps the
+ *  console quiet and runs every lane to DONE.  It feeds this module
+ *  with the CPU time of every step (by the phase the step ran in) and
+ *  the link-up time of every completion, then writes one JSON object:
+ *
+ *    { "program", "channel", "policy", "lanes", "rates", "priority_mode",
+ *      "seed", "wall_s", "steps", "samples", "lanes_per_s",
+ *      "samples_per_s",
+ *      "phases":       { "INIT"|"CTLE"|"RX": { "steps", "cpu_s", "max_us" } },
+ *      "linkup_ticks": { "mean", "p50", "p90", "p99", "max" },
+ *      "linkup_ms":    { "mean", "p50", "p90", "p99", "max" } }
+ *
+ *  samples counts the oversampled points consumed by CTLE and RX steps
+ *  (STEP_SIZE per step; INIT works on the CDR block, not the stream).
+ *  max_us is the longest single step of the phase: how long it can
+ *  hold the scheduler off every other lane.
+ *  Percentiles are nearest-rank.
+ */
+typedef struct {
+    const char *program;
+    const char *channel;
+    const char *policy;
+    const char *rates;              /* as given to -R                     */
+    int         lanes;
+    int         random_prio;
+    unsigned    seed;
+} BenchInfo;
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t phase_ns[DONE];        /* CPU time of steps in INIT/CTLE/RX  */
+    uint64_t phase_steps[DONE];
+    uint64_t phase_max_ns[DONE];    /* longest single step                */
+    int     *linkup_ticks;
+    double  *linkup_ms;
+    int      n_linkup, cap_linkup;
+} BenchStats;
+
+uint64_t bench_now_ns(void);
+
+void bench_start (BenchStats *b);
+void bench_linkup(BenchStats *b, int ticks, uint64_t ns);
+void bench_write (FILE *fp, BenchStats *b, const BenchInfo *info);
+void bench_free  (BenchStats *b);
+
+/* `phase`: the LaneState the step ran in; others are not counted */
+static inline void bench_step(BenchStats *b, int phase, uint64_t ns)
+{
+    if (phase >= 0 && phase < DONE) {
+        b->phase_ns[phase] += ns;
+        b->phase_steps[phase]++;
+        if (ns > b->phase_max_ns[phase])
+            b->phase_max_ns[phase] = ns;
+    }
+}
+
+/* Parse "-R 60,56,32" into rates[]; returns the count, 0 on error. */
+int bench_parse_rates(const char *s, int *rates, int max);
+
+/* qsort comparators and the nearest-rank index of the p-th percentile
+ * (0..100) of n sorted values; every report in the tree uses these. */
+int bench_cmp_int   (const void *a, const void *b);
+int bench_cmp_u64   (const void *a, const void *b);
+int bench_cmp_double(const void *a, const void *b);
+int bench_rank      (int n, double p);
+
+#endif /* BENCH_H */
@@ -0,0 +1,491 @@
+/*
+ * chan_load.c
+ *
+ * Channel tap files loaded by a background I/O thread, with cached
+ * failures and exponential backoff (see chan_load.h).
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "chan_load.h"
+#include "serdes_sim.h"
+
+typedef struct {
+    const char *path;               /* NULL: free slot                    */
+    unsigned    gen_req;            /* latest load asked for              */
+    unsigned    gen_done;           /* latest load completed              */
+    int         busy;               /* I/O thread is working on it        */
+
+    /* result of gen_done */
+    int         ok;
+    int         err;
+    double     *taps;               /* [MAX_CHANNEL_TAPS]                 */
+    int         L;
+
+    /* what the taps were read from, to skip unchanged files */
+    dev_t       dev;
+    ino_t       ino;
+    off_t       size;
+    struct timespec mtime;
+
+    int         fails;              /* consecutive failures               */
+    uint64_t    retry_at_ns;        /* no new load before this            */
+
+    unsigned    version;            /* successful reads of new taps       */
+    int         wd;                 /* inotify watch on its directory:    */
+                                    /* 0 none yet, -1 could not be added  */
+} Entry;
+
+static Entry entries[CHAN_LOAD_FILES];
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  work;        /* → I/O thread                       */
+static pthread_cond_t  done;        /* → lanes waiting on a result        */
+static pthread_t       io_thread;
+static int             running, stopping, sync_mode;
+static unsigned        events;
+static int             load_fd = -1;   /* eventfd: readable after a load */
+
+/* hot reload: the watcher thread turns inotify events into loads */
+static int             inotify_fd = -1, stop_fd = -1;
+static pthread_t       watch_thread;
+static int             watching;
+
+/* counters for the exit report */
+static unsigned long   n_requests, n_reads, n_unchanged, n_failures, n_cached, n_changes;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void deadline(struct timespec *ts, uint64_t at_ns)
+{
+    ts->tv_sec  = at_ns / 1000000000ull;
+    ts->tv_nsec = at_ns % 1000000000ull;
+}
+
+static uint64_t backoff_ns(int fails)
+{
+    uint64_t ms = CHAN_BACKOFF_MIN_MS;
+    for (int i = 1; i < fails && ms < CHAN_BACKOFF_MAX_MS; i++)
+        ms *= 2;
+    if (ms > CHAN_BACKOFF_MAX_MS)
+        ms = CHAN_BACKOFF_MAX_MS;
+    return ms * 1000000ull;
+}
+
+/* Make load_fd readable.  A full counter (EAGAIN) is readable anyway. */
+static void signal_load(void)
+{
+    uint64_t one = 1;
+    if (load_fd >= 0 && write(load_fd, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN)
+        perror("chan_load: eventfd");
+}
+
+/* I/O thread: read `path` into buf.  Returns taps read, or -errno. */
+static int read_taps(const char *path, double *buf)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return -errno;
+    int L = 0;
+    while (L < MAX_CHANNEL_TAPS && fscanf(fp, "%lf", &buf[L]) == 1)
+        L++;
+    fclose(fp);
+    return L;
+}
+
+/* Last component of a path */
+static const char *base_name(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+/* I/O thread: watch the directory `path` is in.  Directories rather than
+ * files, so that a file replaced by rename (as editors and `mv` do) or
+ * created after a failed load is seen as well. */
+static int add_watch(const char *path)
+{
+    char dir[4096];
+    const char *base = base_name(path);
+    size_t n = base - path;
+    if (n == 0)
+        strcpy(dir, ".");
+    else if (n < sizeof(dir))
+        snprintf(dir, sizeof(dir), "%.*s", (int)n, path);
+    else
+        return -1;
+    int wd = inotify_add_watch(inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+    return wd > 0 ? wd : -1;
+}
+
+/* Called with the lock held: next entry to load, or NULL.  A failed
+ * entry whose backoff has expired is re-queued here. */
+static Entry *next_job(uint64_t now, uint64_t *wake_at)
+{
+    *wake_at = 0;
+    for (int i = 0; i < CHAN_LOAD_FILES; i++) {
+        Entry *e = &entries[i];
+        if (e->path && e->gen_req != e->gen_done)
+            return e;
+    }
+    for (int i = 0; i < CHAN_LOAD_FILES; i++) {
+        Entry *e = &entries[i];
+        if (!e->path || e->ok || !e->gen_done)
+            continue;
+        if (e->retry_at_ns <= now) {
+            e->gen_req++;
+            return e;
+        }
+        if (!*wake_at || e->retry_at_ns < *wake_at)
+            *wake_at = e->retry_at_ns;
+    }
+    return NULL;
+}
+
+static void *io_main(void *arg)
+{
+    (void)arg;
+    static double buf[MAX_CHANNEL_TAPS];
+
+    pthread_mutex_lock(&lock);
+    while (!stopping) {
+        uint64_t wake_at;
+        Entry *e = next_job(now_ns(), &wake_at);
+        if (!e) {
+            if (wake_at) {
+                struct timespec ts;
+                deadline(&ts, wake_at);
+                pthread_cond_timedwait(&work, &lock, &ts);
+            } else {
+                pthread_cond_wait(&work, &lock);
+            }
+            continue;
+        }
+
+        unsigned gen = e->gen_req;
+        const char *path = e->path;
+        int had_taps = e->ok;
+        int wd = e->wd;
+        struct stat prev = { .st_dev = e->dev, .st_ino = e->ino, .st_size = e->size };
+        prev.st_mtim = e->mtime;
+        e->busy = 1;
+        pthread_mutex_unlock(&lock);
+
+        /* ── file system work, unlocked ── */
+        if (watching && wd == 0)
+            wd = add_watch(path);
+        struct stat st;
+        int L = -1, err = 0, unchanged = 0;
+        if (stat(path, &st) != 0) {
+            err = errno;
+        } else if (had_taps && st.st_dev == prev.st_dev && st.st_ino == prev.st_ino &&
+                   st.st_size == prev.st_size &&
+                   st.st_mtim.tv_sec == prev.st_mtim.tv_sec &&
+                   st.st_mtim.tv_nsec == prev.st_mtim.tv_nsec) {
+            unchanged = 1;
+        } else {
+            L = read_taps(path, buf);
+            if (L < 0)
+                err = -L;
+        }
+
+        pthread_mutex_lock(&lock);
+        e->busy = 0;
+        e->wd   = wd;
+        if (unchanged) {
+            n_unchanged++;
+        } else if (L > 0) {
+            n_reads++;
+            memcpy(e->taps, buf, L * sizeof(double));
+            e->version++;
+            e->L     = L;
+            e->ok    = 1;
+            e->dev   = st.st_dev;
+            e->ino   = st.st_ino;
+            e->size  = st.st_size;
+            e->mtime = st.st_mtim;
+        } else {
+            n_failures++;
+            e->ok  = 0;
+            e->err = err;           /* 0: opened but no taps */
+            e->fails++;
+            e->retry_at_ns = now_ns() + backoff_ns(e->fails);
+        }
+        if (e->ok)
+            e->fails = 0;
+        e->gen_done = gen;
+        __atomic_add_fetch(&events, 1, __ATOMIC_RELEASE);
+        signal_load();
+        pthread_cond_broadcast(&done);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+/* Watcher thread: a watched file was written or moved into place, so
+ * queue a load of it (the I/O thread's stat() check still skips it if
+ * nothing changed).  A failed entry is retried at once. */
+static void *watch_main(void *arg)
+{
+    (void)arg;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd pfd[2] = { { inotify_fd, POLLIN, 0 }, { stop_fd, POLLIN, 0 } };
+
+    while (poll(pfd, 2, -1) >= 0 || errno == EINTR) {
+        if (pfd[1].revents)
+            break;
+        if (!(pfd[0].revents & POLLIN))
+            continue;
+        ssize_t len = read(inotify_fd, buf, sizeof(buf));
+        if (len <= 0)
+            continue;
+
+        pthread_mutex_lock(&lock);
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            for (int i = 0; i < CHAN_LOAD_FILES && ev->len; i++) {
+                Entry *e = &entries[i];
+                if (!e->path || e->wd != ev->wd || strcmp(base_name(e->path), ev->name) != 0)
+                    continue;
+                n_changes++;
+                e->gen_req++;
+                e->retry_at_ns = 0;
+                pthread_cond_signal(&work);
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+/* Hot reload, when the loads are not synchronous: best effort */
+static void start_watching(void)
+{
+    inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    stop_fd    = eventfd(0, EFD_CLOEXEC);
+    if (inotify_fd >= 0 && stop_fd >= 0 &&
+        pthread_create(&watch_thread, NULL, watch_main, NULL) == 0) {
+        watching = 1;
+        return;
+    }
+    fprintf(stderr, "Warning: cannot watch channel files (%s); no hot reload\n",
+            strerror(errno));
+    if (inotify_fd >= 0) close(inotify_fd);
+    if (stop_fd >= 0) close(stop_fd);
+    inotify_fd = stop_fd = -1;
+}
+
+int chan_load_start(int sync, int watch)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&work, &attr);
+    pthread_cond_init(&done, &attr);
+    pthread_condattr_destroy(&attr);
+
+    sync_mode = sync;
+    stopping  = 0;
+    load_fd   = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (pthread_create(&io_thread, NULL, io_main, NULL) != 0) {
+        perror("pthread_create(chan_load)");
+        return -1;
+    }
+    running = 1;
+    if (!sync && watch)
+        start_watching();
+    return 0;
+}
+
+void chan_load_stop(void)
+{
+    if (watching) {
+        uint64_t one = 1;
+        if (write(stop_fd, &one, sizeof(one)) == sizeof(one))
+            pthread_join(watch_thread, NULL);
+        close(inotify_fd);
+        close(stop_fd);
+        inotify_fd = stop_fd = -1;
+        watching = 0;
+    }
+    if (running) {
+        pthread_mutex_lock(&lock);
+        stopping = 1;
+        pthread_cond_signal(&work);
+        pthread_mutex_unlock(&lock);
+        pthread_join(io_thread, NULL);
+        running = 0;
+    }
+    if (load_fd >= 0)
+        close(load_fd);
+    load_fd = -1;
+    for (int i = 0; i < CHAN_LOAD_FILES; i++)
+        free(entries[i].taps);
+    memset(entries, 0, sizeof(entries));
+}
+
+int chan_load_request(const char *path, unsigned *gen)
+{
+    pthread_mutex_lock(&lock);
+    n_requests++;
+
+    Entry *e = NULL, *idle = NULL;
+    for (int i = 0; i < CHAN_LOAD_FILES && !e; i++) {
+        Entry *c = &entries[i];
+        if (c->path && strcmp(c->path, path) == 0)
+            e = c;
+        else if (!idle && (!c->path || (!c->busy && c->gen_req == c->gen_done)))
+            idle = c;
+    }
+    if (!e && idle) {
+        double *taps = idle->taps;
+        memset(idle, 0, sizeof(*idle));
+        idle->path = path;
+        idle->taps = taps ? taps : malloc(MAX_CHANNEL_TAPS * sizeof(double));
+        e = idle->taps ? idle : NULL;
+    }
+    if (!e) {
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    if (e->gen_req != e->gen_done) {
+        /* a load is queued or running: share it */
+    } else if (e->gen_done && !e->ok && now_ns() < e->retry_at_ns) {
+        n_cached++;                 /* backing off: cached failure */
+    } else {
+        e->gen_req++;
+        pthread_cond_signal(&work);
+    }
+    *gen = e->gen_req;
+    pthread_mutex_unlock(&lock);
+    return (int)(e - entries);
+}
+
+ChanStatus chan_load_result(int i, unsigned gen, double *taps, int *L, int *err,
+                            unsigned *version)
+{
+    if (i < 0) {
+        *err = EBUSY;
+        return CHAN_FAILED;
+    }
+
+    Entry *e = &entries[i];
+    ChanStatus st;
+
+    pthread_mutex_lock(&lock);
+    while (sync_mode && (int)(e->gen_done - gen) < 0)
+        pthread_cond_wait(&done, &lock);
+
+    if ((int)(e->gen_done - gen) < 0) {
+        st = CHAN_PENDING;
+    } else if (e->ok) {
+        memcpy(taps, e->taps, e->L * sizeof(double));
+        *L = e->L;
+        *version = e->version;
+        st = CHAN_READY;
+    } else {
+        *err = e->err;
+        st = CHAN_FAILED;
+    }
+    pthread_mutex_unlock(&lock);
+    return st;
+}
+
+int chan_load_ok(int i)
+{
+    if (i < 0) return 0;
+    pthread_mutex_lock(&lock);
+    int ok = entries[i].gen_done && entries[i].ok;
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+/* Entry i, if it still holds `path` (entries are reused for other
+ * paths once more than CHAN_LOAD_FILES are in use) */
+static Entry *holding(int i, const char *path)
+{
+    if (i < 0 || i >= CHAN_LOAD_FILES)
+        return NULL;
+    Entry *e = &entries[i];
+    return e->path && (e->path == path || strcmp(e->path, path) == 0) ? e : NULL;
+}
+
+unsigned chan_load_version(int i, const char *path)
+{
+    pthread_mutex_lock(&lock);
+    Entry *e = holding(i, path);
+    unsigned v = e && e->ok ? e->version : 0;
+    pthread_mutex_unlock(&lock);
+    return v;
+}
+
+int chan_load_taps(int i, const char *path, double *taps, int *L, unsigned *version)
+{
+    pthread_mutex_lock(&lock);
+    Entry *e = holding(i, path);
+    int ok = e && e->ok;
+    if (ok) {
+        memcpy(taps, e->taps, e->L * sizeof(double));
+        *L = e->L;
+        *version = e->version;
+    }
+    pthread_mutex_unlock(&lock);
+    return ok ? 0 : -1;
+}
+
+unsigned chan_load_events(void)
+{
+    return __atomic_load_n(&events, __ATOMIC_ACQUIRE);
+}
+
+int chan_load_watching(void)
+{
+    return watching;
+}
+
+int chan_load_fd(void)
+{
+    return load_fd;
+}
+
+void chan_load_ack(void)
+{
+    uint64_t n;
+    if (load_fd >= 0 && read(load_fd, &n, sizeof(n)) != sizeof(n) && errno != EAGAIN)
+        perror("chan_load: eventfd");
+}
+
+void chan_load_wait(unsigned seen, int ms)
+{
+    struct timespec ts;
+    deadline(&ts, now_ns() + (uint64_t)ms * 1000000ull);
+    pthread_mutex_lock(&lock);
+    if (events == seen)
+        pthread_cond_timedwait(&done, &lock, &ts);
+    pthread_mutex_unlock(&lock);
+}
+
+void chan_load_report(FILE *fp)
+{
+    pthread_mutex_lock(&lock);
+    fprintf(fp, "Channel loads: %lu requests, %lu reads, %lu unchanged, "
+            "%lu failed, %lu served from cached failure, %lu file changes seen\n",
+            n_requests, n_reads, n_unchanged, n_failures, n_cached, n_changes);
+    pthread_mutex_unlock(&lock);
+}
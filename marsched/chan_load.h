@@ -0,0 +1,99 @@
+#ifndef CHAN_LOAD_H
+#define CHAN_LOAD_H
+
+#include <stdio.h>
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Channel-file loading off the scheduler thread
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Lanes in INIT ask for their tap file with chan_load_request() and
+ *  poll chan_load_result(); an I/O thread does the stat/fopen/fscanf.
+ *  The scheduler thread never touches the file system for a channel.
+ *
+ *  One entry per path, shared by every lane that names it:
+ *
+ *    request   joins a load that is queued or running, else queues a
+ *              new one.  While the entry is backing off after a failure
+ *              the cached failure is returned at once, with no I/O.
+ *    load      stat() first; if inode, size and mtime match the taps
+ *              already held, they are reused without re-reading.
+ *    failure   retried by the I/O thread after CHAN_BACKOFF_MIN_MS,
+ *              doubling up to CHAN_BACKOFF_MAX_MS, for as long as the
+ *              path stays wrong.  A success resets the backoff.
+ *
+ *    change    with watching on, a watcher thread has inotify watches on
+ *              the directories of the files loaded; a file written or
+ *              renamed into place is loaded again (at once, even while
+ *              backing off).  New taps bump the entry's version, so a
+ *              scheduler that wants hot reload can retrain the lanes
+ *              trained on an older one (chan_load_version()).
+ *
+ *  Every completed load bumps chan_load_events(), so the scheduler can
+ *  wake lanes that wait on a load (or sit in ERROR), and look for lanes
+ *  whose file changed, by checking one counter per tick rather than
+ *  polling each lane.  It also makes chan_load_fd() readable, so a
+ *  scheduler with nothing to run can block in poll() on it together
+ *  with its other inputs.
+ *
+ *  Synchronous mode (chan_load_start(1, …), used by -S runs) makes
+ *  chan_load_result() wait for the I/O thread, so the tick at which a
+ *  lane gets its taps does not depend on disk timing.  It does not
+ *  watch for changes either: they would come at any tick.
+ */
+#define CHAN_LOAD_FILES      8
+#define CHAN_BACKOFF_MIN_MS  100
+#define CHAN_BACKOFF_MAX_MS  30000
+
+typedef enum {
+    CHAN_PENDING,
+    CHAN_READY,
+    CHAN_FAILED
+} ChanStatus;
+
+/* Start the I/O thread, and with `watch` (ignored when `sync`) the
+ * watcher.  Returns 0, or -1 if the I/O thread could not be created. */
+int  chan_load_start(int sync, int watch);
+void chan_load_stop(void);
+
+/* Ask for current taps of `path` (which must outlive the loader).
+ * Returns the entry, or -1 if the table is full of loads in flight;
+ * *gen is the load to wait for. */
+int  chan_load_request(const char *path, unsigned *gen);
+
+/* State of load `gen` of entry `e`.  On CHAN_READY the taps are copied
+ * to taps[] (room for MAX_CHANNEL_TAPS) and *L and *version set; on
+ * CHAN_FAILED *err is the errno, or 0 for a file without taps. */
+ChanStatus chan_load_result(int e, unsigned gen, double *taps, int *L, int *err,
+                            unsigned *version);
+
+/* Version of the taps entry `e` holds for `path`: it goes up each time
+ * the file is read with new contents; 0 if the entry has no taps or has
+ * been reused for another file. */
+unsigned chan_load_version(int e, const char *path);
+
+/* Copy of those taps.  Returns 0, or -1 if there are none (as above). */
+int  chan_load_taps(int e, const char *path, double *taps, int *L, unsigned *version);
+
+/* Whether the latest load of entry `e` succeeded (for lanes in ERROR). */
+int  chan_load_ok(int e);
+
+/* Whether the watcher is running: a trained lane may yet be retrained. */
+int  chan_load_watching(void);
+
+/* Completed loads so far (any entry). */
+unsigned chan_load_events(void);
+
+/* Block until chan_load_events() != seen or `ms` pass (bench runs with
+ * every lane waiting). */
+void chan_load_wait(unsigned seen, int ms);
+
+/* eventfd that is readable once a load has completed since the last
+ * chan_load_ack(); -1 if none could be made.  Ack, then check
+ * chan_load_events(), then poll(): no load is missed. */
+int  chan_load_fd(void);
+void chan_load_ack(void);
+
+void chan_load_report(FILE *fp);
+
+#endif /* CHAN_LOAD_H */
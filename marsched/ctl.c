@@ -0,0 +1,435 @@
+/*
+ * ctl.c
+ *
+ * Control socket and shared status page (see ctl.h).
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ctl.h"
+
+typedef struct {
+    int     fd;                     /* -1: free slot                      */
+    int     dead;                   /* close at the next poll             */
+    int     watch;                  /* -2 nothing, -1 every lane, or one  */
+    char    in[CTL_IN_MAX];
+    int     in_len;
+    char   *out;
+    size_t  out_len, out_cap;
+} Client;
+
+static Client  *clients;            /* [CTL_MAX_CLIENTS]                  */
+static int      n_clients;
+static int      listen_fd = -1;
+static char     sock_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+static int      page_fd = -1;       /* read-only, handed to clients       */
+static CtlPage *page;
+static size_t   page_size;
+
+static Client  *cur;                /* client whose command is running    */
+static FILE    *cur_out;            /* stdout while it runs               */
+
+/* ── Output ───────────────────────────────────────────────────────────── */
+
+static void out_append(Client *c, const char *buf, size_t n)
+{
+    if (c->dead)
+        return;
+    if (c->out_len + n > CTL_OUT_MAX) {
+        fprintf(stderr, "Control client fd %d is not reading; dropped\n", c->fd);
+        c->dead = 1;
+        return;
+    }
+    if (c->out_len + n > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap : 4096;
+        while (cap < c->out_len + n)
+            cap *= 2;
+        char *p = realloc(c->out, cap);
+        if (!p) {
+            c->dead = 1;
+            return;
+        }
+        c->out = p;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, buf, n);
+    c->out_len += n;
+}
+
+static void out_puts(Client *c, const char *s)
+{
+    out_append(c, s, strlen(s));
+}
+
+static ssize_t cur_write(void *cookie, const char *buf, size_t size)
+{
+    (void)cookie;
+    if (cur)
+        out_append(cur, buf, size);
+    return (ssize_t)size;
+}
+
+static void flush_client(Client *c)
+{
+    size_t sent = 0;
+    while (sent < c->out_len) {
+        ssize_t n = send(c->fd, c->out + sent, c->out_len - sent,
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                c->dead = 1;
+            break;
+        }
+    }
+    if (sent) {
+        memmove(c->out, c->out + sent, c->out_len - sent);
+        c->out_len -= sent;
+    }
+}
+
+static void drop_client(Client *c)
+{
+    close(c->fd);
+    free(c->out);
+    c->fd = -1;
+    c->out = NULL;
+    c->out_len = c->out_cap = 0;
+    n_clients--;
+}
+
+/* ── Connections ──────────────────────────────────────────────────────── */
+
+/* Greeting, with the status page's fd attached */
+static int send_greeting(int fd)
+{
+    char line[64];
+    int len = snprintf(line, sizeof(line), "marsched %d %d\n", CTL_VERSION, page->lanes);
+    struct iovec iov = { line, (size_t)len };
+    union {
+        struct cmsghdr h;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctrl;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = ctrl.buf, .msg_controllen = sizeof(ctrl.buf) };
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type  = SCM_RIGHTS;
+    cm->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &page_fd, sizeof(int));
+    return sendmsg(fd, &msg, MSG_NOSIGNAL) == len ? 0 : -1;
+}
+
+static void accept_clients(void)
+{
+    int fd;
+    while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        Client *c = NULL;
+        for (int i = 0; i < CTL_MAX_CLIENTS && !c; i++)
+            if (clients[i].fd < 0)
+                c = &clients[i];
+        if (!c || send_greeting(fd) != 0) {
+            close(fd);              /* full: the client sees EOF */
+            continue;
+        }
+        c->fd     = fd;
+        c->dead   = 0;
+        c->watch  = -2;
+        c->in_len = 0;
+        n_clients++;
+    }
+}
+
+/* ── Commands ─────────────────────────────────────────────────────────── */
+
+static void run_line(Client *c, char *line, int (*exec)(void *, const char *), void *arg)
+{
+    size_t n = strlen(line);
+    if (n && line[n - 1] == '\r')
+        line[--n] = '\0';
+
+    int lane = -1;
+    if (line[0] == 'w' && (line[1] == '\0' || line[1] == ' ')) {
+        c->watch = sscanf(line, "w %d", &lane) == 1 ? lane : -1;
+        out_puts(c, c->watch >= page->lanes || c->watch < -1 ? "err no such lane\n" : "ok\n");
+        return;
+    }
+    if (line[0] == 'u' && line[1] == '\0') {
+        c->watch = -2;
+        out_puts(c, "ok\n");
+        return;
+    }
+    if (line[0] == '\0') {
+        out_puts(c, "ok\n");
+        return;
+    }
+
+    FILE *saved = stdout;
+    cur = c;
+    stdout = cur_out;
+    int rc = exec(arg, line);
+    fflush(stdout);
+    stdout = saved;
+    cur = NULL;
+    out_puts(c, rc == 0 ? "ok\n" : "err bad command\n");
+}
+
+static void read_client(Client *c, int (*exec)(void *, const char *), void *arg)
+{
+    ssize_t n = recv(c->fd, c->in + c->in_len, CTL_IN_MAX - c->in_len, MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        c->dead = 1;
+        return;
+    }
+    if (n < 0)
+        return;
+    c->in_len += n;
+
+    /* every complete line, in order */
+    char *p = c->in, *end = c->in + c->in_len, *nl;
+    while (!c->dead && (nl = memchr(p, '\n', end - p))) {
+        *nl = '\0';
+        run_line(c, p, exec, arg);
+        p = nl + 1;
+    }
+    c->in_len = end - p;
+    memmove(c->in, p, c->in_len);
+    if (c->in_len == CTL_IN_MAX) {
+        out_puts(c, "err line too long\n");
+        c->dead = 1;
+    }
+}
+
+/* ── Interface ────────────────────────────────────────────────────────── */
+
+int ctl_open(const char *path, int lanes)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: control socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    /* a socket file nobody answers on is left over from an earlier run */
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "Error: %s is in use by another scheduler\n", path);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    unlink(path);
+
+    /* status page */
+    page_size = ctl_page_size(lanes);
+    int rw = memfd_create("marsched-status", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (rw < 0 || ftruncate(rw, page_size) != 0 ||
+        (page = mmap(NULL, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, rw, 0)) == MAP_FAILED) {
+        perror("status page");
+        page = NULL;
+        if (rw >= 0) close(rw);
+        return -1;
+    }
+    /* clients get a read-only open of it, and it can't be resized */
+    char self[64];
+    snprintf(self, sizeof(self), "/proc/self/fd/%d", rw);
+    page_fd = open(self, O_RDONLY | O_CLOEXEC);
+    fcntl(rw, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+    close(rw);
+    if (page_fd < 0) {
+        perror("status page");
+        ctl_close();
+        return -1;
+    }
+    page->version = CTL_VERSION;
+    page->pid     = getpid();
+    page->lanes   = lanes;
+    page->pll     = 1;
+    page->n_state[INIT] = lanes;
+    memset(page->state, INIT, lanes);
+    lane_snap_table_init(ctl_snaps(), 0, lanes);
+
+    clients = calloc(CTL_MAX_CLIENTS, sizeof(Client));
+    cookie_io_functions_t io = { .write = cur_write };
+    cur_out = clients ? fopencookie(NULL, "w", io) : NULL;
+    if (!cur_out) {
+        fprintf(stderr, "Error: out of memory for control clients\n");
+        ctl_close();
+        return -1;
+    }
+    setvbuf(cur_out, NULL, _IOFBF, 4096);
+    for (int i = 0; i < CTL_MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, CTL_MAX_CLIENTS) != 0) {
+        perror(path);
+        ctl_close();
+        return -1;
+    }
+    strcpy(sock_path, path);
+    return 0;
+}
+
+void ctl_close(void)
+{
+    if (clients) {
+        for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+            Client *c = &clients[i];
+            if (c->fd < 0)
+                continue;
+            /* last replies: give each client a moment to take them */
+            for (int tries = 0; c->out_len && !c->dead && tries < 100; tries++) {
+                flush_client(c);
+                if (c->out_len) {
+                    struct pollfd p = { c->fd, POLLOUT, 0 };
+                    poll(&p, 1, 10);
+                }
+            }
+            drop_client(c);
+        }
+        free(clients);
+        clients = NULL;
+    }
+    if (cur_out) {
+        fclose(cur_out);
+        cur_out = NULL;
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(sock_path);
+        listen_fd = -1;
+    }
+    if (page) {
+        munmap(page, page_size);
+        page = NULL;
+    }
+    if (page_fd >= 0) {
+        close(page_fd);
+        page_fd = -1;
+    }
+}
+
+int ctl_clients(void)
+{
+    return n_clients;
+}
+
+LaneSnapTable *ctl_snaps(void)
+{
+    return (LaneSnapTable *)((char *)page + ctl_snaps_offset(page->lanes));
+}
+
+void ctl_poll(int tick, int (*exec)(void *arg, const char *cmd), void *arg)
+{
+    if (listen_fd < 0)
+        return;
+    __atomic_store_n(&page->tick, tick, __ATOMIC_RELAXED);
+
+    struct pollfd pfd[1 + CTL_MAX_CLIENTS];
+    Client *who[1 + CTL_MAX_CLIENTS];
+    int n = 0;
+    pfd[n].fd = listen_fd;
+    pfd[n].events = POLLIN;
+    who[n++] = NULL;
+    for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+        if (clients[i].fd < 0)
+            continue;
+        pfd[n].fd = clients[i].fd;
+        pfd[n].events = POLLIN | (clients[i].out_len ? POLLOUT : 0);
+        who[n++] = &clients[i];
+    }
+    if (poll(pfd, n, 0) <= 0)
+        return;
+
+    if (pfd[0].revents & POLLIN)
+        accept_clients();
+    for (int k = 1; k < n; k++) {
+        Client *c = who[k];
+        if (pfd[k].revents & (POLLIN | POLLHUP | POLLERR))
+            read_client(c, exec, arg);
+        if (c->out_len && !c->dead)
+            flush_client(c);
+    }
+    for (int k = 1; k < n; k++)
+        if (who[k]->dead)
+            drop_client(who[k]);
+}
+
+void ctl_sleep(long us)
+{
+    ctl_wait(NULL, 0, us);
+}
+
+void ctl_wait(const int *fds, int n_fds, long us)
+{
+    struct pollfd pfd[CTL_WAIT_FDS + 1 + CTL_MAX_CLIENTS];
+    int n = 0;
+    for (int i = 0; i < n_fds && i < CTL_WAIT_FDS; i++) {
+        if (fds[i] < 0)
+            continue;
+        pfd[n].fd = fds[i];
+        pfd[n++].events = POLLIN;
+    }
+    if (listen_fd >= 0) {
+        pfd[n].fd = listen_fd;
+        pfd[n++].events = POLLIN;
+        for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+            if (clients[i].fd < 0)
+                continue;
+            pfd[n].fd = clients[i].fd;
+            pfd[n++].events = POLLIN;
+        }
+    }
+    struct timespec ts = { us / 1000000, (us % 1000000) * 1000 };
+    ppoll(pfd, n, us < 0 ? NULL : &ts, NULL);
+}
+
+void ctl_lane(int tick, int lane, LaneState state)
+{
+    if (!page || page->state[lane] == state)
+        return;
+
+    LaneState prev = (LaneState)page->state[lane];
+    __atomic_store_n(&page->state[lane], (uint8_t)state, __ATOMIC_RELAXED);
+    __atomic_store_n(&page->n_state[prev], page->n_state[prev] - 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&page->n_state[state], page->n_state[state] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&page->transitions, page->transitions + 1, __ATOMIC_RELEASE);
+
+    char ev[64];
+    int len = -1;
+    for (int i = 0; i < CTL_MAX_CLIENTS; i++) {
+        Client *c = &clients[i];
+        if (c->fd < 0 || (c->watch != -1 && c->watch != lane))
+            continue;
+        if (len < 0)
+            len = snprintf(ev, sizeof(ev), "ev %d %d %s %s\n", tick, lane,
+                           state_name(prev), state_name(state));
+        out_append(c, ev, len);
+    }
+}
+
+void ctl_pll(int on)
+{
+    if (page)
+        __atomic_store_n(&page->pll, on, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,100 @@
+#ifndef CTL_H
+#define CTL_H
+
+#include <stdint.h>
+
+#include "serdes_sim.h"
+#include "lane_snap.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Control socket and status page (-C <socket>)
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Besides stdin, the scheduler takes commands from local clients on a
+ *  Unix stream socket (ctl_client.h is the library, marctl the CLI).
+ *  The protocol is text lines:
+ *
+ *    s [lane]  d <lane> <rate>  r <lane>  p     as typed at the console
+ *    q [lane]        one key=value record per lane (for programs)
+ *    w [lane]        watch state transitions, of all lanes or one
+ *    u               stop watching
+ *    (empty line)    does nothing: a round-trip probe
+ *
+ *  Each command is answered, in order, by whatever it prints and then a
+ *  line "ok" or "err <reason>".  A client may write any number of
+ *  commands at once: every complete line that has arrived runs in the
+ *  same tick and the replies go back in one write.  Watched transitions
+ *  arrive between replies as
+ *
+ *    ev <tick> <lane> <from> <to>
+ *
+ *  The sockets are polled once per tick, and the time slice between
+ *  ticks is spent in ppoll() on them rather than usleep(), so a command
+ *  waits at most for the step in progress.
+ *
+ *  Status page: the greeting sent on connect, "marsched <version>
+ *  <lanes>", carries a read-only memfd (SCM_RIGHTS) holding a CtlPage.
+ *  The scheduler keeps the tick, the PLL switch and every lane's state
+ *  up to date in it, so a client can watch those with plain loads and
+ *  no syscall.  `transitions` is bumped (release) after each change.
+ *  After the states comes the lanes' snapshot table (lane_snap.h), which
+ *  the scheduler publishes into at every step: a client reads full
+ *  lane status from it with lane_snap_read(), again without a syscall.
+ *
+ *  The scheduler never waits for a client: one that stops reading is
+ *  dropped once CTL_OUT_MAX bytes are queued for it.
+ */
+#define CTL_VERSION      2
+#define CTL_MAX_CLIENTS  64
+#define CTL_IN_MAX       65536      /* unread command bytes per client    */
+#define CTL_OUT_MAX      (16 << 20) /* unsent reply bytes per client      */
+#define CTL_WAIT_FDS     4          /* caller's fds in one ctl_wait()     */
+
+typedef struct {
+    uint32_t version;               /* CTL_VERSION                        */
+    int32_t  pid;
+    int32_t  lanes;
+    int32_t  tick;                  /* tick being run                     */
+    int32_t  pll;
+    uint32_t transitions;           /* state changes so far               */
+    uint32_t n_state[ERROR + 1];    /* lanes in each state                */
+    uint8_t  state[];               /* LaneState of each lane             */
+} CtlPage;
+
+/* Where the snapshot table starts, and the size of the whole page */
+static inline size_t ctl_snaps_offset(int lanes)
+{
+    return (sizeof(CtlPage) + lanes + 63) & ~(size_t)63;
+}
+
+static inline size_t ctl_page_size(int lanes)
+{
+    return ctl_snaps_offset(lanes) + lane_snap_table_size(lanes);
+}
+
+/* Listen on `path` for a run of `lanes` lanes.  Returns 0, or -1 after
+ * saying why (e.g. another scheduler already serves it). */
+int  ctl_open(const char *path, int lanes);
+void ctl_close(void);               /* flushes replies, removes the socket */
+
+int  ctl_clients(void);             /* clients connected                   */
+LaneSnapTable *ctl_snaps(void);     /* the page's snapshot table           */
+
+/* Accept clients, send what is queued and run every complete command
+ * line through exec(arg, line), with stdout going to that client.
+ * exec returns 0, or -1 for a command it does not take. */
+void ctl_poll(int tick, int (*exec)(void *arg, const char *cmd), void *arg);
+
+/* usleep() that returns early when a client has something to say */
+void ctl_sleep(long us);
+
+/* As ctl_sleep(), also returning when one of `fds` is readable
+ * (negative entries are skipped).  us < 0: no time limit. */
+void ctl_wait(const int *fds, int n_fds, long us);
+
+/* Lane `lane` is (now) in `state`: page update, and an event for the
+ * clients watching it if that is a change. */
+void ctl_lane(int tick, int lane, LaneState state);
+void ctl_pll(int on);
+
+#endif /* CTL_H */
@@ -0,0 +1,196 @@
+/*
+ * ctl_client.c
+ *
+ * Client side of the scheduler's control socket (see ctl_client.h).
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "ctl_client.h"
+
+/* Next line from the socket, '\n' replaced by NUL; it stays valid until
+ * the next call.  NULL if the connection broke or the timeout passed. */
+static char *next_line(CtlClient *c, int timeout_ms)
+{
+    for (;;) {
+        char *nl = memchr(c->buf + c->pos, '\n', c->len - c->pos);
+        if (nl) {
+            char *line = c->buf + c->pos;
+            *nl = '\0';
+            c->pos = nl + 1 - c->buf;
+            return line;
+        }
+        if (c->pos) {
+            memmove(c->buf, c->buf + c->pos, c->len - c->pos);
+            c->len -= c->pos;
+            c->pos = 0;
+        }
+        if (c->len == CTL_CLIENT_BUF) {
+            errno = EMSGSIZE;
+            return NULL;
+        }
+        if (timeout_ms >= 0) {
+            struct pollfd p = { c->fd, POLLIN, 0 };
+            int r = poll(&p, 1, timeout_ms);
+            if (r <= 0) {
+                if (r == 0) errno = ETIMEDOUT;
+                return NULL;
+            }
+        }
+        ssize_t n = recv(c->fd, c->buf + c->len, CTL_CLIENT_BUF - c->len, 0);
+        if (n <= 0) {
+            if (n == 0) errno = ECONNRESET;
+            return NULL;
+        }
+        c->len += n;
+    }
+}
+
+static int parse_event(const char *line, CtlEvent *ev)
+{
+    return sscanf(line, "ev %d %d %7s %7s", &ev->tick, &ev->lane, ev->from, ev->to) == 4;
+}
+
+int ctl_connect(CtlClient *c, const char *path)
+{
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    c->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c->fd < 0 || connect(c->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        goto fail;
+
+    /* greeting, with the status page's fd */
+    union {
+        struct cmsghdr h;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctrl;
+    struct iovec iov = { c->buf, CTL_CLIENT_BUF };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = ctrl.buf, .msg_controllen = sizeof(ctrl.buf) };
+    ssize_t n = recvmsg(c->fd, &msg, MSG_CMSG_CLOEXEC);
+    if (n <= 0) {
+        errno = n ? errno : ECONNREFUSED;   /* closed on us: server full */
+        goto fail;
+    }
+    c->len = n;
+
+    int page_fd = -1;
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    if (cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+        memcpy(&page_fd, CMSG_DATA(cm), sizeof(int));
+
+    int version = 0;
+    char *line = next_line(c, 1000);
+    if (!line || sscanf(line, "marsched %d %d", &version, &c->lanes) != 2 ||
+        version != CTL_VERSION || page_fd < 0) {
+        if (page_fd >= 0) close(page_fd);
+        errno = EPROTO;
+        goto fail;
+    }
+
+    c->page_size = ctl_page_size(c->lanes);
+    void *p = mmap(NULL, c->page_size, PROT_READ, MAP_SHARED, page_fd, 0);
+    close(page_fd);
+    if (p == MAP_FAILED)
+        goto fail;
+    c->page  = p;
+    c->snaps = (const LaneSnapTable *)((const char *)p + ctl_snaps_offset(c->lanes));
+    return 0;
+
+fail:
+    if (c->fd >= 0) {
+        int e = errno;
+        close(c->fd);
+        errno = e;
+    }
+    c->fd = -1;
+    return -1;
+}
+
+void ctl_disconnect(CtlClient *c)
+{
+    if (c->page)
+        munmap((void *)c->page, c->page_size);
+    if (c->fd >= 0)
+        close(c->fd);
+    c->page = NULL;
+    c->fd = -1;
+}
+
+int ctl_send(CtlClient *c, const char *cmds, size_t len)
+{
+    while (len) {
+        ssize_t n = send(c->fd, cmds, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        cmds += n;
+        len  -= n;
+    }
+    return 0;
+}
+
+int ctl_reply(CtlClient *c, char *out, size_t n, int timeout_ms)
+{
+    size_t used = 0;
+    if (out && n)
+        out[0] = '\0';
+
+    char *line;
+    while ((line = next_line(c, timeout_ms))) {
+        CtlEvent ev;
+        if (strncmp(line, "ev ", 3) == 0 && parse_event(line, &ev)) {
+            if (c->on_event)
+                c->on_event(&ev, c->event_arg);
+            continue;
+        }
+        int ok = strcmp(line, "ok") == 0;
+        int err = strncmp(line, "err", 3) == 0;
+        if (ok)
+            return 0;
+        if (out && used < n)
+            used += snprintf(out + used, n - used, "%s\n", line);
+        if (err)
+            return 1;
+    }
+    return -1;
+}
+
+int ctl_command(CtlClient *c, const char *cmd, char *out, size_t n)
+{
+    size_t len = strlen(cmd);
+    char line[CTL_IN_MAX];
+    if (len + 1 >= sizeof(line) || memchr(cmd, '\n', len)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(line, cmd, len);
+    line[len++] = '\n';
+    if (ctl_send(c, line, len) != 0)
+        return -1;
+    return ctl_reply(c, out, n, -1);
+}
+
+int ctl_event(CtlClient *c, CtlEvent *ev, int timeout_ms)
+{
+    char *line;
+    while ((line = next_line(c, timeout_ms)))
+        if (strncmp(line, "ev ", 3) == 0 && parse_event(line, ev))
+            return 1;
+    return errno == ETIMEDOUT ? 0 : -1;
+}
@@ -0,0 +1,68 @@
+#ifndef CTL_CLIENT_H
+#define CTL_CLIENT_H
+
+#include <stddef.h>
+
+#include "ctl.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Control-socket client library (protocol: ctl.h)
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *    CtlClient c;
+ *    ctl_connect(&c, "/run/marsched.sock");
+ *    ctl_command(&c, "r 3", out, sizeof(out));        one round trip
+ *
+ *    ctl_send(&c, "r 1\nr 2\nq 1\n", len);             a batch ...
+ *    for (int i = 0; i < 3; i++)
+ *        ctl_reply(&c, out, sizeof(out), -1);          ... one reply each
+ *
+ *    c.page->state[lane], c.page->tick                 no syscall
+ *    lane_snap_read(c.snaps, lane, &st)                 nor here
+ *
+ *  Transitions of watched lanes ("w [lane]") come in between replies.
+ *  While replies are outstanding, ctl_reply() hands them to on_event if
+ *  it is set (and drops them otherwise); with none outstanding, read them
+ *  with ctl_event().
+ */
+#define CTL_CLIENT_BUF  65536
+
+typedef struct {
+    int  tick, lane;
+    char from[8], to[8];
+} CtlEvent;
+
+typedef struct {
+    int            fd;
+    int            lanes;
+    const CtlPage *page;            /* the scheduler's status page        */
+    const LaneSnapTable *snaps;     /* … and its lane snapshots           */
+    size_t         page_size;
+
+    void (*on_event)(const CtlEvent *ev, void *arg);
+    void  *event_arg;
+
+    char   buf[CTL_CLIENT_BUF];     /* received, not yet consumed         */
+    int    pos, len;
+} CtlClient;
+
+/* Connect and map the status page.  Returns 0, or -1 with errno set. */
+int  ctl_connect(CtlClient *c, const char *path);
+void ctl_disconnect(CtlClient *c);
+
+/* Write one or more newline-terminated commands as they are. */
+int  ctl_send(CtlClient *c, const char *cmds, size_t len);
+
+/* Read the reply to the oldest outstanding command: its output goes to
+ * out (truncated to n, NUL-terminated; may be NULL), followed on failure
+ * by the "err" line.  Returns 0 for "ok", 1 for "err", -1 if the
+ * connection broke or timeout_ms (-1: none) passed. */
+int  ctl_reply(CtlClient *c, char *out, size_t n, int timeout_ms);
+
+/* ctl_send() of one line plus ctl_reply() */
+int  ctl_command(CtlClient *c, const char *cmd, char *out, size_t n);
+
+/* Next watched transition: 1, 0 on timeout, -1 if the connection broke */
+int  ctl_event(CtlClient *c, CtlEvent *ev, int timeout_ms);
+
+#endif /* CTL_CLIENT_H */
@@ -0,0 +1,182 @@
+/*
+ * fair.c
+ *
+ * Virtual-runtime run queue for marsched (see fair.h).
+ */
+
+#include <stdlib.h>
+
+#include "fair.h"
+
+/* CFS weights for nice 0..19 */
+static const int prio_to_weight[] = {
+    1024,  820,  655,  526,  423,  335,  272,  215,  172,  137,
+     110,   87,   70,   56,   45,   36,   29,   23,   18,   15,
+};
+#define N_WEIGHTS ((int)(sizeof(prio_to_weight) / sizeof(prio_to_weight[0])))
+
+typedef struct {
+    uint64_t vruntime;
+    uint64_t seq;                   /* FIFO among equal vruntimes         */
+    int      weight;
+    int      pos;                   /* index in heap[], −1 if not queued  */
+} FairLane;
+
+static FairLane *lanes;
+static int      *heap;              /* lane ids, min-heap on key          */
+static int       n_heap;
+static int       boost_steps;
+static uint64_t  min_vruntime;
+static uint64_t  next_seq;
+
+static int before(int a, int b)
+{
+    const FairLane *x = &lanes[a], *y = &lanes[b];
+    return x->vruntime != y->vruntime ? x->vruntime < y->vruntime : x->seq < y->seq;
+}
+
+static void place(int i, int lane)
+{
+    heap[i] = lane;
+    lanes[lane].pos = i;
+}
+
+static void sift_up(int i)
+{
+    int lane = heap[i];
+    while (i > 0 && before(lane, heap[(i - 1) / 2])) {
+        place(i, heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    place(i, lane);
+}
+
+static void sift_down(int i)
+{
+    int lane = heap[i];
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= n_heap) break;
+        if (c + 1 < n_heap && before(heap[c + 1], heap[c])) c++;
+        if (!before(heap[c], lane)) break;
+        place(i, heap[c]);
+        i = c;
+    }
+    place(i, lane);
+}
+
+static void queue(int lane)
+{
+    if (lanes[lane].pos >= 0) {
+        sift_up(lanes[lane].pos);
+        sift_down(lanes[lane].pos);
+    } else {
+        place(n_heap++, lane);
+        sift_up(n_heap - 1);
+    }
+}
+
+static void dequeue(int lane)
+{
+    int i = lanes[lane].pos;
+    if (i < 0) return;
+    lanes[lane].pos = -1;
+    if (i == --n_heap) return;
+    int moved = heap[n_heap];
+    place(i, moved);
+    sift_up(i);
+    sift_down(lanes[moved].pos);
+}
+
+static uint64_t step_cost(const FairLane *l)
+{
+    return (uint64_t)FAIR_UNIT * FAIR_NICE0_WEIGHT / (uint64_t)l->weight;
+}
+
+static void update_min(void)
+{
+    if (n_heap > 0 && lanes[heap[0]].vruntime > min_vruntime)
+        min_vruntime = lanes[heap[0]].vruntime;
+}
+
+int fair_init(int n, int boost)
+{
+    lanes = calloc(n, sizeof(FairLane));
+    heap  = calloc(n, sizeof(int));
+    if (!lanes || !heap) {
+        fair_free();
+        return -1;
+    }
+    for (int i = 0; i < n; i++)
+        lanes[i].pos = -1;
+    n_heap      = 0;
+    boost_steps = boost;
+    /* headroom below the start so a boosted lane never wraps */
+    min_vruntime = (uint64_t)1 << 40;
+    next_seq     = 0;
+    return 0;
+}
+
+void fair_free(void)
+{
+    free(lanes);
+    free(heap);
+    lanes = NULL;
+    heap  = NULL;
+    n_heap = 0;
+}
+
+void fair_add(int lane, int priority)
+{
+    FairLane *l = &lanes[lane];
+    int nice = priority < 0 ? 0 : priority >= N_WEIGHTS ? N_WEIGHTS - 1 : priority;
+    l->weight   = prio_to_weight[nice];
+    l->vruntime = min_vruntime;
+    l->seq      = next_seq++;
+    queue(lane);
+}
+
+void fair_restart(int lane)
+{
+    FairLane *l = &lanes[lane];
+    l->vruntime = min_vruntime - (uint64_t)boost_steps * step_cost(l);
+    l->seq      = next_seq++;
+    queue(lane);
+}
+
+int fair_pick(void)
+{
+    return n_heap > 0 ? heap[0] : -1;
+}
+
+void fair_charge(int lane, int done)
+{
+    FairLane *l = &lanes[lane];
+    l->vruntime += step_cost(l);
+    l->seq       = next_seq++;
+    if (done)
+        dequeue(lane);
+    else
+        sift_down(l->pos);
+    update_min();
+}
+
+int64_t fair_vruntime(int lane)
+{
+    return (int64_t)(lanes[lane].vruntime - min_vruntime);
+}
+
+int fair_weight(int lane)
+{
+    return lanes[lane].weight;
+}
+
+uint64_t fair_vruntime_raw(int lane)
+{
+    return lanes[lane].vruntime;
+}
+
+uint64_t fair_min_vruntime(void)
+{
+    return min_vruntime;
+}
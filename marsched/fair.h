@@ -0,0 +1,57 @@
+#ifndef FAIR_H
+#define FAIR_H
+
+#include <stdint.h>
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Weighted fair scheduling on virtual runtime
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  CFS-style: every runnable lane has a virtual runtime that advances by
+ *  FAIR_UNIT · NICE0_WEIGHT / weight per step, and the lane with the
+ *  smallest vruntime runs next.  A lane's priority (0 = most important)
+ *  is used as a nice level into the CFS weight table, so each level
+ *  gets about 1.25x the CPU share of the next.  Lanes with equal
+ *  vruntime run in FIFO order of their last step, which is plain
+ *  round-robin when all weights are equal.
+ *
+ *  The run queue is an indexed binary min-heap on (vruntime, seq): the
+ *  pick is O(1) and charging a step, restarting or retiring a lane is
+ *  O(log n).
+ *
+ *  min_vruntime follows the smallest runnable vruntime and never goes
+ *  back.  A lane that restarts (soft reset, rate change) rejoins at
+ *  min_vruntime minus a boost of `boost` steps of its own weight.  That
+ *  lead is used up step by step as the lane runs, so a fresh lane gets
+ *  ahead for at most `boost` steps and then shares the CPU again.  It
+ *  never starves the others for longer than that.
+ */
+#define FAIR_UNIT           1024    /* vruntime per step at NICE0_WEIGHT  */
+#define FAIR_NICE0_WEIGHT   1024
+#define FAIR_BOOST_DEFAULT  128     /* steps; -b                          */
+
+/* Run queue for lanes 0 .. n−1, all empty.  Returns 0, or -1 if out of
+ * memory. */
+int  fair_init(int n, int boost);
+void fair_free(void);
+
+/* Lane becomes runnable for the first time with `priority`. */
+void fair_add(int lane, int priority);
+
+/* Lane restarts training: (re)join near min_vruntime with the boost. */
+void fair_restart(int lane);
+
+/* Lane to run next, -1 if none is runnable. */
+int  fair_pick(void);
+
+/* Picked lane ran one step; done != 0 if it finished (leaves the queue). */
+void fair_charge(int lane, int done);
+
+int64_t fair_vruntime(int lane);    /* relative to min_vruntime           */
+int     fair_weight(int lane);
+
+/* The two halves of fair_vruntime(), for status snapshots read later */
+uint64_t fair_vruntime_raw(int lane);
+uint64_t fair_min_vruntime(void);
+
+#endif /* FAIR_H */
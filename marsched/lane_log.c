@@ -0,0 +1,630 @@
+/*
+ * lane_log.c
+ *
+ * Asynchronous, lock-free lane logger.
+ *
+ *   producer (scheduler thread)          writer thread
+ *   ───────────────────────────          ─────────────
+ *   lane_log_begin()  reserve n slots
+ *   lane_log_next()   fill LogRecord      drain every ring
+ *   lane_log_commit() publish tail  ───▶  lane_log_format() → sched.log
+ *
+ * Each producer thread gets its own SPSC ring on first use, so the only
+ * shared state on the hot path is one release store of the ring tail.
+ * When a ring is full the record group is dropped and counted; the
+ * scheduler never waits for the disk.
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "lane_log.h"
+#include "sched_trace.h"
+
+_Static_assert(sizeof(LogRecord) == 64, "LogRecord must stay one cache line");
+
+#define LOG_RING_MASK   (LOG_RING_SIZE - 1)
+#define LOG_IDLE_NS     500000      /* writer sleep when all rings empty  */
+
+typedef struct {
+    _Atomic uint32_t head;          /* consumer cursor (writer)           */
+    char             pad0[60];
+    _Atomic uint32_t tail;          /* published producer cursor          */
+    uint32_t         wr;            /* producer reservation cursor        */
+    uint32_t         cached_head;   /* producer's last view of head       */
+    _Atomic uint64_t dropped;       /* records lost to a full ring        */
+    _Atomic uint64_t limited;       /* records suppressed by rate limit   */
+    double           tokens[LOG_NUM_CATS];
+    uint64_t         refill_ns[LOG_NUM_CATS];
+    char             pad1[64];
+    LogRecord        rec[LOG_RING_SIZE];
+} LogRing;
+
+FILE   *log_fp = NULL;
+uint8_t log_cat_level[LOG_NUM_CATS] = {
+    [LOG_CAT_STEP]       = LOG_TRACE,
+    [LOG_CAT_CTLE]       = LOG_TRACE,
+    [LOG_CAT_RX]         = LOG_TRACE,
+    [LOG_CAT_TRANSITION] = LOG_TRACE,
+    [LOG_CAT_CMD]        = LOG_TRACE,
+};
+uint8_t log_lane_level[LOG_MAX_LANES];
+uint8_t log_default_lane_level = LOG_TRACE;
+
+static double log_rate[LOG_NUM_CATS];      /* records/s, 0 = unlimited   */
+static int    lane_levels_init = 0;
+
+static LogRing          *rings[LOG_MAX_RINGS];
+static _Atomic int       ring_count = 0;
+static pthread_mutex_t   ring_lock  = PTHREAD_MUTEX_INITIALIZER;
+static __thread LogRing *tls_ring   = NULL;
+static _Atomic uint32_t  ring_gen   = 1;   /* bumped when rings are freed */
+static __thread uint32_t tls_gen    = 0;   /* ring_gen tls_ring is from   */
+
+static pthread_t   writer;
+static int         writer_running = 0;
+static atomic_int  writer_stop    = 0;
+static uint64_t    written        = 0;
+
+static TraceWriter trace;
+static int         trace_on       = 0;
+
+static const char *cat_names[LOG_NUM_CATS] = {
+    [LOG_CAT_STEP]       = "step",
+    [LOG_CAT_CTLE]       = "ctle",
+    [LOG_CAT_RX]         = "rx",
+    [LOG_CAT_TRANSITION] = "transition",
+    [LOG_CAT_CMD]        = "cmd",
+};
+
+static const char *level_names[] = { "off", "info", "debug", "trace" };
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Configuration
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static void init_lane_levels(void)
+{
+    if (lane_levels_init) return;
+    memset(log_lane_level, log_default_lane_level, sizeof(log_lane_level));
+    lane_levels_init = 1;
+}
+
+static int parse_level(const char *s)
+{
+    for (int i = 0; i <= LOG_TRACE; i++)
+        if (strcmp(s, level_names[i]) == 0)
+            return i;
+    if (s[0] >= '0' && s[0] <= '3' && s[1] == '\0')
+        return s[0] - '0';
+    return -1;
+}
+
+static int parse_cat(const char *s)
+{
+    for (int i = 0; i < LOG_NUM_CATS; i++)
+        if (strcmp(s, cat_names[i]) == 0)
+            return i;
+    return -1;
+}
+
+int lane_log_config(const char *spec)
+{
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    init_lane_levels();
+
+    for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok;
+         tok = strtok_r(NULL, ",", &save))
+    {
+        char *eq = strchr(tok, '=');
+        if (!eq) return -1;
+        *eq = '\0';
+        const char *key = tok, *val = eq + 1;
+
+        if (strncmp(key, "rate.", 5) == 0) {
+            int cat = parse_cat(key + 5);
+            if (cat < 0) return -1;
+            log_rate[cat] = atof(val);
+            continue;
+        }
+
+        int lvl = parse_level(val);
+        if (lvl < 0) return -1;
+
+        if (strcmp(key, "lanes") == 0) {
+            log_default_lane_level = (uint8_t)lvl;
+            memset(log_lane_level, lvl, sizeof(log_lane_level));
+        } else if (strncmp(key, "lane", 4) == 0) {
+            int lane = atoi(key + 4);
+            if (lane < 0 || lane >= LOG_MAX_LANES) return -1;
+            log_lane_level[lane] = (uint8_t)lvl;
+        } else {
+            int cat = parse_cat(key);
+            if (cat < 0) return -1;
+            log_cat_level[cat] = (uint8_t)lvl;
+        }
+    }
+    return 0;
+}
+
+void lane_log_usage(FILE *fp)
+{
+    fprintf(fp, "  -v <spec>  log verbosity, comma separated:\n");
+    fprintf(fp, "               step|ctle|rx|transition|cmd=off|info|debug|trace\n");
+    fprintf(fp, "               lanes=<level>  lane<N>=<level>  rate.<cat>=<records/s>\n");
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Producer side
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static LogRing *ring_register(void)
+{
+    LogRing *r = NULL;
+
+    pthread_mutex_lock(&ring_lock);
+    int n = atomic_load_explicit(&ring_count, memory_order_relaxed);
+    if (n < LOG_MAX_RINGS) {
+        r = aligned_alloc(64, sizeof(LogRing));
+        if (r) {
+            memset(r, 0, offsetof(LogRing, rec));
+            rings[n] = r;
+            atomic_store_explicit(&ring_count, n + 1, memory_order_release);
+        }
+    }
+    tls_gen = atomic_load_explicit(&ring_gen, memory_order_relaxed);
+    pthread_mutex_unlock(&ring_lock);
+
+    tls_ring = r;
+    return r;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* token bucket, one second of burst; only consulted when a rate is set */
+static int rate_take(LogRing *r, LogCategory cat, int n)
+{
+    if (r->tokens[cat] < n) {
+        uint64_t now = now_ns();
+        r->tokens[cat] += (double)(now - r->refill_ns[cat]) * 1e-9 * log_rate[cat];
+        r->refill_ns[cat] = now;
+        if (r->tokens[cat] > log_rate[cat])
+            r->tokens[cat] = log_rate[cat];
+        if (r->tokens[cat] < n)
+            return 0;
+    }
+    r->tokens[cat] -= n;
+    return 1;
+}
+
+int lane_log_begin(LogCategory cat, int n)
+{
+    /* a ring from before the last lane_log_stop() has been freed */
+    LogRing *r = tls_ring && tls_gen == atomic_load_explicit(&ring_gen, memory_order_acquire)
+               ? tls_ring : ring_register();
+    if (!r) return 0;
+
+    if (log_rate[cat] > 0.0 && !rate_take(r, cat, n)) {
+        atomic_fetch_add_explicit(&r->limited, n, memory_order_relaxed);
+        return 0;
+    }
+
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (tail - r->cached_head + n > LOG_RING_SIZE) {
+        r->cached_head = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (tail - r->cached_head + n > LOG_RING_SIZE) {
+            atomic_fetch_add_explicit(&r->dropped, n, memory_order_relaxed);
+            return 0;
+        }
+    }
+    r->wr = tail;
+    return 1;
+}
+
+LogRecord *lane_log_next(void)
+{
+    LogRecord *rec = &tls_ring->rec[tls_ring->wr++ & LOG_RING_MASK];
+    memset(rec, 0, sizeof(*rec));
+    return rec;
+}
+
+void lane_log_commit(void)
+{
+    atomic_store_explicit(&tls_ring->tail, tls_ring->wr, memory_order_release);
+}
+
+static LogRecord *rec_hdr(int tick, int lane, LogKind kind)
+{
+    LogRecord *rec = lane_log_next();
+    rec->tick = (uint32_t)tick;
+    rec->lane = (uint16_t)lane;
+    rec->kind = (uint8_t)kind;
+    return rec;
+}
+
+void lane_log_text(int tick, int lane, LogCategory cat, LogLevel lvl,
+                   const char *fmt, int a0, int a1, int a2)
+{
+    if (!lane_log_enabled(lane, cat, lvl) || !lane_log_begin(cat, 1))
+        return;
+    LogRecord *rec = rec_hdr(tick, lane, LOG_REC_TEXT);
+    rec->u.text.fmt  = fmt;
+    rec->u.text.a[0] = a0;
+    rec->u.text.a[1] = a1;
+    rec->u.text.a[2] = a2;
+    lane_log_commit();
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  SerDes lane records
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static int vec_records(int total)
+{
+    return (total + LOG_VEC_CHUNK - 1) / LOG_VEC_CHUNK;
+}
+
+static void put_vec(int tick, int lane, LogVecId id,
+                    const double *v, int total)
+{
+    for (int start = 0; start < total; start += LOG_VEC_CHUNK) {
+        LogRecord *rec = rec_hdr(tick, lane, LOG_REC_VEC);
+        rec->aux           = (uint8_t)id;
+        rec->u.vec.start   = start;
+        rec->u.vec.total   = total;
+        for (int k = 0; k < LOG_VEC_CHUNK && start + k < total; k++)
+            rec->u.vec.v[k] = v[start + k];
+    }
+}
+
+void lane_log_step(int tick, int lane, const LaneContext *ctx)
+{
+    if (!lane_log_enabled(lane, LOG_CAT_STEP, LOG_TRACE) ||
+        !lane_log_begin(LOG_CAT_STEP, 1))
+        return;
+    LogRecord *rec = rec_hdr(tick, lane, LOG_REC_STEP);
+    rec->aux          = (uint8_t)ctx->state;
+    rec->u.step.pt     = ctx->pt;
+    rec->u.step.n_samp = ctx->N_samp;
+    lane_log_commit();
+}
+
+void lane_log_step_prio(int tick, int lane, const LaneContext *ctx, int prio)
+{
+    if (!lane_log_enabled(lane, LOG_CAT_STEP, LOG_TRACE) ||
+        !lane_log_begin(LOG_CAT_STEP, 1))
+        return;
+    LogRecord *rec = rec_hdr(tick, lane, LOG_REC_STEP_PRIO);
+    rec->aux          = (uint8_t)ctx->state;
+    rec->u.step.pt     = ctx->pt;
+    rec->u.step.n_samp = ctx->N_samp;
+    rec->u.step.prio   = prio;
+    lane_log_commit();
+}
+
+void lane_log_progress(int tick, int lane, const LaneContext *ctx,
+                       LaneState prev, int prev_pt, int prev_ia, int prev_iz)
+{
+    /* CTLE sweep: log when a grid point completes (ia or iz advanced) */
+    if (ctx->state == CTLE && prev == CTLE) {
+        int old_grid = prev_ia + prev_iz * CTLE_NA;
+        int new_grid = ctx->ia + ctx->iz * CTLE_NA;
+        if (new_grid != old_grid &&
+            lane_log_enabled(lane, LOG_CAT_CTLE, LOG_DEBUG) &&
+            lane_log_begin(LOG_CAT_CTLE, 1))
+        {
+            LogRecord *rec = rec_hdr(tick, lane, LOG_REC_CTLE_GRID);
+            rec->u.grid.old_grid = old_grid;
+            rec->u.grid.new_grid = new_grid;
+            rec->u.grid.A_prev   = ctx->A_vec[prev_ia];
+            rec->u.grid.z_prev   = ctx->z_vec[prev_iz];
+            rec->u.grid.J        = ctx->J[prev_ia][prev_iz];
+            rec->u.grid.A_new    = ctx->ctle_A;
+            rec->u.grid.z_new    = ctx->ctle_z;
+            lane_log_commit();
+        }
+    }
+
+    /* RX progress: log taps every 25% */
+    if (ctx->state == RX && prev == RX) {
+        int quarter = ctx->N_samp / 4;
+        if (quarter > 0 && prev_pt / quarter != ctx->pt / quarter &&
+            lane_log_enabled(lane, LOG_CAT_RX, LOG_DEBUG) &&
+            lane_log_begin(LOG_CAT_RX, 1 + vec_records(RX_FFE_LEN)))
+        {
+            LogRecord *rec = rec_hdr(tick, lane, LOG_REC_RX_PROGRESS);
+            rec->u.rx.pct      = (ctx->pt * 100) / ctx->N_samp;
+            rec->u.rx.ffe_main = ctx->RX_FFE[RX_FFE_PRE];
+            rec->u.rx.dfe0     = ctx->DFE[0];
+            put_vec(tick, lane, LOG_VEC_RX_PROGRESS, ctx->RX_FFE, RX_FFE_LEN);
+            lane_log_commit();
+        }
+    }
+}
+
+void lane_log_transition(int tick, int lane, const LaneContext *ctx,
+                         LaneState prev)
+{
+    if (!lane_log_enabled(lane, LOG_CAT_TRANSITION, LOG_INFO))
+        return;
+
+    int n = 2;
+    if (prev == INIT) n += 1 + vec_records(TX_FFE_LEN);
+    if (prev == CTLE) n += 1 + CTLE_NA * vec_records(1 + CTLE_NZ);
+    if (prev == RX)   n += vec_records(RX_FFE_LEN) + vec_records(N_DFE);
+    if (!lane_log_begin(LOG_CAT_TRANSITION, n))
+        return;
+
+    LogRecord *rec = rec_hdr(tick, lane, LOG_REC_TRANS);
+    rec->aux          = (uint8_t)prev;
+    rec->u.trans.next = ctx->state;
+
+    if (prev == INIT) {
+        rec = rec_hdr(tick, lane, LOG_REC_TRANS_INIT);
+        rec->u.init.file    = ctx->channel_file;
+        rec->u.init.L       = ctx->L;
+        rec->u.init.rate    = ctx->dataRateGbps;
+        rec->u.init.Fs      = ctx->Fs;
+        rec->u.init.instant = ctx->sample_instant;
+        rec->u.init.lag     = ctx->lag;
+        put_vec(tick, lane, LOG_VEC_TX_FFE, ctx->TX_FFE, TX_FFE_LEN);
+    }
+
+    if (prev == CTLE) {
+        rec = rec_hdr(tick, lane, LOG_REC_TRANS_CTLE);
+        rec->u.ctle.A = ctx->ctle_A;
+        rec->u.ctle.z = ctx->ctle_z;
+        rec->u.ctle.p = ctx->ctle_p;
+        for (int a = 0; a < CTLE_NA; a++) {
+            double row[1 + CTLE_NZ];
+            row[0] = ctx->A_vec[a];
+            memcpy(row + 1, ctx->J[a], sizeof(ctx->J[a]));
+            put_vec(tick, lane, LOG_VEC_CTLE_ROW, row, 1 + CTLE_NZ);
+        }
+    }
+
+    if (prev == RX) {
+        put_vec(tick, lane, LOG_VEC_RX_FINAL,  ctx->RX_FFE, RX_FFE_LEN);
+        put_vec(tick, lane, LOG_VEC_DFE_FINAL, ctx->DFE,    N_DFE);
+    }
+
+    rec_hdr(tick, lane, LOG_REC_TRANS_END);
+    lane_log_commit();
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Text rendering — byte-for-byte the layout of the old direct fprintf
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static void format_vec(FILE *fp, const LogRecord *r)
+{
+    int start = r->u.vec.start, total = r->u.vec.total;
+    int n = total - start;
+    if (n > LOG_VEC_CHUNK) n = LOG_VEC_CHUNK;
+    int last = (start + n == total);
+
+    switch ((LogVecId)r->aux) {
+        case LOG_VEC_RX_PROGRESS:
+        case LOG_VEC_TX_FFE:
+            if (start == 0)
+                fputs(r->aux == LOG_VEC_TX_FFE ? "  TX FFE:    ["
+                                               : "               RX_FFE = [", fp);
+            for (int k = 0; k < n; k++)
+                fprintf(fp, "%s%+.6f", start + k ? ", " : "", r->u.vec.v[k]);
+            if (last) fputs("]\n", fp);
+            break;
+
+        case LOG_VEC_CTLE_ROW:
+            for (int k = 0; k < n; k++) {
+                double v = r->u.vec.v[k];
+                if (start + k == 0)
+                    fprintf(fp, "    A=%.4f |", v);
+                else if (v < 1e20)
+                    fprintf(fp, " %10.6f", v);
+                else
+                    fprintf(fp, "        N/A");
+            }
+            if (last) fputc('\n', fp);
+            break;
+
+        case LOG_VEC_RX_FINAL:
+            if (start == 0)
+                fprintf(fp, "  RX FFE taps (%d total):\n", total);
+            for (int k = 0; k < n; k++)
+                fprintf(fp, "    RX_FFE[%2d] = %+.8f%s\n", start + k, r->u.vec.v[k],
+                        start + k == RX_FFE_PRE ? "  <-- main cursor" : "");
+            break;
+
+        case LOG_VEC_DFE_FINAL:
+            if (start == 0)
+                fprintf(fp, "  DFE taps (%d total):\n", total);
+            for (int k = 0; k < n; k++)
+                fprintf(fp, "    DFE[%d]    = %+.8f\n", start + k, r->u.vec.v[k]);
+            break;
+    }
+}
+
+void lane_log_format(FILE *fp, const LogRecord *r)
+{
+    switch ((LogKind)r->kind) {
+        case LOG_REC_STEP:
+            fprintf(fp, "[tick %8u] Lane %2d  state=%-4s  pt=%d/%d\n",
+                    r->tick, r->lane, state_name((LaneState)r->aux),
+                    r->u.step.pt, r->u.step.n_samp);
+            break;
+
+        case LOG_REC_STEP_PRIO:
+            fprintf(fp, "[tick %8u] Lane %2d  state=%-4s  pt=%d/%d  prio=%d\n",
+                    r->tick, r->lane, state_name((LaneState)r->aux),
+                    r->u.step.pt, r->u.step.n_samp, r->u.step.prio);
+            break;
+
+        case LOG_REC_CTLE_GRID:
+            fprintf(fp, "             Lane %2d  CTLE sweep: completed grid [%d/%d]"
+                    "  A=%.4f z=%.3e  MSE=%.6f\n",
+                    r->lane, r->u.grid.old_grid + 1, CTLE_NA * CTLE_NZ,
+                    r->u.grid.A_prev, r->u.grid.z_prev, r->u.grid.J);
+            fprintf(fp, "             Lane %2d  CTLE sweep: now testing [%d/%d]"
+                    "  A=%.4f z=%.3e\n",
+                    r->lane, r->u.grid.new_grid + 1, CTLE_NA * CTLE_NZ,
+                    r->u.grid.A_new, r->u.grid.z_new);
+            break;
+
+        case LOG_REC_RX_PROGRESS:
+            fprintf(fp, "             Lane %2d  RX training %d%%  RX_FFE[main]=%.6f"
+                    "  DFE[0]=%.6f\n",
+                    r->lane, r->u.rx.pct, r->u.rx.ffe_main, r->u.rx.dfe0);
+            break;
+
+        case LOG_REC_VEC:
+            format_vec(fp, r);
+            break;
+
+        case LOG_REC_TRANS:
+            fprintf(fp, "========== Lane %2d TRANSITION: %s → %s (tick %u) ==========\n",
+                    r->lane, state_name((LaneState)r->aux),
+                    state_name((LaneState)r->u.trans.next), r->tick);
+            break;
+
+        case LOG_REC_TRANS_INIT:
+            fprintf(fp, "  Channel:  %s (%d taps)\n", r->u.init.file, r->u.init.L);
+            fprintf(fp, "  Data rate: %d Gbps  Fs=%.3e Hz\n",
+                    r->u.init.rate, r->u.init.Fs);
+            fprintf(fp, "  CDR:       sample_instant=%d  lag=%d\n",
+                    r->u.init.instant, r->u.init.lag);
+            break;
+
+        case LOG_REC_TRANS_CTLE:
+            fprintf(fp, "  Best CTLE: A=%.6f  z=%.6e  p=%.6e\n",
+                    r->u.ctle.A, r->u.ctle.z, r->u.ctle.p);
+            fprintf(fp, "  Sweep MSE grid (A rows x z cols):\n");
+            break;
+
+        case LOG_REC_TRANS_END:
+            fprintf(fp, "==========================================================\n");
+            break;
+
+        case LOG_REC_TEXT:
+            fprintf(fp, "[tick %8u] ", r->tick);
+            fprintf(fp, r->u.text.fmt,
+                    r->u.text.a[0], r->u.text.a[1], r->u.text.a[2]);
+            break;
+    }
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Writer thread
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static size_t drain_rings(void)
+{
+    size_t total = 0;
+    int n = atomic_load_explicit(&ring_count, memory_order_acquire);
+
+    for (int i = 0; i < n; i++) {
+        LogRing *r = rings[i];
+        uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+        uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+        total += tail - head;
+        for (; head != tail; head++) {
+            if (trace_on)
+                trace_encode(&trace, &r->rec[head & LOG_RING_MASK]);
+            else
+                lane_log_format(log_fp, &r->rec[head & LOG_RING_MASK]);
+        }
+
+        atomic_store_explicit(&r->head, head, memory_order_release);
+    }
+    written += total;
+    return total;
+}
+
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    struct timespec idle = { 0, LOG_IDLE_NS };
+
+    for (;;) {
+        int stop = atomic_load_explicit(&writer_stop, memory_order_acquire);
+        if (drain_rings() == 0) {
+            if (stop) break;
+            fflush(trace_on ? trace.fp : log_fp);
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+int lane_log_trace(FILE *tfp)
+{
+    if (writer_running || trace_writer_open(&trace, tfp) != 0)
+        return -1;
+    trace_on = 1;
+    return 0;
+}
+
+int lane_log_start(FILE *fp)
+{
+    if (!fp) return -1;
+    init_lane_levels();
+
+    log_fp = fp;
+    atomic_store(&writer_stop, 0);
+    if (pthread_create(&writer, NULL, writer_main, NULL) != 0) {
+        perror("pthread_create(lane_log)");
+        log_fp = NULL;
+        return -1;
+    }
+    writer_running = 1;
+    return 0;
+}
+
+void lane_log_stop(void)
+{
+    if (!writer_running) return;
+
+    atomic_store_explicit(&writer_stop, 1, memory_order_release);
+    pthread_join(writer, NULL);
+    writer_running = 0;
+
+    uint64_t dropped = 0, limited = 0;
+    pthread_mutex_lock(&ring_lock);
+    atomic_fetch_add(&ring_gen, 1);
+    int n = atomic_load(&ring_count);
+    for (int i = 0; i < n; i++) {
+        dropped += atomic_load(&rings[i]->dropped);
+        limited += atomic_load(&rings[i]->limited);
+        free(rings[i]);
+        rings[i] = NULL;
+    }
+    atomic_store(&ring_count, 0);
+    pthread_mutex_unlock(&ring_lock);
+    tls_ring = NULL;
+
+    if (trace_on) {
+        fprintf(log_fp, "=== trace: %llu words (%llu bytes) ===\n",
+                (unsigned long long)trace.words,
+                (unsigned long long)trace.words * 8);
+        trace_writer_close(&trace);
+        trace_on = 0;
+    }
+    fprintf(log_fp, "=== log: %llu records, %llu dropped, %llu rate-limited ===\n",
+            (unsigned long long)written, (unsigned long long)dropped,
+            (unsigned long long)limited);
+    fflush(log_fp);
+    if (dropped)
+        fprintf(stderr, "Warning: %llu log records dropped (ring full)\n",
+                (unsigned long long)dropped);
+    log_fp = NULL;
+}
@@ -0,0 +1,167 @@
+#ifndef LANE_LOG_H
+#define LANE_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "serdes_sim.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Asynchronous lane logger
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  The scheduler hot path never formats text.  Each producer thread owns
+ *  a single-producer/single-consumer ring of fixed-size LogRecords; a
+ *  background writer thread drains every ring and renders the records
+ *  into sched.log in the same text layout the scheduler used to fprintf
+ *  directly.
+ *
+ *  A record group (e.g. a state transition with its CTLE grid) is
+ *  published atomically: either every record of the group reaches the
+ *  ring or the whole group is counted as dropped.  Producers never block.
+ */
+
+#define LOG_RING_SIZE   16384       /* records per producer (power of 2)  */
+#define LOG_MAX_RINGS   64          /* max producer threads               */
+#define LOG_MAX_LANES   4096        /* lanes with individual verbosity    */
+#define LOG_VEC_CHUNK   6           /* doubles carried by one VEC record  */
+
+typedef enum {
+    LOG_OFF   = 0,
+    LOG_INFO  = 1,                  /* transitions, commands              */
+    LOG_DEBUG = 2,                  /* CTLE grid / RX progress            */
+    LOG_TRACE = 3                   /* every scheduler step               */
+} LogLevel;
+
+typedef enum {
+    LOG_CAT_STEP = 0,
+    LOG_CAT_CTLE,
+    LOG_CAT_RX,
+    LOG_CAT_TRANSITION,
+    LOG_CAT_CMD,
+    LOG_NUM_CATS
+} LogCategory;
+
+typedef enum {
+    LOG_REC_STEP = 0,               /* [tick] Lane state pt/N             */
+    LOG_REC_STEP_PRIO,              /* same, with scheduler priority      */
+    LOG_REC_CTLE_GRID,              /* CTLE sweep grid point completed    */
+    LOG_REC_RX_PROGRESS,            /* RX training quarter reached        */
+    LOG_REC_VEC,                    /* chunk of a tap / grid vector       */
+    LOG_REC_TRANS,                  /* transition banner                  */
+    LOG_REC_TRANS_INIT,             /* INIT results                       */
+    LOG_REC_TRANS_CTLE,             /* best CTLE point                    */
+    LOG_REC_TRANS_END,              /* closing banner                     */
+    LOG_REC_TEXT                    /* deferred printf, static format     */
+} LogKind;
+
+typedef enum {
+    LOG_VEC_RX_PROGRESS = 0,        /* "RX_FFE = [..]" progress line      */
+    LOG_VEC_TX_FFE,                 /* "TX FFE:    [..]"                  */
+    LOG_VEC_CTLE_ROW,               /* [A, J(A,z0) .. J(A,zN)]            */
+    LOG_VEC_RX_FINAL,               /* one line per RX FFE tap            */
+    LOG_VEC_DFE_FINAL               /* one line per DFE tap               */
+} LogVecId;
+
+/* 64 bytes: one cache line per record */
+typedef struct {
+    uint32_t tick;
+    uint16_t lane;
+    uint8_t  kind;                  /* LogKind                            */
+    uint8_t  aux;                   /* state / vector id, kind-specific   */
+    union {
+        struct { int32_t pt, n_samp, prio; } step;
+        struct { int32_t old_grid, new_grid;
+                 double A_prev, z_prev, J, A_new, z_new; } grid;
+        struct { int32_t pct; double ffe_main, dfe0; } rx;
+        struct { int32_t start, total; double v[LOG_VEC_CHUNK]; } vec;
+        struct { int32_t next; } trans;
+        struct { int32_t L, rate, instant, lag;
+                 double Fs; const char *file; } init;
+        struct { double A, z, p; } ctle;
+        struct { const char *fmt; int32_t a[3]; } text;
+    } u;
+} LogRecord;
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Verbosity — read by producers on every call, written at start-up
+ * ═══════════════════════════════════════════════════════════════════════ */
+extern uint8_t log_cat_level[LOG_NUM_CATS];
+extern uint8_t log_lane_level[LOG_MAX_LANES];
+extern uint8_t log_default_lane_level;
+extern FILE   *log_fp;
+
+static inline int lane_log_enabled(int lane, LogCategory cat, LogLevel lvl)
+{
+    if (!log_fp || lvl > log_cat_level[cat])
+        return 0;
+    int lane_lvl = ((unsigned)lane < LOG_MAX_LANES) ? log_lane_level[lane]
+                                                     : log_default_lane_level;
+    return (int)lvl <= lane_lvl;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Lifecycle / configuration
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  lane_log_start()     Take ownership of fp and start the writer.
+ *                       Anything already written to fp stays in front.
+ *
+ *  lane_log_stop()      Drain all rings, print drop statistics, join
+ *                       the writer.  fp is flushed but not closed.
+ *                       Every ring is freed: a thread that logs later
+ *                       sees the generation change and registers a new
+ *                       one.  A record group still open on another
+ *                       thread is not covered, so producers must have
+ *                       logged their last record (or been joined) first.
+ *
+ *  lane_log_trace()     Call before lane_log_start(): records are then
+ *                       encoded into tfp as a binary trace (sched_trace.h)
+ *                       instead of being rendered into fp.
+ *
+ *  lane_log_config()    Parse a comma-separated verbosity spec:
+ *                         <cat>=<level>       step=off, ctle=debug, ...
+ *                         lane<N>=<level>     lane3=trace
+ *                         lanes=<level>       default for all lanes
+ *                         rate.<cat>=<n>      max n records/s (0 = off)
+ *                       Returns 0 on success, -1 on a malformed spec.
+ */
+int  lane_log_start (FILE *fp);
+int  lane_log_trace (FILE *tfp);
+void lane_log_stop  (void);
+int  lane_log_config(const char *spec);
+void lane_log_usage (FILE *fp);
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Producer side
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  lane_log_begin(cat, n)  Reserve n records in this thread's ring.
+ *                          Returns 0 if the group is dropped (ring
+ *                          full or rate-limited); the caller then
+ *                          skips lane_log_next()/lane_log_commit().
+ *  lane_log_next()         Next reserved slot (header is zeroed).
+ *  lane_log_commit()       Publish the reserved group to the writer.
+ */
+int        lane_log_begin (LogCategory cat, int n);
+LogRecord *lane_log_next  (void);
+void       lane_log_commit(void);
+
+/* Record one `[tick] ...` line with a static format and up to 3 ints. */
+void lane_log_text(int tick, int lane, LogCategory cat, LogLevel lvl,
+                   const char *fmt, int a0, int a1, int a2);
+
+/* SerDes lane helpers — snapshot what the old fprintf calls printed. */
+void lane_log_step      (int tick, int lane, const LaneContext *ctx);
+void lane_log_step_prio (int tick, int lane, const LaneContext *ctx,
+                         int prio);
+void lane_log_progress  (int tick, int lane, const LaneContext *ctx,
+                         LaneState prev, int prev_pt,
+                         int prev_ia, int prev_iz);
+void lane_log_transition(int tick, int lane, const LaneContext *ctx,
+                         LaneState prev);
+
+/* Render one record as text (used by the writer thread). */
+void lane_log_format(FILE *fp, const LogRecord *r);
+
+#endif /* LANE_LOG_H */
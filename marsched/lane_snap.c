@@ -0,0 +1,88 @@
+/*
+ * lane_snap.c
+ *
+ * Seqlock-published lane status snapshots (see lane_snap.h).
+ */
+
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "lane_snap.h"
+#include "fair.h"
+
+size_t lane_snap_table_size(int lanes)
+{
+    return sizeof(LaneSnapTable) + (size_t)lanes * sizeof(LaneSnap);
+}
+
+void lane_snap_table_init(LaneSnapTable *t, int base, int lanes)
+{
+    memset(t, 0, lane_snap_table_size(lanes));
+    t->base  = base;
+    t->lanes = lanes;
+    t->pid   = getpid();
+    for (int i = 0; i < lanes; i++)
+        t->lane[i].st.lane = base + i;
+}
+
+void lane_snap_table_own(LaneSnapTable *t)
+{
+    __atomic_store_n(&t->pid, getpid(), __ATOMIC_RELAXED);
+}
+
+void lane_snap_publish(LaneSnapTable *t, int i, const LaneStatus *st,
+                       uint64_t vruntime, uint64_t min_vruntime)
+{
+    LaneSnap *s = &t->lane[i];
+    uint32_t seq = s->seq;
+
+    __atomic_store_n(&s->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    s->vruntime = vruntime;
+    s->st = *st;
+    __atomic_store_n(&s->seq, seq + 2, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&t->min_vruntime, min_vruntime, __ATOMIC_RELAXED);
+}
+
+/* Has the table's writer exited?  A child of ours (the -w coordinator
+ * reading a worker) may not be reaped yet, so ask waitid() without
+ * reaping it; for any other process, whether the pid is still there. */
+static int writer_gone(const LaneSnapTable *t)
+{
+    pid_t pid = __atomic_load_n(&t->pid, __ATOMIC_RELAXED);
+    if (pid <= 0)
+        return 1;
+    siginfo_t info;
+    info.si_pid = 0;
+    if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0)
+        return info.si_pid == pid;
+    return kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+int lane_snap_read(const LaneSnapTable *t, int i, LaneStatus *st)
+{
+    const LaneSnap *s = &t->lane[i];
+
+    for (int tries = 1; ; tries++) {
+        uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (!(seq & 1)) {
+            uint64_t vruntime = s->vruntime;
+            *st = s->st;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq) {
+                uint64_t min = __atomic_load_n(&t->min_vruntime, __ATOMIC_RELAXED);
+                st->vruntime = (int64_t)(vruntime - min) / FAIR_UNIT;
+                return 0;
+            }
+        }
+        if (tries % LANE_SNAP_RETRIES == 0 && writer_gone(t))
+            return -1;
+        if (tries >= LANE_SNAP_SPINS)
+            sched_yield();      /* let a preempted writer finish */
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef LANE_SNAP_H
+#define LANE_SNAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "serdes_sim.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Lane status snapshots, published under a seqlock
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Whoever steps a lane publishes a LaneStatus for it at every step
+ *  boundary (and after a reset), into a LaneSnapTable that may sit in
+ *  memory shared with other processes: the shard mapping for -w, the
+ *  status page for -C.  's', 'q', the -w coordinator and marctl all
+ *  read the snapshots and never touch a live LaneContext.
+ *
+ *  Each snapshot has a sequence count, odd while it is being written:
+ *
+ *    writer   seq+1, fence, copy, seq+2 (release)     never waits
+ *    reader   seq (acquire), copy, fence, seq again    retries if it
+ *             changed or was odd
+ *
+ *  So a reader always gets one whole step's view of a lane, never a mix,
+ *  and the lane's owner never waits for a reader.  Reading every lane
+ *  is one pass over the table: plain loads, no locks, no syscalls.  A
+ *  writer caught halfway is usually just preempted (a -P stage thread,
+ *  a -w worker on a shared CPU): after LANE_SNAP_SPINS tries the reader
+ *  yields the CPU between tries, and every LANE_SNAP_RETRIES it checks
+ *  on the table's writer process.  It gives up (returns -1) only once
+ *  that process is gone, rather than wait on a snapshot it died in the
+ *  middle of.
+ *
+ *  Snapshots hold the raw vruntime.  The table's min_vruntime is stored
+ *  with every publish, and a read turns the pair back into fair_vruntime()
+ *  steps, so a lane that has not run lately still shows where it stands.
+ */
+#define LANE_SNAP_SPINS     100
+#define LANE_SNAP_RETRIES   1000
+#define LANE_SNAP_NAME_MAX  64
+
+/* One lane as 's' shows it */
+typedef struct {
+    int         lane;
+    LaneState   state;
+    InitPhase   init_phase;
+    int         init_pt;
+    int         pt, n_samp;         /* CTLE/RX progress                   */
+    int         rate;
+    int         weight;             /* 0: not fair-scheduled (-P)         */
+    int64_t     vruntime;           /* steps, relative to the shard's min */
+    int         sample_instant, lag;
+    int         sweep;              /* CTLE grid point                    */
+    double      ctle_A, ctle_z;
+    double      mse;                /* slicer error (LaneContext.mse)     */
+    double      RX_FFE[RX_FFE_LEN];
+    double      DFE[N_DFE];
+    int         load_err;
+    char        channel_file[LANE_SNAP_NAME_MAX];  /* ERROR only          */
+} LaneStatus;
+
+typedef struct {
+    uint32_t   seq;
+    uint64_t   vruntime;            /* raw (fair_vruntime_raw)            */
+    LaneStatus st;
+} __attribute__((aligned(64))) LaneSnap;
+
+typedef struct {
+    uint64_t   min_vruntime;        /* of the run queue the lanes are on  */
+    int32_t    base, lanes;         /* global lane ids base .. base+lanes−1 */
+    int32_t    pid;                 /* writer's process                   */
+    LaneSnap   lane[];
+} __attribute__((aligned(64))) LaneSnapTable;
+
+size_t lane_snap_table_size(int lanes);
+void   lane_snap_table_init(LaneSnapTable *t, int base, int lanes);
+/* The calling process writes `t` from now on (a -w worker, after fork) */
+void   lane_snap_table_own(LaneSnapTable *t);
+
+/* Writer: snapshot of local lane i */
+void   lane_snap_publish(LaneSnapTable *t, int i, const LaneStatus *st,
+                         uint64_t vruntime, uint64_t min_vruntime);
+
+/* Reader: 0 and *st filled in, or -1 if the writer died mid-update */
+int    lane_snap_read(const LaneSnapTable *t, int i, LaneStatus *st);
+
+#endif /* LANE_SNAP_H */
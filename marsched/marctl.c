@@ -0,0 +1,204 @@
+/*
+ * marctl.c
+ *
+ * Command-line client for the scheduler's control socket (sched -C).
+ *
+ *   marctl <socket> <command ...>   run one command, print its output
+ *   marctl <socket> -               commands from stdin, sent in batches
+ *   marctl <socket> watch [lane]    print state transitions as they happen
+ *   marctl <socket> page            print the status page and lane snapshots
+ *                                   (no command sent)
+ *   marctl <socket> ping [n]        round-trip latency, one by one and batched
+ *
+ * Exit status: 0, 1 if a command was refused, 2 if the scheduler could
+ * not be reached.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "ctl_client.h"
+
+#define BATCH_BYTES  32768
+
+static char reply[1 << 20];
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int broken(const char *what)
+{
+    fprintf(stderr, "marctl: %s: %s\n", what, strerror(errno));
+    return 2;
+}
+
+/* stdin: whole lines, up to BATCH_BYTES at a time, each batch sent in one
+ * write and its replies read before the next */
+static int run_batches(CtlClient *c)
+{
+    static char batch[BATCH_BYTES];
+    char line[512];
+    int status = 0, eof = 0;
+
+    while (!eof) {
+        size_t len = 0;
+        int count = 0;
+        while (len + sizeof(line) <= sizeof(batch)) {
+            if (!fgets(line, sizeof(line), stdin)) {
+                eof = 1;
+                break;
+            }
+            size_t n = strlen(line);
+            if (n == 0 || line[n - 1] != '\n')
+                line[n++] = '\n';
+            memcpy(batch + len, line, n);
+            len += n;
+            count++;
+        }
+        if (count && ctl_send(c, batch, len) != 0)
+            return broken("send");
+        for (int i = 0; i < count; i++) {
+            int rc = ctl_reply(c, reply, sizeof(reply), -1);
+            if (rc < 0)
+                return broken("reply");
+            fputs(reply, stdout);
+            if (rc)
+                status = 1;
+        }
+    }
+    return status;
+}
+
+static int watch(CtlClient *c, const char *lane)
+{
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), lane ? "w %s" : "w", lane);
+    int rc = ctl_command(c, cmd, reply, sizeof(reply));
+    if (rc) {
+        fputs(reply, stderr);
+        return rc < 0 ? broken("watch") : 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    CtlEvent ev;
+    while (ctl_event(c, &ev, -1) == 1)
+        printf("[%d] Lane %d %s → %s\n", ev.tick, ev.lane, ev.from, ev.to);
+    return 0;
+}
+
+/* Straight from the shared page: no command, no syscall per lane */
+static void print_page(const CtlClient *c)
+{
+    const CtlPage *p = c->page;
+    printf("pid %d  tick %d  PLL %s  transitions %u\n", p->pid,
+           __atomic_load_n(&p->tick, __ATOMIC_RELAXED), p->pll ? "ON" : "OFF",
+           __atomic_load_n(&p->transitions, __ATOMIC_ACQUIRE));
+    for (int s = INIT; s <= ERROR; s++)
+        printf("  %-5s %d\n", state_name((LaneState)s), p->n_state[s]);
+
+    for (int i = 0; i < c->lanes; i++) {
+        LaneStatus st;
+        if (lane_snap_read(c->snaps, i, &st) != 0) {
+            printf("  Lane %2d  (no consistent snapshot)\n", i);
+            continue;
+        }
+        printf("  Lane %2d  %-5s", i, state_name(st.state));
+        if (st.weight)
+            printf(" vrt=%+lld", (long long)st.vruntime);
+        if (st.state == INIT)
+            printf("  %s %d", init_phase_name(st.init_phase), st.init_pt);
+        else if (st.state == CTLE || st.state == RX)
+            printf("  pt %d/%d", st.pt, st.n_samp);
+        if (st.state != INIT && st.state != ERROR)
+            printf("  A=%.4f z=%.3e MSE=%.3e", st.ctle_A, st.ctle_z, st.mse);
+        if (st.state == ERROR)
+            printf("  '%s': %s", st.channel_file, st.load_err ? strerror(st.load_err) : "no taps");
+        printf("\n");
+    }
+}
+
+static int ping(CtlClient *c, int n)
+{
+    double *rtt = malloc(n * sizeof(double));
+    char *batch = malloc(n);
+    if (!rtt || !batch) {
+        fprintf(stderr, "marctl: out of memory\n");
+        return 2;
+    }
+
+    for (int i = 0; i < n; i++) {
+        double t0 = now_us();
+        if (ctl_command(c, "", NULL, 0) != 0)
+            return broken("ping");
+        rtt[i] = now_us() - t0;
+    }
+    qsort(rtt, n, sizeof(double), bench_cmp_double);
+    printf("%d round trips (us): min %.1f  median %.1f  p99 %.1f  max %.1f\n", n,
+           rtt[0], rtt[bench_rank(n, 50)], rtt[bench_rank(n, 99)], rtt[n - 1]);
+
+    memset(batch, '\n', n);
+    double t0 = now_us();
+    if (ctl_send(c, batch, n) != 0)
+        return broken("send");
+    for (int i = 0; i < n; i++)
+        if (ctl_reply(c, NULL, 0, -1) != 0)
+            return broken("reply");
+    double dt = now_us() - t0;
+    printf("%d in one batch: %.1f us, %.2f us per command, %.0f commands/s\n",
+           n, dt, dt / n, n / dt * 1e6);
+
+    free(rtt);
+    free(batch);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <socket> <command ...>   run one command (s, q, d, r, p)\n"
+                        "       %s <socket> -               commands from stdin, batched\n"
+                        "       %s <socket> watch [lane]    print state transitions\n"
+                        "       %s <socket> page            print the shared status page\n"
+                        "       %s <socket> ping [n]        round-trip latency (default n=1000)\n",
+                argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 2;
+    }
+
+    CtlClient *c = malloc(sizeof(CtlClient));
+    if (!c || ctl_connect(c, argv[1]) != 0)
+        return broken(argv[1]);
+
+    int status;
+    if (strcmp(argv[2], "-") == 0) {
+        status = run_batches(c);
+    } else if (strcmp(argv[2], "watch") == 0) {
+        status = watch(c, argc > 3 ? argv[3] : NULL);
+    } else if (strcmp(argv[2], "page") == 0) {
+        print_page(c);
+        status = 0;
+    } else if (strcmp(argv[2], "ping") == 0) {
+        int n = argc > 3 ? atoi(argv[3]) : 1000;
+        status = ping(c, n > 0 ? n : 1);
+    } else {
+        char cmd[256] = "";
+        size_t len = 0;
+        for (int i = 2; i < argc && len < sizeof(cmd); i++)
+            len += snprintf(cmd + len, sizeof(cmd) - len, "%s%s", i > 2 ? " " : "", argv[i]);
+        int rc = ctl_command(c, cmd, reply, sizeof(reply));
+        if (rc < 0)
+            return broken(cmd);
+        fputs(reply, rc ? stderr : stdout);
+        status = rc;
+    }
+
+    ctl_disconnect(c);
+    free(c);
+    return status;
+}
@@ -0,0 +1,266 @@
+/*
+ * pipeline.c
+ *
+ * Stage queues and threads for pipelined training (see pipeline.h).
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pipeline.h"
+#include "serdes_sim.h"
+
+/* One per stage, and one more for lanes going home.  A lane is in at
+ * most one queue at a time, so `lanes` slots are always enough. */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;
+    int            *ring;
+    int             head, count, max_count;
+    uint64_t        taken;          /* lanes taken from it …              */
+    uint64_t        wait_ns;        /* … the time they had queued …       */
+    uint64_t        wait_max_ns;    /* … and the longest                  */
+} PipeQueue;
+
+typedef struct {
+    pthread_t thread;
+    int       id, stage;
+    uint64_t  busy_ns;              /* CPU time, taken when it stops      */
+} StageThread;
+
+#define HOME PIPE_STAGES
+
+static PipeQueue    queues[PIPE_STAGES + 1];
+static StageThread  workers[PIPE_MAX_THREADS];
+static int          n_workers, n_threads[PIPE_STAGES];
+static int          n_lanes, stopping, started;
+static PipeOps      ops;
+static uint64_t    *queued_ns;      /* per lane: when it joined its queue */
+static uint8_t     *recall;         /* per lane: pipe_recall()            */
+static uint64_t     start_ns, stop_ns;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void push(PipeQueue *q, int lane)
+{
+    pthread_mutex_lock(&q->lock);
+    queued_ns[lane] = now_ns();
+    q->ring[(q->head + q->count) % n_lanes] = lane;
+    if (++q->count > q->max_count)
+        q->max_count = q->count;
+    pthread_cond_signal(&q->ready);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Head of `q` into *lane: 1, or 0 once stopping or (timeout_us >= 0)
+ * when nothing came in time */
+static int pop(PipeQueue *q, int *lane, long timeout_us)
+{
+    struct timespec until;
+    if (timeout_us > 0) {
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_sec  += timeout_us / 1000000;
+        until.tv_nsec += (timeout_us % 1000000) * 1000;
+        if (until.tv_nsec >= 1000000000) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !stopping && timeout_us != 0) {
+        if (timeout_us < 0)
+            pthread_cond_wait(&q->ready, &q->lock);
+        else if (pthread_cond_timedwait(&q->ready, &q->lock, &until) == ETIMEDOUT)
+            break;
+    }
+    int got = q->count > 0 && !stopping;
+    if (got) {
+        *lane = q->ring[q->head];
+        q->head = (q->head + 1) % n_lanes;
+        q->count--;
+        uint64_t w = now_ns() - queued_ns[*lane];
+        q->taken++;
+        q->wait_ns += w;
+        if (w > q->wait_max_ns)
+            q->wait_max_ns = w;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+static void *stage_main(void *arg)
+{
+    StageThread *w = arg;
+    int lane;
+
+    if (ops.enter)
+        ops.enter(ops.arg, w->id, w->stage);
+    while (pop(&queues[w->stage], &lane, -1)) {
+        int next = ops.slice(ops.arg, w->id, w->stage, lane);
+        push(&queues[next == PIPE_HOME ? HOME : next], lane);
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    w->busy_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    if (ops.leave)
+        ops.leave(ops.arg, w->id, w->stage);
+    return NULL;
+}
+
+int pipe_parse(const char *s, int threads[PIPE_STAGES])
+{
+    int total = 0;
+    for (int i = 0; i < PIPE_STAGES; i++) {
+        char *end;
+        long n = strtol(s, &end, 10);
+        if (end == s || n < 1 || *end != (i + 1 < PIPE_STAGES ? ',' : '\0'))
+            return -1;
+        threads[i] = (int)n;
+        total += n;
+        s = end + 1;
+    }
+    return total <= PIPE_MAX_THREADS ? 0 : -1;
+}
+
+int pipe_start(const int threads[PIPE_STAGES], int lanes, const PipeOps *o)
+{
+    ops      = *o;
+    n_lanes  = lanes;
+    stopping = 0;
+    queued_ns = calloc(lanes, sizeof(uint64_t));
+    recall    = calloc(lanes, 1);
+    if (!queued_ns || !recall)
+        return -1;
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    for (int q = 0; q <= HOME; q++) {
+        memset(&queues[q], 0, sizeof(queues[q]));
+        pthread_mutex_init(&queues[q].lock, NULL);
+        pthread_cond_init(&queues[q].ready, &ca);
+        queues[q].ring = malloc(lanes * sizeof(int));
+        if (!queues[q].ring)
+            return -1;
+    }
+    pthread_condattr_destroy(&ca);
+
+    start_ns  = now_ns();
+    n_workers = 0;
+    for (int s = 0; s < PIPE_STAGES; s++) {
+        n_threads[s] = threads[s];
+        for (int i = 0; i < threads[s]; i++) {
+            StageThread *w = &workers[n_workers];
+            w->id      = n_workers;
+            w->stage   = s;
+            w->busy_ns = 0;
+            if (pthread_create(&w->thread, NULL, stage_main, w) != 0) {
+                fprintf(stderr, "Error: cannot start pipeline stage threads\n");
+                pipe_stop();
+                return -1;
+            }
+            n_workers++;
+        }
+    }
+    started = 1;
+    return 0;
+}
+
+void pipe_stop(void)
+{
+    for (int q = 0; q <= HOME; q++)
+        pthread_mutex_lock(&queues[q].lock);
+    stopping = 1;
+    for (int q = 0; q <= HOME; q++) {
+        pthread_cond_broadcast(&queues[q].ready);
+        pthread_mutex_unlock(&queues[q].lock);
+    }
+    for (int i = 0; i < n_workers; i++)
+        pthread_join(workers[i].thread, NULL);
+    stop_ns = now_ns();
+
+    for (int q = 0; q <= HOME; q++) {
+        free(queues[q].ring);
+        queues[q].ring = NULL;
+    }
+    free(queued_ns);
+    free(recall);
+    queued_ns = NULL;
+    recall    = NULL;
+}
+
+void pipe_submit(int stage, int lane)
+{
+    push(&queues[stage], lane);
+}
+
+void pipe_recall(int lane)
+{
+    __atomic_store_n(&recall[lane], 1, __ATOMIC_RELAXED);
+}
+
+int pipe_recalled(int lane)
+{
+    return __atomic_load_n(&recall[lane], __ATOMIC_RELAXED);
+}
+
+int pipe_home(int *lane, long timeout_us)
+{
+    if (!pop(&queues[HOME], lane, timeout_us))
+        return 0;
+    recall[*lane] = 0;              /* home now: nothing left to recall   */
+    return 1;
+}
+
+int pipe_threads(int stage)
+{
+    return n_threads[stage];
+}
+
+void pipe_report(FILE *fp)
+{
+    if (!started)
+        return;
+    double wall = (stop_ns - start_ns) / 1e9;
+    int busiest = 0;
+    double util[PIPE_STAGES];
+
+    fprintf(fp, "Pipeline -P %d,%d,%d: %.3f s\n", n_threads[0], n_threads[1], n_threads[2], wall);
+    fprintf(fp, "  %-5s %7s %9s %9s %6s %13s %12s %10s\n", "stage", "threads", "slices",
+            "cpu s", "util", "wait mean ms", "wait max ms", "max queued");
+    for (int s = 0; s < PIPE_STAGES; s++) {
+        const PipeQueue *q = &queues[s];
+        uint64_t busy = 0;
+        for (int i = 0; i < n_workers; i++)
+            if (workers[i].stage == s)
+                busy += workers[i].busy_ns;
+        util[s] = wall > 0 ? busy / 1e9 / (wall * n_threads[s]) : 0;
+        if (util[s] > util[busiest])
+            busiest = s;
+        fprintf(fp, "  %-5s %7d %9llu %9.3f %5.0f%% %13.3f %12.3f %10d",
+                state_name((LaneState)s), n_threads[s], (unsigned long long)q->taken,
+                busy / 1e9, 100 * util[s], q->taken ? q->wait_ns / 1e6 / q->taken : 0.0,
+                q->wait_max_ns / 1e6, q->max_count);
+        if (n_threads[s] > 1) {
+            fprintf(fp, "  (per thread:");
+            for (int i = 0; i < n_workers; i++)
+                if (workers[i].stage == s)
+                    fprintf(fp, " %.0f%%", wall > 0 ? 100 * workers[i].busy_ns / 1e9 / wall : 0.0);
+            fprintf(fp, ")");
+        }
+        fprintf(fp, "\n");
+    }
+    fprintf(fp, "  busiest stage: %s (%.0f%%)\n", state_name((LaneState)busiest),
+            100 * util[busiest]);
+}
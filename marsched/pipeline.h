@@ -0,0 +1,73 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Pipelined training stages (-P <init>,<ctle>,<rx>)
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Instead of one thread stepping every lane, each training phase gets
+ *  its own stage: a queue of lanes and a pool of threads that only run
+ *  that phase, so each keeps its own code and tables warm (INIT's CDR
+ *  and histograms, CTLE's sweep, RX's LMS loop).
+ *
+ *    main ──▶ [INIT] ──▶ [CTLE] ──▶ [RX] ──▶ main
+ *               ▲  └─────────────────┴──────┘ (DONE, ERROR, parked,
+ *               └── main (reset, load done)     recalled)
+ *
+ *  A stage thread takes the lane at the head of its queue and runs it
+ *  for a slice (at most PIPE_SLICE_STEPS steps); the slice callback says
+ *  where the lane goes next: back to the tail of the same queue (more
+ *  of the phase, behind the others), to the next stage's queue (a phase
+ *  transition), or home to the main thread, which owns every lane that
+ *  is not in a stage: it parks and wakes them, applies commands, and
+ *  counts link-ups.  A lane is in one place at a time and the queue
+ *  hand-off orders its memory, so no lane state is ever shared.
+ *
+ *  pipe_recall() asks for a lane that is in a stage to be sent home at
+ *  its next slice boundary (an operator command for it, say).
+ *
+ *  pipe_report() is the sizing aid: per stage, the CPU time of its
+ *  threads over the wall time of the run (the rest they spent waiting
+ *  for work, or with more threads than cores, for a core), how long
+ *  lanes queued for it and how deep the queue got.  A stage near 100%
+ *  with long queue waits wants more threads; one mostly idle can give
+ *  some up.
+ */
+#define PIPE_STAGES         3       /* INIT, CTLE, RX                     */
+#define PIPE_HOME           (-1)    /* slice result: back to main         */
+#define PIPE_MAX_THREADS    32      /* all stages together                */
+#define PIPE_SLICE_STEPS    64
+
+typedef struct {
+    /* Run `lane` (in `stage`, on stage thread `worker`) for one slice;
+     * returns the stage it goes to next, or PIPE_HOME. */
+    int  (*slice)(void *arg, int worker, int stage, int lane);
+    /* On each stage thread before its first slice and after its last
+     * (either may be NULL) */
+    void (*enter)(void *arg, int worker, int stage);
+    void (*leave)(void *arg, int worker, int stage);
+    void  *arg;
+} PipeOps;
+
+/* "1,1,2": threads per stage into threads[].  Returns 0, or -1. */
+int  pipe_parse(const char *s, int threads[PIPE_STAGES]);
+
+/* Start the stage threads.  Returns 0, or -1 if they could not be. */
+int  pipe_start(const int threads[PIPE_STAGES], int lanes, const PipeOps *ops);
+
+/* Stop and join them; lanes still queued stay where they are. */
+void pipe_stop(void);
+
+void pipe_submit(int stage, int lane);      /* main → stage               */
+void pipe_recall(int lane);
+int  pipe_recalled(int lane);               /* for the slice callback     */
+
+/* Next lane sent home, waiting up to timeout_us for one: 1, or 0. */
+int  pipe_home(int *lane, long timeout_us);
+
+int  pipe_threads(int stage);
+void pipe_report(FILE *fp);
+
+#endif /* PIPELINE_H */
@@ -0,0 +1,300 @@
+/*
+ * rt.c
+ *
+ * Real-time execution mode: memory locking, prefaulting, SCHED_FIFO /
+ * SCHED_DEADLINE and CPU pinning of the lane thread, and its step
+ * latency histograms (see rt.h).
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <malloc.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "rt.h"
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+RtPolicy realtime = RT_OFF;
+
+__thread uint32_t rt_step_hist[DONE][RT_HIST_BUCKETS];
+__thread uint32_t rt_slice_hist[RT_HIST_BUCKETS];
+
+/* what rt_enter() got, on this thread */
+static __thread struct {
+    RtPolicy policy;                /* RT_OFF: stayed SCHED_OTHER         */
+    int      prio;
+    int      cpu;                   /* pinned to, -1 if not               */
+    int      locked;
+    long     minflt, majflt;        /* at the end of rt_enter()           */
+} got = { RT_OFF, 0, -1, 0, 0, 0 };
+
+/* struct sched_attr, which not every libc declares */
+struct rt_sched_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t  sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+};
+
+int rt_parse(const char *arg, RtPolicy *policy)
+{
+    if (strcmp(arg, "--realtime") == 0 || strcmp(arg, "--realtime=fifo") == 0)
+        *policy = RT_FIFO;
+    else if (strcmp(arg, "--realtime=deadline") == 0)
+        *policy = RT_DEADLINE;
+    else
+        return -1;
+    return 0;
+}
+
+static int set_deadline(void)
+{
+#ifdef SYS_sched_setattr
+    struct rt_sched_attr attr = {
+        .size           = sizeof(attr),
+        .sched_policy   = SCHED_DEADLINE,
+        .sched_runtime  = RT_DL_RUNTIME_US * 1000ull,
+        .sched_deadline = RT_DL_PERIOD_US * 1000ull,
+        .sched_period   = RT_DL_PERIOD_US * 1000ull,
+    };
+    return (int)syscall(SYS_sched_setattr, 0, &attr, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/* RT_FIFO_PRIO, or as high as RLIMIT_RTPRIO lets an unprivileged user go */
+static int set_fifo(int *prio)
+{
+    struct sched_param sp = { .sched_priority = RT_FIFO_PRIO };
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) == 0) {
+        *prio = sp.sched_priority;
+        return 0;
+    }
+    struct rlimit rl;
+    int err = errno;
+    if (err == EPERM && getrlimit(RLIMIT_RTPRIO, &rl) == 0 &&
+        rl.rlim_cur > 0 && rl.rlim_cur < RT_FIFO_PRIO) {
+        sp.sched_priority = (int)rl.rlim_cur;
+        if (sched_setscheduler(0, SCHED_FIFO, &sp) == 0) {
+            *prio = sp.sched_priority;
+            return 0;
+        }
+    }
+    errno = err;
+    return -1;
+}
+
+/* The slot-th CPU of /sys/devices/system/cpu/isolated (modulo their
+ * number), -1 if there are none */
+static int isolated_cpu(int slot)
+{
+    char buf[1024] = "";
+    FILE *f = fopen("/sys/devices/system/cpu/isolated", "r");
+    if (f) {
+        if (!fgets(buf, sizeof(buf), f))
+            buf[0] = '\0';
+        fclose(f);
+    }
+
+    int cpus[CPU_SETSIZE];
+    int n = 0;
+    char *s = buf;
+    while (n < CPU_SETSIZE) {
+        char *end;
+        long lo = strtol(s, &end, 10), hi = lo;
+        if (end == s)
+            break;
+        if (*end == '-') {
+            s = end + 1;
+            hi = strtol(s, &end, 10);
+        }
+        for (long c = lo; c >= 0 && c <= hi && c < CPU_SETSIZE && n < CPU_SETSIZE; c++)
+            cpus[n++] = (int)c;
+        if (*end != ',')
+            break;
+        s = end + 1;
+    }
+    return n ? cpus[slot % n] : -1;
+}
+
+static void __attribute__((noinline)) prefault_stack(void)
+{
+    volatile char stack[RT_STACK_PREFAULT];
+    long page = sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < sizeof(stack); i += page > 0 ? page : 4096)
+        stack[i] = 0;
+}
+
+/* Without the lock, fault in what mlockall(MCL_CURRENT) would have:
+ * every private writable mapping (heap, thread stacks, log rings) */
+static void populate_all(void)
+{
+#ifdef MADV_POPULATE_WRITE
+    FILE *f = fopen("/proc/self/maps", "r");
+    if (!f)
+        return;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long lo, hi;
+        char perms[5];
+        if (sscanf(line, "%lx-%lx %4s", &lo, &hi, perms) == 3 &&
+            perms[0] == 'r' && perms[1] == 'w' && perms[3] == 'p')
+            madvise((void *)lo, hi - lo, MADV_POPULATE_WRITE);
+    }
+    fclose(f);
+#endif
+}
+
+void rt_enter(RtPolicy policy, int slot)
+{
+    /* memory: lock what is mapped and whatever comes later, and keep
+     * malloc from handing pages back (they would fault in again) */
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+        got.locked = 1;
+    } else {
+        struct rlimit rl;
+        int err = errno;
+        if (getrlimit(RLIMIT_MEMLOCK, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY)
+            fprintf(stderr, "Warning: realtime: mlockall: %s (RLIMIT_MEMLOCK %lu KB); "
+                    "prefaulting only\n", strerror(err), (unsigned long)(rl.rlim_cur >> 10));
+        else
+            fprintf(stderr, "Warning: realtime: mlockall: %s; prefaulting only\n", strerror(err));
+        populate_all();
+    }
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    prefault_stack();
+    memset(rt_step_hist, 0, sizeof(rt_step_hist));
+    memset(rt_slice_hist, 0, sizeof(rt_slice_hist));
+
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+    if (policy == RT_DEADLINE) {
+        if (set_deadline() == 0) {
+            got.policy = RT_DEADLINE;
+        } else {
+            fprintf(stderr, "Warning: realtime: SCHED_DEADLINE: %s; trying SCHED_FIFO\n",
+                    strerror(errno));
+            policy = RT_FIFO;
+        }
+    }
+
+    if (policy == RT_FIFO) {
+        if (set_fifo(&got.prio) == 0)
+            got.policy = RT_FIFO;
+        else
+            fprintf(stderr, "Warning: realtime: SCHED_FIFO: %s; staying SCHED_OTHER\n",
+                    strerror(errno));
+
+        int cpu = isolated_cpu(slot);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (cpu >= 0)
+            CPU_SET(cpu, &set);
+        if (cpu < 0)
+            fprintf(stderr, "Warning: realtime: no isolated CPUs (isolcpus=); not pinned\n");
+        else if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            fprintf(stderr, "Warning: realtime: CPU %d: %s; not pinned\n", cpu, strerror(errno));
+        else
+            got.cpu = cpu;
+    }
+
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) == 0) {
+        got.minflt = ru.ru_minflt;
+        got.majflt = ru.ru_majflt;
+    }
+}
+
+void rt_hist_add(uint32_t *hist, uint64_t ns)
+{
+    int b;
+    if (ns < 16) {
+        b = (int)ns;
+    } else {
+        int e = 63 - __builtin_clzll(ns);
+        b = (e - 3) * 16 + (int)((ns >> (e - 4)) & 15);
+    }
+    hist[b]++;
+}
+
+/* lower bound of bucket b */
+static uint64_t bucket_ns(int b)
+{
+    if (b < 16)
+        return b;
+    return (uint64_t)(16 + b % 16) << (b / 16 - 1);
+}
+
+/* nearest-rank percentile, as bench.c does */
+static double hist_pct(const uint32_t *hist, uint64_t n, double p)
+{
+    uint64_t want = (uint64_t)(p / 100.0 * n + 0.999999), seen = 0;
+    if (want < 1)
+        want = 1;
+    for (int b = 0; b < RT_HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= want)
+            return bucket_ns(b) / 1e3;
+    }
+    return 0;
+}
+
+static void hist_line(FILE *fp, const char *name, const uint32_t *hist)
+{
+    uint64_t n = 0;
+    for (int b = 0; b < RT_HIST_BUCKETS; b++)
+        n += hist[b];
+    if (n == 0)
+        return;
+    double p50 = hist_pct(hist, n, 50), p999 = hist_pct(hist, n, 99.9);
+    fprintf(fp, "  %-14s %10llu %8.1f %8.1f %8.1f %8.1f %8.1f\n", name, (unsigned long long)n,
+            p50, hist_pct(hist, n, 99), p999, hist_pct(hist, n, 100), p999 - p50);
+}
+
+void rt_report(FILE *fp, const char *who)
+{
+    const char *policy = got.policy == RT_DEADLINE ? "SCHED_DEADLINE"
+                       : got.policy == RT_FIFO ? "SCHED_FIFO" : "SCHED_OTHER";
+    flockfile(fp);                  /* -P stage threads report together */
+    fprintf(fp, "Realtime%s%s: %s", who ? " " : "", who ? who : "", policy);
+    if (got.policy == RT_FIFO)
+        fprintf(fp, " prio %d", got.prio);
+    else if (got.policy == RT_DEADLINE)
+        fprintf(fp, " %d/%d us", RT_DL_RUNTIME_US, RT_DL_PERIOD_US);
+    if (got.cpu >= 0)
+        fprintf(fp, " on CPU %d", got.cpu);
+    fprintf(fp, ", memory %s", got.locked ? "locked" : "prefaulted, not locked");
+
+    struct rusage ru;
+    if (getrusage(RUSAGE_THREAD, &ru) == 0)
+        fprintf(fp, ", page faults while stepping: %ld minor, %ld major",
+                ru.ru_minflt - got.minflt, ru.ru_majflt - got.majflt);
+    fprintf(fp, "\n");
+
+    fprintf(fp, "  %-14s %10s %8s %8s %8s %8s %8s\n", "latency (us)", "count",
+            "p50", "p99", "p99.9", "max", "jitter");
+    for (int p = 0; p < DONE; p++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%s step", state_name((LaneState)p));
+        hist_line(fp, name, rt_step_hist[p]);
+    }
+    hist_line(fp, "slice overrun", rt_slice_hist);
+    funlockfile(fp);
+}
@@ -0,0 +1,83 @@
+#ifndef RT_H
+#define RT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "serdes_sim.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Real-time execution (--realtime[=fifo|deadline])
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  rt_enter() is called by the thread that steps the lanes (main, or
+ *  each -w worker) once everything is allocated and the helper threads
+ *  (logger, channel loader) are running, so they keep SCHED_OTHER:
+ *
+ *    memory    mlockall(MCL_CURRENT | MCL_FUTURE), malloc told never to
+ *              trim or mmap (freed memory stays locked), the stack
+ *              prefaulted; the caller prefaults the lane arena (whose
+ *              bitstreams are otherwise first touched mid-training)
+ *    policy    fifo:     SCHED_FIFO at RT_FIFO_PRIO (or RLIMIT_RTPRIO),
+ *                        pinned to an isolated CPU (isolcpus=): worker w
+ *                        takes the w-th, modulo their number
+ *              deadline: SCHED_DEADLINE reserving RT_DL_RUNTIME_US of
+ *                        every RT_DL_PERIOD_US; the kernel does not let
+ *                        such a thread be pinned, so it is not
+ *    timers    timer slack 1 ns, so the 10 us time slice between ticks
+ *              is not stretched to the default 50 us
+ *
+ *  Whatever is refused (no CAP_SYS_NICE / CAP_IPC_LOCK, RLIMIT_MEMLOCK
+ *  too small, deadline admission full, no isolated CPUs) is said once
+ *  on stderr and the run goes on with what it got: deadline falls back
+ *  to fifo, fifo to SCHED_OTHER, locking to prefaulting alone.
+ *
+ *  While it is on, every step's duration goes into a per-phase
+ *  histogram (log-linear: 16 buckets per power of two, so values are
+ *  within 6%), and every time slice's overrun past what was asked into
+ *  another; rt_report() prints p50 / p99 / p99.9 / max and the jitter
+ *  (p99.9 - p50) of each, and the page faults the thread took after
+ *  rt_enter().  Wall-clock figures: stderr only.  All of this is per
+ *  thread, so each -P stage thread enters and reports on its own.
+ */
+#define RT_FIFO_PRIO        40      /* below the kernel's IRQ threads (50) */
+#define RT_DL_RUNTIME_US    900
+#define RT_DL_PERIOD_US     1000
+#define RT_STACK_PREFAULT   (256 << 10)
+#define RT_HIST_BUCKETS     976     /* covers all of uint64_t             */
+
+typedef enum {
+    RT_OFF,
+    RT_FIFO,
+    RT_DEADLINE
+} RtPolicy;
+
+extern RtPolicy realtime;           /* as asked for; RT_OFF: no histograms */
+
+/* "--realtime", "--realtime=fifo" or "--realtime=deadline": 0, or -1 */
+int  rt_parse(const char *arg, RtPolicy *policy);
+
+/* Lock, prefault, set the policy of the calling thread and pin it.
+ * `slot` picks the isolated CPU.  Never fails: see above. */
+void rt_enter(RtPolicy policy, int slot);
+
+void rt_hist_add(uint32_t *hist, uint64_t ns);
+extern __thread uint32_t rt_step_hist[DONE][RT_HIST_BUCKETS];
+extern __thread uint32_t rt_slice_hist[RT_HIST_BUCKETS];
+
+static inline void rt_step(LaneState phase, uint64_t ns)
+{
+    if (phase < DONE)
+        rt_hist_add(rt_step_hist[phase], ns);
+}
+
+/* A time slice of `asked_ns` took `got_ns` (early wakeups count as 0) */
+static inline void rt_slice(uint64_t asked_ns, uint64_t got_ns)
+{
+    rt_hist_add(rt_slice_hist, got_ns > asked_ns ? got_ns - asked_ns : 0);
+}
+
+/* What rt_enter() got, and the histograms; `who` labels a worker's */
+void rt_report(FILE *fp, const char *who);
+
+#endif /* RT_H */
@@ -1,47 +1,175 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/select.h>
+#include <sys/wait.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "serdes_sim.h"
+#include "lane_log.h"
+#include "bench.h"
+#include "script.h"
+#include "fair.h"
+#include "arena.h"
+#include "chan_load.h"
+#include "shard.h"
+#include "ctl.h"
+#include "lane_snap.h"
+#include "rt.h"
+#include "pipeline.h"
 
-#define NUM_LANES 16
+#define DEFAULT_NUM_LANES 16
+#define MAX_LANES 65536         /* lane IDs are 16 bits in the trace      */
+#define PRIO_LEVELS 16          /* -r draws nice levels 0 .. PRIO_LEVELS−1 */
+#define MAX_RATES 16
 #define DEFAULT_DATA_RATE 60
 #define LOG_FILE "sched.log"
+#define IDLE_RING_MS 10         /* idle workers poll the command ring     */
 
 typedef struct {
     LaneContext lane;
-    int priority;
+    int priority;               /* nice level for the fair scheduler      */
+    int enqueued;               /* tick training (re)started              */
+    uint64_t enqueued_ns;       /* … and the wall time, for --bench       */
+    int parked;                 /* off the run queue: PARK_LOAD/PARK_ERROR */
+
+    /* -P: the lane is out in a stage; commands for it wait until it is
+     * home, and when it finished (it gets home a little later) */
+    int away;
+    int pending_reset, pending_rate;
+    int done_tick;
+    uint64_t done_ns;
+    unsigned load_seen;         /* chan_load_events() before a load step */
 } Task;
 
-int rr_index = 0;
+/* Lanes off the run queue until the channel loader has news for them:
+ * waiting for a load in flight, or in ERROR until a retry succeeds */
+enum { PARK_NONE, PARK_LOAD, PARK_ERROR };
+int n_parked[PARK_ERROR + 1];
+unsigned load_events;           /* chan_load_events() last looked at      */
+
 int pll_enabled = 1;
 FILE *logfp = NULL;
-int tick = 0;
+FILE *tracefp = NULL;
+__thread int tick = 0;          /* -P: each stage thread's own, see pipe_tick */
+int num_lanes = DEFAULT_NUM_LANES;
+
+/* -w: in a worker, the shard it owns; lane numbers shown to the
+ * operator are lane_base + the local index */
+ShardWorker *worker = NULL;
+int lane_base = 0;
+
+/* all lane storage: Task array, then bitstreams (see arena.h) */
+Arena arena;
+
+/* what 's' and 'q' read: snapshots published at step boundaries, in
+ * the arena, the -C status page or the -w shard mapping */
+LaneSnapTable *snaps = NULL;
+
+/* --bench: no stdin, no sleeps, no console chatter, JSON at the end */
+int bench = 0;
+BenchStats bench_stats;
+
+/* -P: training phases on stage threads (pipeline.h).  Ticks are steps
+ * run by all of them together; each step takes the next. */
+int pipeline = 0;
+int stage_threads[PIPE_STAGES];
+int pipe_tick = 0;
+int n_away = 0;                 /* lanes out in a stage                   */
+
+/* -P: each stage thread's step counters, added up at the end */
+typedef struct {
+    BenchStats b;
+    uint64_t   init_max_ns[INIT_PRBS + 1];
+} StageStats;
+StageStats *stage_stats = NULL;
 
-static const char *state_name(LaneState s)
+/* -S: tick-stamped command replay instead of stdin */
+Script script;
+int scripted = 0;
+
+/* Longest single step per INIT sub-phase; the per-state maxima are in
+ * bench_stats */
+uint64_t init_max_ns[INIT_PRBS + 1];
+
+/* Worst-case step duration by phase: the longest any lane held the
+ * scheduler.  Wall-clock figures, so they go to stderr. */
+static void worst_step_report(FILE *fp)
 {
-    switch (s) {
-        case INIT: return "INIT";
-        case CTLE: return "CTLE";
-        case RX:   return "RX";
-        case DONE: return "DONE";
-    }
-    return "?";
+    int worst = INIT_LOAD;
+    for (int p = INIT_LOAD; p <= INIT_PRBS; p++)
+        if (init_max_ns[p] > init_max_ns[worst])
+            worst = p;
+    fprintf(fp, "Worst step: INIT %.1f us (%s), CTLE %.1f us, RX %.1f us\n",
+            bench_stats.phase_max_ns[INIT] / 1e3, init_phase_name((InitPhase)worst),
+            bench_stats.phase_max_ns[CTLE] / 1e3, bench_stats.phase_max_ns[RX] / 1e3);
 }
 
-static void print_lane_status(int id, const LaneContext *l)
+static const char *load_error(int err)
 {
-    printf("  Lane %2d | %s | %d Gbps", id, state_name(l->state), l->dataRateGbps);
+    return err ? strerror(err) : "no taps";
+}
+
+static void lane_status_fill(LaneStatus *st, int lane, const LaneContext *l)
+{
+    st->lane           = lane_base + lane;
+    st->state          = l->state;
+    st->init_phase     = l->init_phase;
+    st->init_pt        = l->init_pt;
+    st->pt             = l->pt;
+    st->n_samp         = l->N_samp;
+    st->rate           = l->dataRateGbps;
+    st->weight         = pipeline ? 0 : fair_weight(lane);  /* -P: no fair */
+    st->vruntime       = 0;         /* lane_snap_read() works it out */
+    st->sample_instant = l->sample_instant;
+    st->lag            = l->lag;
+    st->sweep          = l->ia + l->iz * CTLE_NA;
+    st->ctle_A         = l->ctle_A;
+    st->ctle_z         = l->ctle_z;
+    st->mse            = l->mse;
+    memcpy(st->RX_FFE, l->RX_FFE, sizeof(st->RX_FFE));
+    memcpy(st->DFE, l->DFE, sizeof(st->DFE));
+    st->load_err       = l->load_err;
+    if (l->state == ERROR)
+        snprintf(st->channel_file, sizeof(st->channel_file), "%s", l->channel_file);
+    else
+        st->channel_file[0] = '\0';
+}
+
+/* Lane `lane` has finished a step, or been reset: new snapshot */
+static void publish_status(int lane, const LaneContext *l)
+{
+    LaneStatus st;
+    lane_status_fill(&st, lane, l);
+    lane_snap_publish(snaps, lane, &st, fair_vruntime_raw(lane), fair_min_vruntime());
+}
+
+static void print_lane_status(const LaneStatus *l)
+{
+    printf("  Lane %2d | %s | %d Gbps", l->lane, state_name(l->state), l->rate);
+    if (l->weight)
+        printf(" | w=%d vrt=%+lld", l->weight, (long long)l->vruntime);
+
+    if (l->state == INIT)
+        printf(" | %s %d", init_phase_name(l->init_phase), l->init_pt);
+
+    if (l->state == ERROR)
+        printf(" | '%s': %s", l->channel_file, load_error(l->load_err));
 
     if (l->state == CTLE || l->state == RX || l->state == DONE)
         printf(" | CDR instant=%d lag=%d", l->sample_instant, l->lag);
 
+    if (l->state == CTLE || l->state == RX)
+        printf(" | pt %d/%d", l->pt, l->n_samp);
+
     if (l->state == CTLE)
-        printf(" | sweep [%d,%d]/%d", l->ia + l->iz * CTLE_NA,
+        printf(" | sweep [%d,%d]/%d", l->sweep,
                CTLE_NA * CTLE_NZ, CTLE_NA * CTLE_NZ);
 
+    if (l->state == CTLE || l->state == RX || l->state == DONE)
+        printf(" | MSE=%.3e", l->mse);
+
     if (l->state == RX || l->state == DONE) {
         printf(" | CTLE A=%.4f z=%.3e", l->ctle_A, l->ctle_z);
         printf("\n         RX_FFE[");
@@ -56,13 +184,58 @@ static void print_lane_status(int id, const LaneContext *l)
     printf("\n");
 }
 
+/* 'q': one lane as a key=value record, for programs (-C clients) */
+static void print_lane_record(const LaneStatus *l)
+{
+    printf("lane=%d state=%s rate=%d", l->lane, state_name(l->state), l->rate);
+    if (l->weight)
+        printf(" weight=%d vruntime=%lld", l->weight, (long long)l->vruntime);
+    printf(" init=%s:%d pt=%d n_samp=%d"
+           " instant=%d lag=%d sweep=%d ctle_A=%.6f ctle_z=%.6e mse=%.6e",
+           init_phase_name(l->init_phase), l->init_pt, l->pt, l->n_samp,
+           l->sample_instant, l->lag, l->sweep, l->ctle_A, l->ctle_z, l->mse);
+    printf(" rx_ffe=");
+    for (int k = 0; k < RX_FFE_LEN; k++)
+        printf("%s%.6f", k ? "," : "", l->RX_FFE[k]);
+    printf(" dfe=");
+    for (int k = 0; k < N_DFE; k++)
+        printf("%s%.6f", k ? "," : "", l->DFE[k]);
+    printf(" load_errno=%d\n", l->state == ERROR ? l->load_err : 0);
+}
+
+/* 's' or 'q' for one lane of `t`, from its snapshot */
+static void show_snapshot(const LaneSnapTable *t, int i, int record)
+{
+    LaneStatus st;
+    if (lane_snap_read(t, i, &st) != 0)
+        printf("  Lane %2d | no consistent snapshot (owner died mid-update)\n",
+               t->base + i);
+    else if (record)
+        print_lane_record(&st);
+    else
+        print_lane_status(&st);
+}
+
+/* 's' for one lane: printed here, or in a worker handed to the
+ * coordinator, which prints it from the ring slot */
+static void show_lane_status(int lane)
+{
+    if (worker) {
+        fflush(stdout);             /* keep it behind earlier output */
+        LaneStatus *st = shard_reserve_wait(&worker->status);
+        if (lane_snap_read(snaps, lane, st) == 0)
+            shard_ring_publish(&worker->status);
+    } else {
+        show_snapshot(snaps, lane, 0);
+    }
+}
+
 void taskStepForward(Task *task, int lane_id)
 {
     LaneState prev = task->lane.state;
     int prev_pt = task->lane.pt;
     int prev_ia = task->lane.ia;
     int prev_iz = task->lane.iz;
-    task->priority++;
 
     if (task->lane.state == INIT) {
         lane_step_init(&task->lane);
@@ -74,54 +247,38 @@ void taskStepForward(Task *task, int lane_id)
         lane_step_rx(&task->lane);
     }
 
-    /* ── Verbose file log: every step ── */
-    if (logfp) {
-        fprintf(logfp, "[tick %8d] Lane %2d  state=%-4s  pt=%d/%d  prio=%d\n",
-                tick, lane_id, state_name(task->lane.state),
-                task->lane.pt, task->lane.N_samp, task->priority);
-
-        /* CTLE sweep: log when a grid point completes (ia or iz advanced) */
-        if (task->lane.state == CTLE && prev == CTLE) {
-            int old_grid = prev_ia + prev_iz * CTLE_NA;
-            int new_grid = task->lane.ia + task->lane.iz * CTLE_NA;
-            if (new_grid != old_grid) {
-                fprintf(logfp, "             Lane %2d  CTLE sweep: completed grid [%d/%d]"
-                        "  A=%.4f z=%.3e  MSE=%.6f\n",
-                        lane_id, old_grid + 1, CTLE_NA * CTLE_NZ,
-                        task->lane.A_vec[prev_ia], task->lane.z_vec[prev_iz],
-                        task->lane.J[prev_ia][prev_iz]);
-                fprintf(logfp, "             Lane %2d  CTLE sweep: now testing [%d/%d]"
-                        "  A=%.4f z=%.3e\n",
-                        lane_id, new_grid + 1, CTLE_NA * CTLE_NZ,
-                        task->lane.ctle_A, task->lane.ctle_z);
-            }
-        }
-
-        /* RX progress: log taps every 25% */
-        if (task->lane.state == RX && prev == RX) {
-            int quarter = task->lane.N_samp / 4;
-            if (quarter > 0 && prev_pt / quarter != task->lane.pt / quarter) {
-                int pct = (task->lane.pt * 100) / task->lane.N_samp;
-                fprintf(logfp, "             Lane %2d  RX training %d%%  RX_FFE[main]=%.6f"
-                        "  DFE[0]=%.6f\n",
-                        lane_id, pct,
-                        task->lane.RX_FFE[RX_FFE_PRE], task->lane.DFE[0]);
-                fprintf(logfp, "               RX_FFE = [");
-                for (int k = 0; k < RX_FFE_LEN; k++)
-                    fprintf(logfp, "%s%+.6f", k ? ", " : "", task->lane.RX_FFE[k]);
-                fprintf(logfp, "]\n");
-            }
+    /* a retrain after a channel change that did not converge: the
+     * drift was too large to track, so train from scratch */
+    if (prev == RX && task->lane.state == DONE && task->lane.retrain) {
+        task->lane.retrain = 0;
+        if (task->lane.mse > RETRAIN_MSE_GROWTH * task->lane.retrain_mse) {
+            if (!bench)
+                printf("[Lane %2d] retrain ended at MSE %.3e (from %.3e); full retrain\n",
+                       lane_base + lane_id, task->lane.mse, task->lane.retrain_mse);
+            lane_log_text(tick, lane_base + lane_id, LOG_CAT_CMD, LOG_INFO,
+                          "lane %d retrain did not converge, full retrain\n",
+                          lane_base + lane_id, 0, 0);
+            lane_soft_reset(&task->lane);
         }
     }
 
+    /* ── Verbose file log: every step (queued, formatted off-thread) ── */
+    lane_log_step_prio(tick, lane_base + lane_id, &task->lane, task->priority);
+    lane_log_progress(tick, lane_base + lane_id, &task->lane,
+                      prev, prev_pt, prev_ia, prev_iz);
+
     /* ── State transition: console + file ── */
-    if (task->lane.state != prev) {
+    if (task->lane.state != prev && !bench) {
 
-        /* --- Console (concise) --- */
-        printf("[Lane %2d] %s → %s", lane_id,
+        /* --- Console (concise; one piece even with -P stage threads) --- */
+        flockfile(stdout);
+        printf("[Lane %2d] %s → %s", lane_base + lane_id,
                state_name(prev), state_name(task->lane.state));
 
-        if (prev == INIT)
+        if (prev == INIT && task->lane.state == ERROR)
+            printf("  (cannot load '%s': %s; retrying in the background)",
+                   task->lane.channel_file, load_error(task->lane.load_err));
+        else if (prev == INIT)
             printf("  (loaded %d taps, CDR instant=%d lag=%d)",
                    task->lane.L, task->lane.sample_instant, task->lane.lag);
 
@@ -140,71 +297,767 @@ void taskStepForward(Task *task, int lane_id)
         }
         printf("\n");
         fflush(stdout);
+        funlockfile(stdout);
+    }
 
-        /* --- Log file (verbose) --- */
-        if (logfp) {
-            fprintf(logfp, "========== Lane %2d TRANSITION: %s → %s (tick %d) ==========\n",
-                    lane_id, state_name(prev), state_name(task->lane.state), tick);
-
-            if (prev == INIT) {
-                fprintf(logfp, "  Channel:  %s (%d taps)\n",
-                        task->lane.channel_file, task->lane.L);
-                fprintf(logfp, "  Data rate: %d Gbps  Fs=%.3e Hz\n",
-                        task->lane.dataRateGbps, task->lane.Fs);
-                fprintf(logfp, "  CDR:       sample_instant=%d  lag=%d\n",
-                        task->lane.sample_instant, task->lane.lag);
-                fprintf(logfp, "  TX FFE:    [");
-                for (int k = 0; k < TX_FFE_LEN; k++)
-                    fprintf(logfp, "%s%+.6f", k ? ", " : "", task->lane.TX_FFE[k]);
-                fprintf(logfp, "]\n");
+    /* --- Log file (verbose) --- */
+    if (task->lane.state != prev) {
+        lane_log_transition(tick, lane_base + lane_id, &task->lane, prev);
+        ctl_lane(tick, lane_base + lane_id, task->lane.state);
+    }
+}
+
+/* ── Parked lanes ─────────────────────────────────────────────────────
+ *  A step that leaves the lane waiting on its channel file, or in
+ *  ERROR, takes it off the run queue; it rejoins when the loader
+ *  completes something (or the operator resets it).
+ */
+static int park(Task *t)
+{
+    LaneContext *l = &t->lane;
+    if (l->state == ERROR)
+        t->parked = PARK_ERROR;
+    else if (l->state == INIT && l->init_phase == INIT_LOAD && l->load_gen)
+        t->parked = PARK_LOAD;
+    else
+        return 0;
+    n_parked[t->parked]++;
+    return 1;
+}
+
+/* -P: hand a lane at home to the stage of its phase */
+static void send_out(Task *t, int lane)
+{
+    t->away = 1;
+    n_away++;
+    pipe_submit(t->lane.state, lane);
+}
+
+static void requeue(Task *t, int lane)
+{
+    if (t->parked) {
+        n_parked[t->parked]--;
+        t->parked = PARK_NONE;
+    }
+    if (!pipeline)
+        fair_restart(lane);
+    publish_status(lane, &t->lane);
+    ctl_lane(tick, lane_base + lane, t->lane.state);
+    if (pipeline)
+        send_out(t, lane);          /* last: the stage owns it from here */
+}
+
+/* Loader made progress: let waiting lanes look again, and restart lanes
+ * in ERROR whose file now loads. */
+static void wake_parked(Task *taskList)
+{
+    for (int i = 0; i < num_lanes; i++) {
+        Task *t = &taskList[i];
+        if (t->parked == PARK_LOAD) {
+            requeue(t, i);
+        } else if (t->parked == PARK_ERROR && chan_load_ok(t->lane.load_entry)) {
+            lane_soft_reset(&t->lane);
+            t->enqueued = tick;
+            t->enqueued_ns = bench_now_ns();
+            if (!bench)
+                printf("Lane %d channel '%s' loads again, retraining\n",
+                       lane_base + i, t->lane.channel_file);
+            lane_log_text(tick, lane_base + i, LOG_CAT_CMD, LOG_INFO,
+                          "lane %d channel recovered (soft reset)\n", lane_base + i, 0, 0);
+            requeue(t, i);
+        }
+    }
+}
+
+/* Channel files changed on disk (chan_load.h): lanes trained or training
+ * on the old taps retrain, from their current equaliser where they have
+ * one (lane_retrain).  With -P, lanes out in a stage are looked at when
+ * they get home. */
+static void retrain_if_changed(Task *t, int i)
+{
+    if (t->parked || t->away || !lane_channel_changed(&t->lane))
+        return;
+    int quick = lane_retrain(&t->lane);
+    t->enqueued = tick;
+    t->enqueued_ns = bench_now_ns();
+    if (!bench)
+        printf("Lane %d channel '%s' changed: %s\n", lane_base + i, t->lane.channel_file,
+               quick ? "retraining RX from the current equaliser" : "retraining from INIT");
+    lane_log_text(tick, lane_base + i, LOG_CAT_CMD, LOG_INFO,
+                  quick ? "lane %d channel changed, RX retrain\n"
+                        : "lane %d channel changed, full retrain\n",
+                  lane_base + i, 0, 0);
+    requeue(t, i);
+}
+
+static void retrain_changed(Task *taskList)
+{
+    for (int i = 0; i < num_lanes; i++)
+        retrain_if_changed(&taskList[i], i);
+}
+
+/* 'd' and 'r': soft reset, at a new rate if rate > 0, and retrain.  A
+ * lane out in a stage (-P) is called home for it first. */
+static void reset_lane(Task *t, int i, int rate)
+{
+    if (t->away) {
+        if (rate > 0)
+            t->pending_rate = rate;
+        t->pending_reset = 1;
+        pipe_recall(i);
+        return;
+    }
+    if (rate > 0)
+        t->lane.dataRateGbps = rate;
+    lane_soft_reset(&t->lane);
+    t->enqueued = tick;
+    t->enqueued_ns = bench_now_ns();
+    requeue(t, i);
+}
+
+/* Lines said once for all workers ("PLL ON", the status header): by the
+ * coordinator for a command run as it comes in, by worker 0 for one the
+ * script has for a later tick, so they come out when it runs */
+static int says_once(int at_tick)
+{
+    return !worker || (worker->id == 0 && at_tick > 0);
+}
+
+/* ── Command interpreter ──────────────────────────────────────────────
+ *  One line of operator input (stdin, a -S script, a -C client, or in a
+ *  worker the coordinator's cmd ring), e.g. "d 3 56", to run at tick
+ *  `at_tick` (0: as it comes in).  Lane numbers are global.  Returns -1
+ *  for a command it does not know or a lane that is not there.
+ */
+static int handle_command(Task *taskList, const char *buf, int at_tick)
+{
+    if (buf[0] == 's') {
+        int lane = -1;
+        sscanf(buf, "s %d", &lane);
+        if (lane >= lane_base && lane < lane_base + num_lanes) {
+            show_lane_status(lane - lane_base);
+        } else {
+            if (says_once(at_tick))
+                printf("─── Lane Status ───\n");
+            for (int i = 0; i < num_lanes; i++)
+                show_lane_status(i);
+        }
+        lane_log_text(tick, -1, LOG_CAT_CMD, LOG_INFO,
+                      "CMD: status query\n", 0, 0, 0);
+    }
+    else if (buf[0] == 'q') {
+        int lane = -1;
+        if (sscanf(buf, "q %d", &lane) == 1) {
+            if (lane < lane_base || lane >= lane_base + num_lanes)
+                return -1;
+            show_snapshot(snaps, lane - lane_base, 1);
+        } else {
+            for (int i = 0; i < num_lanes; i++)
+                show_snapshot(snaps, i, 1);
+        }
+    }
+    else if (buf[0] == 'd') {
+        int lane = -1, rate = 0;
+        sscanf(buf, "d %d %d", &lane, &rate);
+        int i = lane - lane_base;
+        if (i >= 0 && i < num_lanes) {
+            reset_lane(&taskList[i], i, rate);
+            printf("Lane %d rate changed to %d Gbps\n", lane, rate);
+            lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO,
+                          "CMD: lane %d rate → %d Gbps (soft reset)\n",
+                          lane, rate, 0);
+        } else {
+            return -1;
+        }
+    }
+    else if (buf[0] == 'r') {
+        int lane = -1;
+        sscanf(buf, "r %d", &lane);
+        int i = lane - lane_base;
+        if (i >= 0 && i < num_lanes) {
+            reset_lane(&taskList[i], i, 0);
+            printf("Lane %d soft reset\n", lane);
+            lane_log_text(tick, lane, LOG_CAT_CMD, LOG_INFO,
+                          "CMD: lane %d soft reset\n", lane, 0, 0);
+        } else {
+            return -1;
+        }
+    }
+    else if (buf[0] == 'p') {
+        __atomic_store_n(&pll_enabled, !pll_enabled, __ATOMIC_RELAXED);
+        ctl_pll(pll_enabled);
+        if (says_once(at_tick))
+            printf("PLL %s\n", pll_enabled ? "ON" : "OFF");
+        lane_log_text(tick, -1, LOG_CAT_CMD, LOG_INFO,
+                      pll_enabled ? "CMD: PLL ON\n" : "CMD: PLL OFF\n",
+                      0, 0, 0);
+    }
+    else {
+        return -1;
+    }
+    return 0;
+}
+
+static int ctl_exec(void *taskList, const char *cmd)
+{
+    return handle_command(taskList, cmd, 0);
+}
+
+/* -S: tick of the next scripted command, -1 when there are no more.  A
+ * worker gets them from its cmd ring and waits until the coordinator has
+ * sent the next one or said that was all. */
+static int next_command_tick(void)
+{
+    if (!worker)
+        return script_next_tick(&script);
+    for (;;) {
+        const ScriptCmd *c = shard_ring_peek(&worker->cmd);
+        if (c)
+            return c->tick;
+        if (__atomic_load_n(&worker->closed, __ATOMIC_ACQUIRE) || shard_orphaned())
+            return (c = shard_ring_peek(&worker->cmd)) ? c->tick : -1;
+        usleep(50);
+    }
+}
+
+/* Could someone still fix a lane in ERROR: stdin here, or in a worker
+ * the coordinator's (until it reaches EOF) */
+static int operator_attached(int stdin_open)
+{
+    if (worker)
+        return !bench && !scripted && !__atomic_load_n(&worker->closed, __ATOMIC_ACQUIRE);
+    return stdin_open;
+}
+
+/* Nothing to run: is there still something to wait for?  Loads in
+ * flight; a control client, which may reset lanes; and while the
+ * operator can still fix or change a file, lanes in ERROR and, with the
+ * watcher on, trained lanes a new file would retrain (hot reload). */
+static int idle_worth(int stdin_open)
+{
+    if (n_parked[PARK_LOAD] || ctl_clients())
+        return 1;
+    return (n_parked[PARK_ERROR] || chan_load_watching()) &&
+           operator_attached(stdin_open);
+}
+
+/* Nothing to run: block until a channel load completes, a command line
+ * comes in on stdin (while open) or a control client has something to
+ * say.  A worker's commands come through a ring with no fd to wait on,
+ * so it looks at the ring every IDLE_RING_MS as well. */
+static void idle_wait(int stdin_open)
+{
+    chan_load_ack();
+    if (chan_load_events() != load_events)
+        return;
+    int  fds[] = { chan_load_fd(), stdin_open ? STDIN_FILENO : -1 };
+    long us    = worker || fds[0] < 0 ? IDLE_RING_MS * 1000L : -1;
+    ctl_wait(fds, 2, us);
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Pipelined stages (-P): the main thread keeps the console, the loader
+ *  and every lane that is not out in a stage (pipeline.h)
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+/* Where a lane goes after a step: its phase's stage, or home if it is
+ * DONE, in ERROR or waiting on the loader (main parks it) */
+static int stage_of(const LaneContext *l)
+{
+    if (l->state == INIT && l->init_phase == INIT_LOAD && l->load_gen)
+        return PIPE_HOME;
+    return l->state < DONE ? (int)l->state : PIPE_HOME;
+}
+
+static int stage_slice(void *arg, int w, int stage, int lane)
+{
+    Task *t = &((Task *)arg)[lane];
+    StageStats *ss = &stage_stats[w];
+
+    if (!__atomic_load_n(&pll_enabled, __ATOMIC_RELAXED)) {
+        usleep(1000);
+        return stage;
+    }
+    for (int n = 0; n < PIPE_SLICE_STEPS; n++) {
+        if (pipe_recalled(lane))
+            return PIPE_HOME;
+        tick = __atomic_add_fetch(&pipe_tick, 1, __ATOMIC_RELAXED);
+        LaneState phase = t->lane.state;
+        InitPhase sub = t->lane.init_phase;
+        if (phase == INIT && sub == INIT_LOAD)
+            t->load_seen = chan_load_events();
+        uint64_t t0 = bench_now_ns();
+        taskStepForward(t, lane);
+        uint64_t t1 = bench_now_ns();
+        bench_step(&ss->b, phase, t1 - t0);
+        if (realtime)
+            rt_step(phase, t1 - t0);
+        if (phase == INIT && t1 - t0 > ss->init_max_ns[sub])
+            ss->init_max_ns[sub] = t1 - t0;
+        publish_status(lane, &t->lane);
+
+        if (!bench)
+            usleep(10);             /* firmware time slice, as ticks have */
+
+        int next = stage_of(&t->lane);
+        if (next != stage) {
+            if (t->lane.state == DONE) {
+                t->done_tick = tick;
+                t->done_ns = t1;
+            }
+            return next;
+        }
+    }
+    return stage;
+}
+
+static void stage_enter(void *arg, int w, int stage)
+{
+    (void)arg; (void)stage;
+    if (logfp)
+        lane_log_begin(LOG_CAT_STEP, 0);    /* this thread's log ring, now */
+    if (realtime)
+        rt_enter(realtime, w);
+}
+
+static void stage_leave(void *arg, int w, int stage)
+{
+    (void)arg;
+    if (realtime) {
+        char who[32];
+        snprintf(who, sizeof(who), "(%s stage, thread %d)", state_name((LaneState)stage), w);
+        rt_report(stderr, who);
+    }
+}
+
+/* Lane i is back from its stage */
+static void lane_home(Task *taskList, int i)
+{
+    Task *t = &taskList[i];
+    t->away = 0;
+    n_away--;
+
+    if (t->pending_reset) {
+        int rate = t->pending_rate;
+        t->pending_reset = t->pending_rate = 0;
+        reset_lane(t, i, rate);
+    } else if (t->lane.state == DONE) {
+        bench_linkup(&bench_stats, t->done_tick - t->enqueued + 1, t->done_ns - t->enqueued_ns);
+        retrain_if_changed(t, i);   /* the file changed while it trained */
+    } else if (!park(t)) {
+        send_out(t, i);             /* recalled, but nothing to do */
+    } else if (t->parked == PARK_LOAD && chan_load_events() != t->load_seen) {
+        requeue(t, i);              /* its load finished after it looked */
+    }
+}
+
+static void run_pipeline(Task *taskList, int stdin_open)
+{
+    PipeOps ops = { stage_slice, stage_enter, stage_leave, taskList };
+    int total = stage_threads[0] + stage_threads[1] + stage_threads[2];
+    stage_stats = calloc(total, sizeof(StageStats));
+    if (!stage_stats || pipe_start(stage_threads, num_lanes, &ops) != 0) {
+        fprintf(stderr, "Error: cannot start the pipeline\n");
+        return;
+    }
+    for (int i = 0; i < num_lanes; i++)
+        send_out(&taskList[i], i);
+
+    for (;;) {
+        tick = __atomic_load_n(&pipe_tick, __ATOMIC_RELAXED);
+
+        if (stdin_open) {
+            fd_set readfds;
+            FD_ZERO(&readfds);
+            FD_SET(STDIN_FILENO, &readfds);
+            struct timeval tv = {0, 0};
+            if (select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv) > 0) {
+                char buf[64];
+                if (!fgets(buf, sizeof(buf), stdin))
+                    stdin_open = 0;
+                else
+                    handle_command(taskList, buf, 0);
             }
+        }
+
+        if (chan_load_events() != load_events) {
+            load_events = chan_load_events();
+            if (n_parked[PARK_LOAD] || n_parked[PARK_ERROR])
+                wake_parked(taskList);
+            retrain_changed(taskList);
+        }
+
+        int lane;
+        while (pipe_home(&lane, 0))
+            lane_home(taskList, lane);
+
+        /* every lane home: as the single-threaded loop with nothing to run */
+        if (n_away == 0) {
+            if (!idle_worth(stdin_open))
+                break;
+            idle_wait(stdin_open);
+            continue;
+        }
+
+        if (pipe_home(&lane, bench ? 1000 : 200))
+            lane_home(taskList, lane);
+    }
+    pipe_stop();
+
+    for (int w = 0; w < total; w++) {
+        const StageStats *ss = &stage_stats[w];
+        for (int p = 0; p < DONE; p++) {
+            bench_stats.phase_ns[p]    += ss->b.phase_ns[p];
+            bench_stats.phase_steps[p] += ss->b.phase_steps[p];
+            if (ss->b.phase_max_ns[p] > bench_stats.phase_max_ns[p])
+                bench_stats.phase_max_ns[p] = ss->b.phase_max_ns[p];
+        }
+        for (int p = INIT_LOAD; p <= INIT_PRBS; p++)
+            if (ss->init_max_ns[p] > init_max_ns[p])
+                init_max_ns[p] = ss->init_max_ns[p];
+    }
+    free(stage_stats);
+    stage_stats = NULL;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Coordinator (-w): console, stdin and script in; worker output out
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+/* Worker a command is for, -1 for all of them, -2 for none */
+static int command_target(const char *cmd)
+{
+    int lane = -1;
+    if (cmd[0] == 's' || cmd[0] == 'q')
+        return sscanf(cmd + 1, "%d", &lane) == 1 && lane >= 0 && lane < num_lanes
+               ? shard_owner(lane) : -1;
+    if (cmd[0] == 'd' || cmd[0] == 'r') {
+        if (sscanf(cmd + 1, "%d", &lane) != 1 || lane < 0 || lane >= num_lanes)
+            return -2;
+        return shard_owner(lane);
+    }
+    return -1;
+}
+
+/* 's' or 'q' typed at the coordinator: read the workers' snapshot
+ * tables in place, without a word to the workers.  Those of a worker
+ * that is gone show its lanes as they were last published. */
+static void show_snapshots(const char *cmd)
+{
+    int lane = -1, record = cmd[0] == 'q';
+    if (sscanf(cmd + 1, "%d", &lane) == 1 && lane >= 0 && lane < num_lanes) {
+        ShardWorker *sw = shard_get(shard_owner(lane));
+        show_snapshot(sw->snaps, lane - sw->lo, record);
+        return;
+    }
+    if (!record)
+        printf("─── Lane Status ───\n");
+    for (int w = 0; w < shard_count(); w++)
+        for (int i = 0; i < shard_get(w)->snaps->lanes; i++)
+            show_snapshot(shard_get(w)->snaps, i, record);
+}
+
+/* Queue `cmd` for the worker(s) it concerns, all or nothing: 0 if a
+ * live target's ring is full (try again later). */
+static int forward_command(const char *cmd, int at_tick)
+{
+    if (at_tick == 0 && (cmd[0] == 's' || cmd[0] == 'q')) {
+        show_snapshots(cmd);
+        return 1;
+    }
+
+    int target = command_target(cmd);
+    if (target == -2)
+        return 1;
+
+    int lo = target < 0 ? 0 : target, hi = target < 0 ? shard_count() : target + 1;
+    for (int w = lo; w < hi; w++)
+        if (shard_get(w)->pid && !shard_ring_reserve(&shard_get(w)->cmd))
+            return 0;
+
+    /* later ticks: worker 0 says these when it gets there, unless it is gone */
+    int say = at_tick == 0 || !shard_get(0)->pid;
+    if (cmd[0] == 's' && target < 0 && say)
+        printf("─── Lane Status ───\n");
+    if (cmd[0] == 'p') {
+        pll_enabled = !pll_enabled;
+        if (say)
+            printf("PLL %s\n", pll_enabled ? "ON" : "OFF");
+    }
+    if (target >= 0 && !shard_get(target)->pid) {
+        int lane = -1;
+        sscanf(cmd + 1, "%d", &lane);
+        printf("  Lane %d: worker %d is gone\n", lane, target);
+    }
 
-            if (prev == CTLE) {
-                fprintf(logfp, "  Best CTLE: A=%.6f  z=%.6e  p=%.6e\n",
-                        task->lane.ctle_A, task->lane.ctle_z, task->lane.ctle_p);
-                fprintf(logfp, "  Sweep MSE grid (A rows x z cols):\n");
-                for (int a = 0; a < CTLE_NA; a++) {
-                    fprintf(logfp, "    A=%.4f |", task->lane.A_vec[a]);
-                    for (int z = 0; z < CTLE_NZ; z++) {
-                        if (task->lane.J[a][z] < 1e20)
-                            fprintf(logfp, " %10.6f", task->lane.J[a][z]);
-                        else
-                            fprintf(logfp, "        N/A");
-                    }
-                    fprintf(logfp, "\n");
+    for (int w = lo; w < hi; w++) {
+        ShardWorker *sw = shard_get(w);
+        if (!sw->pid)
+            continue;
+        ScriptCmd *c = shard_ring_reserve(&sw->cmd);
+        c->tick = at_tick;
+        snprintf(c->cmd, sizeof(c->cmd), "%s", cmd);
+        shard_ring_publish(&sw->cmd);
+    }
+    return 1;
+}
+
+/* Print what the workers sent; returns how many records were read */
+static int drain_workers(void)
+{
+    int n = 0;
+    for (int w = 0; w < shard_count(); w++) {
+        ShardWorker *sw = shard_get(w);
+        const ShardEvent *e;
+        const LaneStatus *st;
+        while ((e = shard_ring_peek(&sw->evt))) {
+            if (e->kind == SHARD_EVT_TEXT)
+                fwrite(e->text, 1, e->len, stdout);
+            else
+                bench_linkup(&bench_stats, e->ticks, e->ns);
+            shard_ring_release(&sw->evt);
+            n++;
+        }
+        while ((st = shard_ring_peek(&sw->status))) {
+            print_lane_status(st);  /* in place: zero-copy */
+            shard_ring_release(&sw->status);
+            n++;
+        }
+    }
+    fflush(stdout);
+    return n;
+}
+
+static void close_workers(void)
+{
+    for (int w = 0; w < shard_count(); w++)
+        __atomic_store_n(&shard_get(w)->closed, 1, __ATOMIC_RELEASE);
+}
+
+static int run_coordinator(const char *channel_file, int random_prio, int boost,
+                           const char *rates_arg, unsigned seed, const char *bench_out)
+{
+    int n_workers = shard_count();
+
+    if (!bench) {
+        printf("Scheduler started with channel '%s'.\n", channel_file);
+        printf("Priority mode: %s\n", random_prio ? "RANDOM" : "EQUAL");
+        printf("Policy: fair (virtual runtime, reset boost %d steps)\n", boost);
+        printf("Workers: %d\n", n_workers);
+        for (int w = 0; w < n_workers; w++)
+            printf("  worker %d: lanes %d..%d, pid %d, log sched.w%d.log\n", w,
+                   shard_get(w)->lo, shard_get(w)->hi - 1, (int)shard_get(w)->pid, w);
+        printf("Commands:\n");
+        printf("  s [lane]          - show status (all lanes, or one lane)\n");
+        printf("  q [lane]          - status as key=value records\n");
+        printf("  d <lane> <rate>   - change data rate for a lane\n");
+        printf("  r <lane>          - soft reset a lane\n");
+        printf("  p                 - turn PLL on/off\n");
+    }
+
+    int stdin_open = !bench && !scripted;
+    if (bench)
+        close_workers();
+    bench_start(&bench_stats);
+
+    int alive = n_workers, lost = 0;
+    while (alive > 0) {
+        int busy = 0;
+
+        if (stdin_open) {
+            fd_set readfds;
+            FD_ZERO(&readfds);
+            FD_SET(STDIN_FILENO, &readfds);
+            struct timeval tv = {0, 0};
+            if (select(STDIN_FILENO + 1, &readfds, NULL, NULL, &tv) > 0) {
+                char buf[64];
+                if (!fgets(buf, sizeof(buf), stdin)) {
+                    stdin_open = 0;
+                    close_workers();
+                } else if (!forward_command(buf, 0)) {
+                    fprintf(stderr, "Command dropped, worker busy: %s", buf);
                 }
+                busy = 1;
             }
+        }
+
+        /* the whole script goes out up front, as far as the rings allow */
+        if (scripted && script.next < script.n) {
+            while (script.next < script.n &&
+                   forward_command(script.cmds[script.next].cmd, script.cmds[script.next].tick))
+                script.next++;
+            if (script.next == script.n)
+                close_workers();
+        }
 
-            if (prev == RX) {
-                fprintf(logfp, "  RX FFE taps (%d total):\n", RX_FFE_LEN);
-                for (int k = 0; k < RX_FFE_LEN; k++)
-                    fprintf(logfp, "    RX_FFE[%2d] = %+.8f%s\n", k, task->lane.RX_FFE[k],
-                            k == RX_FFE_PRE ? "  <-- main cursor" : "");
-                fprintf(logfp, "  DFE taps (%d total):\n", N_DFE);
-                for (int k = 0; k < N_DFE; k++)
-                    fprintf(logfp, "    DFE[%d]    = %+.8f\n", k, task->lane.DFE[k]);
+        busy += drain_workers();
+
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+            for (int w = 0; w < n_workers; w++) {
+                ShardWorker *sw = shard_get(w);
+                if (sw->pid != pid)
+                    continue;
+                sw->pid = 0;
+                alive--;
+                drain_workers();
+                if (!sw->finished) {
+                    lost += sw->hi - sw->lo;
+                    if (WIFSIGNALED(status))
+                        fprintf(stderr, "Worker %d (lanes %d..%d) killed by signal %d (%s); "
+                                "the other shards run on\n", w, sw->lo, sw->hi - 1,
+                                WTERMSIG(status), strsignal(WTERMSIG(status)));
+                    else
+                        fprintf(stderr, "Worker %d (lanes %d..%d) exited with status %d; "
+                                "the other shards run on\n", w, sw->lo, sw->hi - 1,
+                                WEXITSTATUS(status));
+                    continue;
+                }
+                for (int p = 0; p < DONE; p++) {
+                    bench_stats.phase_ns[p]    += sw->phase_ns[p];
+                    bench_stats.phase_steps[p] += sw->phase_steps[p];
+                    if (sw->phase_max_ns[p] > bench_stats.phase_max_ns[p])
+                        bench_stats.phase_max_ns[p] = sw->phase_max_ns[p];
+                }
             }
+            busy = 1;
+        }
 
-            fprintf(logfp, "==========================================================\n");
-            fflush(logfp);
+        if (!busy)
+            usleep(200);
+    }
+    drain_workers();
+
+    if (bench) {
+        FILE *out = bench_out ? fopen(bench_out, "w") : stdout;
+        if (!out) {
+            perror(bench_out);
+        } else {
+            BenchInfo info = { .program = "marsched", .channel = channel_file,
+                               .policy = "fair", .rates = rates_arg ? rates_arg : "60",
+                               .lanes = num_lanes, .random_prio = random_prio, .seed = seed };
+            bench_write(out, &bench_stats, &info);
+            if (out != stdout) fclose(out);
         }
+    } else {
+        fprintf(stderr, "Worst step: INIT %.1f us, CTLE %.1f us, RX %.1f us\n",
+                bench_stats.phase_max_ns[INIT] / 1e3, bench_stats.phase_max_ns[CTLE] / 1e3,
+                bench_stats.phase_max_ns[RX] / 1e3);
     }
+    if (lost)
+        fprintf(stderr, "%d of %d lanes lost with their workers\n", lost, num_lanes);
+
+    bench_free(&bench_stats);
+    script_free(&script);
+    shard_unmap();
+    return lost ? 1 : 0;
 }
 
 int main(int argc, char *argv[]) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s <channel_taps.txt> [-r]\n", argv[0]);
-        fprintf(stderr, "  -r   assign random initial priorities to each lane\n");
+        fprintf(stderr, "Usage: %s <channel_taps.txt> [-r] [-n <lanes>] [-R <rate,...>] [-s <seed>]\n"
+                        "          [-b <steps>] [-H off|thp|hugetlb] [-v <spec>] [-t <trace.bin>]\n"
+                        "          [-S <script>] [-w <workers>]"
+                        " [-C <socket>] [-P <init,ctle,rx>]\n"
+                        "          [--bench [-o <out.json>]] [--realtime[=fifo|deadline]]\n", argv[0]);
+        fprintf(stderr, "  -r   assign random initial priorities (nice levels 0..%d) to each lane\n",
+                PRIO_LEVELS - 1);
+        fprintf(stderr, "  -n   number of lanes, 1..%d (default %d)\n", MAX_LANES, DEFAULT_NUM_LANES);
+        fprintf(stderr, "  -R   data rates (Gbps), cycled over the lanes (default %d)\n", DEFAULT_DATA_RATE);
+        fprintf(stderr, "  -s   random seed (priorities, PRBS); default: time\n");
+        fprintf(stderr, "  -b   head start of a reset or rate-changed lane, in steps (default %d)\n",
+                FAIR_BOOST_DEFAULT);
+        fprintf(stderr, "  -H   page size of the lane arena (default thp)\n");
+        fprintf(stderr, "  -t   write a binary trace instead of per-step text (see trace_decode)\n");
+        fprintf(stderr, "  -S   replay a command script (\"@<tick> <cmd>\" lines) instead of stdin;\n"
+                        "       with -s the run is reproducible bit for bit\n");
+        fprintf(stderr, "  -w   run the lanes in N worker processes, 1..%d (see shard.h);\n"
+                        "       each writes sched.w<N>.log\n", SHARD_MAX_WORKERS);
+        fprintf(stderr, "  -C   also take commands on a Unix socket (see ctl.h; client: marctl)\n");
+        fprintf(stderr, "  -P   run INIT, CTLE and RX as pipeline stages with that many threads\n"
+                        "       each, e.g. 1,1,2 (see pipeline.h; at most %d in all)\n",
+                PIPE_MAX_THREADS);
+        fprintf(stderr, "  --bench  run headless to completion (no stdin, no sleeps, no sched.log)\n"
+                        "           and write JSON results to stdout, or to -o <file>\n");
+        fprintf(stderr, "  --realtime  lock and prefault memory, run the lanes SCHED_FIFO on an\n"
+                        "           isolated CPU (=deadline: SCHED_DEADLINE) and report step\n"
+                        "           latency jitter; falls back to what it is allowed (see rt.h)\n");
+        lane_log_usage(stderr);
         return 1;
     }
 
     /* parse args */
     const char *channel_file = NULL;
     int random_prio = 0;
+    const char *trace_file = NULL;
+    const char *rates_arg = NULL;
+    const char *bench_out = NULL;
+    int rates[MAX_RATES] = { DEFAULT_DATA_RATE };
+    int n_rates = 1;
+    unsigned seed = (unsigned)time(NULL);
+    int boost = FAIR_BOOST_DEFAULT;
+    ArenaPages pages = ARENA_PAGES_THP;
+    int n_workers = 0;
+    const char *ctl_path = NULL;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-r") == 0)
             random_prio = 1;
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            num_lanes = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+            seed = (unsigned)strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            boost = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            n_workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc)
+            ctl_path = argv[++i];
+        else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            if (pipe_parse(argv[++i], stage_threads) != 0) {
+                fprintf(stderr, "Error: bad stage threads '%s'\n", argv[i]);
+                return 1;
+            }
+            pipeline = 1;
+        }
+        else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            if (arena_parse_pages(argv[++i], &pages) != 0) {
+                fprintf(stderr, "Error: bad page mode '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            rates_arg = argv[++i];
+            n_rates = bench_parse_rates(rates_arg, rates, MAX_RATES);
+            if (n_rates == 0) {
+                fprintf(stderr, "Error: bad rate list '%s'\n", rates_arg);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            if (script_load(&script, argv[++i]) != 0)
+                return 1;
+            scripted = 1;
+        }
+        else if (strcmp(argv[i], "--bench") == 0)
+            bench = 1;
+        else if (strncmp(argv[i], "--realtime", 10) == 0) {
+            if (rt_parse(argv[i], &realtime) != 0) {
+                fprintf(stderr, "Error: bad real-time mode '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            bench_out = argv[++i];
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            trace_file = argv[++i];
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+            if (lane_log_config(argv[++i]) != 0) {
+                fprintf(stderr, "Error: bad log spec '%s'\n", argv[i]);
+                return 1;
+            }
+        }
         else
             channel_file = argv[i];
     }
@@ -214,48 +1067,164 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    srand((unsigned)time(NULL));
+    if (num_lanes < 1 || num_lanes > MAX_LANES) {
+        fprintf(stderr, "Error: lane count must be 1..%d.\n", MAX_LANES);
+        return 1;
+    }
+
+    if (boost < 0) {
+        fprintf(stderr, "Error: boost must be >= 0.\n");
+        return 1;
+    }
+
+    if (n_workers < 0 || n_workers > SHARD_MAX_WORKERS || n_workers > num_lanes) {
+        fprintf(stderr, "Error: worker count must be 0..%d and at most the lane count.\n",
+                SHARD_MAX_WORKERS);
+        return 1;
+    }
+
+    if (ctl_path && n_workers) {
+        fprintf(stderr, "Error: -C cannot be combined with -w.\n");
+        return 1;
+    }
+
+    /* stage threads step lanes concurrently: no reproducible ticks for
+     * -S, no single thread to serve -C clients, no room for -w shards */
+    if (pipeline && (n_workers || ctl_path || scripted)) {
+        fprintf(stderr, "Error: -P cannot be combined with -w, -C or -S.\n");
+        return 1;
+    }
+
+    srand(seed);
     setvbuf(stdout, NULL, _IOLBF, 0);
 
-    logfp = fopen(LOG_FILE, "w");
-    if (!logfp)
-        fprintf(stderr, "Warning: could not open %s for writing\n", LOG_FILE);
+    /* -w: from here on either the coordinator, or a worker running the
+     * rest of main() over its shard */
+    char log_name[32] = LOG_FILE;
+    char trace_name[256];
+    if (n_workers > 0) {
+        int w = shard_spawn(n_workers, num_lanes);
+        if (w == -2)
+            return 1;
+        if (w == -1)
+            return run_coordinator(channel_file, random_prio, boost, rates_arg, seed, bench_out);
+
+        worker    = shard_get(w);
+        lane_base = worker->lo;
+        num_lanes = worker->hi - worker->lo;
+        srand(seed + w);
+        FILE *out = shard_stdout(worker);
+        if (out)
+            stdout = out;
+        snprintf(log_name, sizeof(log_name), "sched.w%d.log", w);
+        if (trace_file) {
+            snprintf(trace_name, sizeof(trace_name), "%s.w%d", trace_file, w);
+            trace_file = trace_name;
+        }
+    }
+
+    /* scripted runs wait for each load so ticks don't depend on the disk */
+    if (chan_load_start(scripted, 1) != 0)
+        return 1;
+
+    if (!bench) {
+        logfp = fopen(log_name, "w");
+        if (!logfp)
+            fprintf(stderr, "Warning: could not open %s for writing\n", log_name);
+    }
 
     int clock = 0;
     fd_set readfds;
 
-    Task taskList[NUM_LANES];
+    /* Task array first (the scheduler's per-step working set), then the
+     * bitstreams, each lane's on its own cache lines */
+    size_t bits_bytes = N_BIT * sizeof(double);
+    size_t osf_bytes  = N_BIT * OSF * sizeof(double);
+    size_t arena_bytes = (size_t)num_lanes * (sizeof(Task) + bits_bytes + osf_bytes) +
+                         lane_snap_table_size(num_lanes) + 4 * 64;
+    Task *taskList = NULL;
+    if (arena_init(&arena, arena_bytes, pages) == 0)
+        taskList = arena_alloc(&arena, num_lanes * sizeof(Task), 64);
+    if (!taskList || fair_init(num_lanes, boost) != 0) {
+        fprintf(stderr, "Error: out of memory for %d lanes\n", num_lanes);
+        return 1;
+    }
+    double *bits     = arena_alloc(&arena, num_lanes * bits_bytes, 64);
+    double *bits_osf = arena_alloc(&arena, num_lanes * osf_bytes, 64);
+
+    if (ctl_path && ctl_open(ctl_path, num_lanes) != 0)
+        return 1;
+
+    if (worker) {
+        snaps = worker->snaps;
+        lane_snap_table_own(snaps);
+    }
+    else if (ctl_path)
+        snaps = ctl_snaps();
+    else if ((snaps = arena_alloc(&arena, lane_snap_table_size(num_lanes), 64)))
+        lane_snap_table_init(snaps, 0, num_lanes);
+    if (!snaps) {
+        fprintf(stderr, "Error: out of memory for %d lanes\n", num_lanes);
+        return 1;
+    }
 
     /* Initialize all lanes */
-    for (int i = 0; i < NUM_LANES; i++) {
-        lane_init(&taskList[i].lane, DEFAULT_DATA_RATE, channel_file);
-        taskList[i].priority = random_prio ? (rand() % NUM_LANES) : 1;
+    for (int i = 0; i < num_lanes; i++) {
+        lane_init_with(&taskList[i].lane, rates[i % n_rates], channel_file,
+                       bits + (size_t)i * N_BIT, bits_osf + (size_t)i * N_BIT * OSF);
+        taskList[i].priority = random_prio ? (rand() % PRIO_LEVELS) : 1;
+        taskList[i].enqueued = 0;
+        taskList[i].enqueued_ns = bench_now_ns();
+        taskList[i].parked = PARK_NONE;
+        fair_add(i, taskList[i].priority);
     }
+    for (int i = 0; i < num_lanes; i++)
+        publish_status(i, &taskList[i].lane);
 
-    printf("Scheduler started with channel '%s'.\n", channel_file);
-    printf("Priority mode: %s\n", random_prio ? "RANDOM" : "EQUAL");
-    printf("Logs → %s\n", LOG_FILE);
+    if (!bench && !worker) {
+        printf("Scheduler started with channel '%s'.\n", channel_file);
+        printf("Priority mode: %s\n", random_prio ? "RANDOM" : "EQUAL");
+        printf("Policy: fair (virtual runtime, reset boost %d steps)\n", boost);
+        printf("Lane arena: %zu MB, pages=%s\n", arena.size >> 20, arena_pages_name(arena.pages));
+        printf("Logs → %s\n", LOG_FILE);
+        if (ctl_path)
+            printf("Control socket: %s\n", ctl_path);
+        if (pipeline)
+            printf("Pipeline: INIT %d, CTLE %d, RX %d threads\n",
+                   stage_threads[0], stage_threads[1], stage_threads[2]);
 
-    /* print initial priorities */
-    printf("Initial priorities:");
-    for (int i = 0; i < NUM_LANES; i++)
-        printf(" [%d]=%d", i, taskList[i].priority);
-    printf("\n");
+        /* print initial priorities */
+        printf("Initial priorities:");
+        for (int i = 0; i < num_lanes; i++)
+            printf(" [%d]=%d", i, taskList[i].priority);
+        printf("\n");
 
-    printf("Commands:\n");
-    printf("  s [lane]          - show status (all lanes, or one lane)\n");
-    printf("  d <lane> <rate>   - change data rate for a lane\n");
-    printf("  r <lane>          - soft reset a lane\n");
-    printf("  p                 - turn PLL on/off\n");
+        printf("Commands:\n");
+        printf("  s [lane]          - show status (all lanes, or one lane)\n");
+        printf("  q [lane]          - status as key=value records\n");
+        printf("  d <lane> <rate>   - change data rate for a lane\n");
+        printf("  r <lane>          - soft reset a lane\n");
+        printf("  p                 - turn PLL on/off\n");
+    }
 
     if (logfp) {
         fprintf(logfp, "=== Scheduler started ===\n");
         fprintf(logfp, "Channel file: %s\n", channel_file);
         fprintf(logfp, "Priority mode: %s\n", random_prio ? "RANDOM" : "EQUAL");
-        fprintf(logfp, "Lanes: %d   Data rate: %d Gbps\n", NUM_LANES, DEFAULT_DATA_RATE);
+        fprintf(logfp, "Policy: fair (virtual runtime, reset boost %d steps)\n", boost);
+        fprintf(logfp, "Lane arena: %zu MB, pages=%s\n", arena.size >> 20,
+                arena_pages_name(arena.pages));
+        fprintf(logfp, "Lanes: %d   Data rate: %s Gbps\n", num_lanes,
+                rates_arg ? rates_arg : "60");
+        if (worker)
+            fprintf(logfp, "Shard: worker %d, lanes %d..%d\n", worker->id,
+                    worker->lo, worker->hi - 1);
+        if (pipeline)
+            fprintf(logfp, "Pipeline: INIT %d, CTLE %d, RX %d threads\n",
+                    stage_threads[0], stage_threads[1], stage_threads[2]);
         fprintf(logfp, "Initial priorities:");
-        for (int i = 0; i < NUM_LANES; i++)
-            fprintf(logfp, " [%d]=%d", i, taskList[i].priority);
+        for (int i = 0; i < num_lanes; i++)
+            fprintf(logfp, " [%d]=%d", lane_base + i, taskList[i].priority);
         fprintf(logfp, "\n");
         fprintf(logfp, "OSF=%d  N_BIT=%d  ADC_BITS=%d  NUM_LEVELS=%d\n",
                 OSF, N_BIT, ADC_BITS, NUM_LEVELS);
@@ -266,9 +1235,39 @@ int main(int argc, char *argv[]) {
                 CTLE_NA, CTLE_NZ, CTLE_WINDOW);
         fprintf(logfp, "Step size: %d samples/step\n\n", STEP_SIZE);
         fflush(logfp);
+
+        /* from here on, sched.log is written by the background logger */
+        tracefp = trace_file ? fopen(trace_file, "wb") : NULL;
+        if (trace_file && !tracefp)
+            fprintf(stderr, "Warning: could not open %s for writing\n", trace_file);
+        if (tracefp) {
+            lane_log_trace(tracefp);
+            fprintf(logfp, "Binary trace: %s\n\n", trace_file);
+        }
+        lane_log_start(logfp);
+    }
+
+    /* --realtime: everything is allocated and the helper threads are up
+     * (they stay SCHED_OTHER); from here on this thread should not fault.
+     * With -P it is the stage threads that step, and they enter it. */
+    if (realtime && !pipeline) {
+        arena_prefault(&arena);
+        if (logfp)
+            lane_log_begin(LOG_CAT_STEP, 0);    /* this thread's log ring, now */
+        rt_enter(realtime, worker ? worker->id : 0);
     }
 
-    int stdin_open = 1;
+    /* a worker's operator input comes through the coordinator's ring:
+     * the stdin it inherited is the coordinator's to read */
+    int stdin_open = !bench && !scripted && !worker;
+    if (stdin_open)
+        setvbuf(stdin, NULL, _IONBF, 0);   /* so select() sees every pending line */
+    bench_start(&bench_stats);
+
+    if (pipeline) {
+        run_pipeline(taskList, stdin_open);
+        goto exit;
+    }
 
     while (1) {
         clock++;
@@ -286,87 +1285,143 @@ int main(int argc, char *argv[]) {
                 char buf[64];
                 if (!fgets(buf, sizeof(buf), stdin)) {
                     stdin_open = 0;   /* EOF — stop polling */
-                } else if (buf[0] == 's') {
-                    int lane = -1;
-                    sscanf(buf, "s %d", &lane);
-                    if (lane >= 0 && lane < NUM_LANES) {
-                        print_lane_status(lane, &taskList[lane].lane);
-                    } else {
-                        printf("─── Lane Status ───\n");
-                        for (int i = 0; i < NUM_LANES; i++)
-                            print_lane_status(i, &taskList[i].lane);
-                    }
-                    if (logfp) fprintf(logfp, "[tick %8d] CMD: status query\n", tick);
-                }
-                else if (buf[0] == 'd') {
-                    int lane, rate;
-                    sscanf(buf, "d %d %d", &lane, &rate);
-                    if (lane >= 0 && lane < NUM_LANES) {
-                        taskList[lane].lane.dataRateGbps = rate;
-                        lane_soft_reset(&taskList[lane].lane);
-                        taskList[lane].priority = 0;
-                        printf("Lane %d rate changed to %d Gbps\n", lane, rate);
-                        if (logfp) fprintf(logfp, "[tick %8d] CMD: lane %d rate → %d Gbps (soft reset)\n",
-                                           tick, lane, rate);
-                    }
-                }
-                else if (buf[0] == 'r') {
-                    int lane;
-                    sscanf(buf, "r %d", &lane);
-                    if (lane >= 0 && lane < NUM_LANES) {
-                        lane_soft_reset(&taskList[lane].lane);
-                        taskList[lane].priority = 0;
-                        printf("Lane %d soft reset\n", lane);
-                        if (logfp) fprintf(logfp, "[tick %8d] CMD: lane %d soft reset\n", tick, lane);
-                    }
-                }
-                else if (buf[0] == 'p') {
-                    pll_enabled = !pll_enabled;
-                    printf("PLL %s\n", pll_enabled ? "ON" : "OFF");
-                    if (logfp) fprintf(logfp, "[tick %8d] CMD: PLL %s\n", tick,
-                                       pll_enabled ? "ON" : "OFF");
+                } else {
+                    handle_command(taskList, buf, 0);
                 }
             }
         }
 
-        /* -------- SCHEDULING -------- */
-
-        int best = 999999;
-        int chosen = -1;
+        /* -------- CONTROL SOCKET (-C) -------- */
+        if (ctl_path)
+            ctl_poll(tick, ctl_exec, taskList);
 
-        /* Find best priority */
-        for (int i = 0; i < NUM_LANES; i++) {
-            if (taskList[i].lane.state != DONE &&
-                taskList[i].priority < best)
-            {
-                best = taskList[i].priority;
+        /* -------- COMMANDS FROM THE COORDINATOR (-w) -------- */
+        if (worker) {
+            const ScriptCmd *c;
+            while ((c = shard_ring_peek(&worker->cmd)) && c->tick <= tick) {
+                handle_command(taskList, c->cmd, c->tick);
+                shard_ring_release(&worker->cmd);
             }
         }
 
-        /* Round-robin among best */
-        for (int k = 0; k < NUM_LANES; k++) {
-            int i = (rr_index + k) % NUM_LANES;
+        /* -------- SCRIPTED COMMANDS -------- */
+        if (scripted && !worker) {
+            const char *cmd;
+            while ((cmd = script_next(&script, tick)) != NULL)
+                handle_command(taskList, cmd, tick);
+        }
 
-            if (taskList[i].lane.state != DONE &&
-                taskList[i].priority == best)
-            {
-                chosen = i;
-                break;
-            }
+        /* -------- CHANNEL LOADS -------- */
+        if (chan_load_events() != load_events) {
+            load_events = chan_load_events();
+            if (n_parked[PARK_LOAD] || n_parked[PARK_ERROR])
+                wake_parked(taskList);
+            retrain_changed(taskList);
         }
 
+        /* -------- SCHEDULING -------- */
+
+        /* lane with the least virtual runtime */
+        int chosen = fair_pick();
+
         if (chosen >= 0 && pll_enabled) {
-            rr_index = (chosen + 1) % NUM_LANES;
-            taskStepForward(&taskList[chosen], chosen);
+            Task *t = &taskList[chosen];
+            LaneState phase = t->lane.state;
+            InitPhase sub = t->lane.init_phase;
+            uint64_t t0 = bench_now_ns();
+            taskStepForward(t, chosen);
+            uint64_t t1 = bench_now_ns();
+            bench_step(&bench_stats, phase, t1 - t0);
+            if (realtime)
+                rt_step(phase, t1 - t0);
+            if (phase == INIT && t1 - t0 > init_max_ns[sub])
+                init_max_ns[sub] = t1 - t0;
+            fair_charge(chosen, park(t) || t->lane.state == DONE);
+            publish_status(chosen, &t->lane);
+            if (t->lane.state == DONE) {
+                bench_linkup(&bench_stats, tick - t->enqueued + 1, t1 - t->enqueued_ns);
+                if (worker)
+                    shard_linkup(worker, tick - t->enqueued + 1, t1 - t->enqueued_ns);
+            }
         }
 
+        /* idle (all lanes DONE, or PLL off) until the next scripted command */
+        if (scripted && (chosen < 0 || !pll_enabled)) {
+            int next = next_command_tick();
+            if (next < 0)
+                goto exit;
+            if (next > tick)
+                tick = next - 1;
+            continue;
+        }
+
+        /* nothing runnable: block until something comes (idle_worth) */
         if (chosen < 0 && pll_enabled) {
-            goto exit;
+            if (!idle_worth(stdin_open))
+                goto exit;
+            idle_wait(stdin_open);
+            continue;
         }
 
-        usleep(10);    /* simulate firmware time slice */
+        if (!bench) {
+            uint64_t s0 = realtime ? bench_now_ns() : 0;
+            ctl_sleep(10);    /* simulate firmware time slice */
+            if (realtime)
+                rt_slice(10000, bench_now_ns() - s0);
+        }
     }
 
 exit:
+    if (worker) {
+        /* results go to the coordinator; reports are its job */
+        memcpy(worker->phase_ns, bench_stats.phase_ns, sizeof(worker->phase_ns));
+        memcpy(worker->phase_steps, bench_stats.phase_steps, sizeof(worker->phase_steps));
+        memcpy(worker->phase_max_ns, bench_stats.phase_max_ns, sizeof(worker->phase_max_ns));
+        if (realtime) {
+            char who[32];
+            snprintf(who, sizeof(who), "(worker %d)", worker->id);
+            rt_report(stderr, who);
+        }
+        fflush(stdout);
+        __atomic_store_n(&worker->finished, 1, __ATOMIC_RELEASE);
+        chan_load_stop();
+        bench_free(&bench_stats);
+        fair_free();
+        arena_destroy(&arena);
+        lane_log_stop();
+        if (tracefp) fclose(tracefp);
+        if (logfp) fclose(logfp);
+        return 0;
+    }
+    if (bench) {
+        FILE *out = bench_out ? fopen(bench_out, "w") : stdout;
+        if (!out) {
+            perror(bench_out);
+        } else {
+            BenchInfo info = { .program = "marsched", .channel = channel_file,
+                               .policy = "fair", .rates = rates_arg ? rates_arg : "60",
+                               .lanes = num_lanes, .random_prio = random_prio, .seed = seed };
+            bench_write(out, &bench_stats, &info);
+            if (out != stdout) fclose(out);
+        }
+    }
+    if (!bench)
+        worst_step_report(stderr);
+    if (realtime && !pipeline)
+        rt_report(stderr, NULL);
+    pipe_report(stderr);
+    chan_load_report(stderr);
+    chan_load_stop();
+    /* huge-page backing depends on the kernel's free memory, so it goes
+     * to stderr and -S output stays reproducible */
+    arena_report(stderr, &arena);
+    ctl_close();
+    bench_free(&bench_stats);
+    script_free(&script);
+    fair_free();
+    arena_destroy(&arena);
+    lane_log_stop();
+    if (tracefp) fclose(tracefp);
+    if (logfp) fclose(logfp);
     return 0;
 }
\ No newline at end of file
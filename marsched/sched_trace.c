@@ -0,0 +1,387 @@
+/*
+ * sched_trace.c
+ *
+ * Encoder / decoder for the compact binary scheduler trace.
+ *
+ * The encoder runs on the lane_log writer thread (see lane_log_trace()),
+ * so nothing here is on the scheduler hot path.  The decoder is used by
+ * the offline trace_decode tool.
+ */
+
+#include "sched_trace.h"
+
+typedef struct {
+    uint8_t  type;
+    uint8_t  aux;
+    uint16_t lane;
+    uint32_t arg;
+} TraceWord;
+
+_Static_assert(sizeof(TraceWord) == 8, "trace words are 8 bytes");
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Encoder
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static void put_hdr(TraceWriter *tw, TraceType type, int aux, int lane,
+                    uint32_t arg)
+{
+    TraceWord w = { (uint8_t)type, (uint8_t)aux, (uint16_t)lane, arg };
+    fwrite(&w, sizeof(w), 1, tw->fp);
+    tw->words++;
+}
+
+static void put_i32x2(TraceWriter *tw, int32_t a, int32_t b)
+{
+    int32_t w[2] = { a, b };
+    fwrite(w, sizeof(w), 1, tw->fp);
+    tw->words++;
+}
+
+static void put_f64(TraceWriter *tw, const double *v, int n)
+{
+    fwrite(v, sizeof(double), n, tw->fp);
+    tw->words += n;
+}
+
+/* intern a static string; emits TR_STR the first time it is seen */
+static int put_str(TraceWriter *tw, const char *s)
+{
+    for (int i = 0; i < tw->n_strings; i++)
+        if (tw->strings[i] == s)
+            return i;
+    if (tw->n_strings >= TRACE_MAX_STRINGS)
+        return -1;
+
+    int id  = tw->n_strings++;
+    int len = (int)strlen(s);
+    tw->strings[id] = s;
+
+    put_hdr(tw, TR_STR, 0, 0, (uint32_t)id);
+    put_i32x2(tw, len, 0);
+    int words = (len + 7) / 8;
+    char buf[8];
+    for (int w = 0; w < words; w++) {
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, s + w * 8, (len - w * 8) < 8 ? (size_t)(len - w * 8) : 8);
+        fwrite(buf, sizeof(buf), 1, tw->fp);
+    }
+    tw->words += words;
+    return id;
+}
+
+static void encode_step(TraceWriter *tw, const LogRecord *r, int has_prio)
+{
+    TraceLaneState *ls = &tw->lanes[r->lane];
+    uint32_t dtick = r->tick - tw->tick;
+    int32_t  dpt   = r->u.step.pt - ls->pt;
+    int aux = r->aux | (has_prio ? TRACE_AUX_PRIO : 0);
+
+    if (ls->valid && ls->phase == r->aux && ls->n_samp == r->u.step.n_samp &&
+        ls->since_key < TRACE_KEY_INTERVAL &&
+        dtick <= 0xFFFF && dpt >= INT16_MIN && dpt <= INT16_MAX)
+    {
+        put_hdr(tw, TR_STEP, aux, r->lane,
+                dtick | ((uint32_t)(uint16_t)(int16_t)dpt << 16));
+        ls->since_key++;
+    } else {
+        put_hdr(tw, TR_KEY, aux, r->lane, r->tick);
+        put_i32x2(tw, r->u.step.pt, r->u.step.n_samp);
+        ls->valid     = 1;
+        ls->phase     = r->aux;
+        ls->n_samp    = r->u.step.n_samp;
+        ls->since_key = 0;
+    }
+    ls->pt = r->u.step.pt;
+
+    if (has_prio)
+        put_hdr(tw, TR_PRIO, 0, r->lane, (uint32_t)r->u.step.prio);
+}
+
+int trace_writer_open(TraceWriter *tw, FILE *fp)
+{
+    memset(tw, 0, sizeof(*tw));
+    tw->fp    = fp;
+    tw->lanes = calloc(TRACE_MAX_LANES, sizeof(TraceLaneState));
+    if (!tw->lanes) return -1;
+
+    uint32_t hdr[2] = { TRACE_VERSION, sizeof(TraceWord) };
+    fwrite(TRACE_MAGIC, 8, 1, fp);
+    fwrite(hdr, sizeof(hdr), 1, fp);
+    return 0;
+}
+
+void trace_encode(TraceWriter *tw, const LogRecord *r)
+{
+    int id;
+
+    switch ((LogKind)r->kind) {
+        case LOG_REC_STEP:
+            encode_step(tw, r, 0);
+            break;
+
+        case LOG_REC_STEP_PRIO:
+            encode_step(tw, r, 1);
+            break;
+
+        case LOG_REC_CTLE_GRID:
+            put_hdr(tw, TR_GRID, 0, r->lane, r->tick);
+            put_i32x2(tw, r->u.grid.old_grid, r->u.grid.new_grid);
+            put_f64(tw, &r->u.grid.A_prev, 5);
+            break;
+
+        case LOG_REC_RX_PROGRESS:
+            put_hdr(tw, TR_RX_PROGRESS, 0, r->lane, r->tick);
+            put_i32x2(tw, r->u.rx.pct, 0);
+            put_f64(tw, &r->u.rx.ffe_main, 2);
+            break;
+
+        case LOG_REC_VEC: {
+            int n = r->u.vec.total - r->u.vec.start;
+            if (n > LOG_VEC_CHUNK) n = LOG_VEC_CHUNK;
+            put_hdr(tw, TR_VEC, r->aux, r->lane, r->tick);
+            put_i32x2(tw, r->u.vec.start, r->u.vec.total);
+            put_f64(tw, r->u.vec.v, n);
+            break;
+        }
+
+        case LOG_REC_TRANS:
+            put_hdr(tw, TR_TRANS, r->aux, r->lane, r->tick);
+            put_i32x2(tw, r->u.trans.next, 0);
+            break;
+
+        case LOG_REC_TRANS_INIT:
+            id = put_str(tw, r->u.init.file);
+            put_hdr(tw, TR_TRANS_INIT, 0, r->lane, r->tick);
+            put_i32x2(tw, r->u.init.L, r->u.init.rate);
+            put_i32x2(tw, r->u.init.instant, r->u.init.lag);
+            put_f64(tw, &r->u.init.Fs, 1);
+            put_i32x2(tw, id, 0);
+            break;
+
+        case LOG_REC_TRANS_CTLE:
+            put_hdr(tw, TR_TRANS_CTLE, 0, r->lane, r->tick);
+            put_f64(tw, &r->u.ctle.A, 3);
+            break;
+
+        case LOG_REC_TRANS_END:
+            put_hdr(tw, TR_TRANS_END, 0, r->lane, r->tick);
+            break;
+
+        case LOG_REC_TEXT:
+            id = put_str(tw, r->u.text.fmt);
+            put_hdr(tw, TR_TEXT, 0, r->lane, r->tick);
+            put_i32x2(tw, id, r->u.text.a[0]);
+            put_i32x2(tw, r->u.text.a[1], r->u.text.a[2]);
+            break;
+    }
+    tw->tick = r->tick;
+}
+
+void trace_writer_close(TraceWriter *tw)
+{
+    fflush(tw->fp);
+    free(tw->lanes);
+    tw->lanes = NULL;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Decoder
+ * ═══════════════════════════════════════════════════════════════════════ */
+
+static int get_i32x2(TraceReader *tr, int32_t *a, int32_t *b)
+{
+    int32_t w[2];
+    if (fread(w, sizeof(w), 1, tr->fp) != 1) return -1;
+    *a = w[0];
+    if (b) *b = w[1];
+    return 0;
+}
+
+static int get_f64(TraceReader *tr, double *v, int n)
+{
+    return fread(v, sizeof(double), n, tr->fp) == (size_t)n ? 0 : -1;
+}
+
+/* only "%d"-style conversions may come from a trace file, and no more
+ * of them than a text record has arguments (LogRecord.u.text.a) */
+static int fmt_is_safe(const char *s)
+{
+    int n = 0;
+    for (; *s; s++) {
+        if (*s != '%') continue;
+        s++;
+        if (*s == '%') continue;
+        while (*s == '-' || *s == '+' || *s == ' ' || *s == '0') s++;
+        while (*s >= '0' && *s <= '9') s++;
+        if (*s != 'd' && *s != 'u' && *s != 'x') return 0;
+        if (++n > 3) return 0;
+    }
+    return 1;
+}
+
+static const char *get_str(TraceReader *tr, int32_t id)
+{
+    if (id < 0 || id >= TRACE_MAX_STRINGS || !tr->strings[id])
+        return "?";
+    return tr->strings[id];
+}
+
+int trace_reader_open(TraceReader *tr, FILE *fp)
+{
+    char magic[8];
+    uint32_t hdr[2];
+
+    memset(tr, 0, sizeof(*tr));
+    tr->fp = fp;
+    if (fread(magic, 8, 1, fp) != 1 || memcmp(magic, TRACE_MAGIC, 8) != 0 ||
+        fread(hdr, sizeof(hdr), 1, fp) != 1 ||
+        hdr[0] != TRACE_VERSION || hdr[1] != sizeof(TraceWord))
+        return -1;
+
+    tr->lanes = calloc(TRACE_MAX_LANES, sizeof(TraceLaneState));
+    return tr->lanes ? 0 : -1;
+}
+
+int trace_read(TraceReader *tr, LogRecord *r)
+{
+    TraceWord w;
+    int32_t a, b;
+
+    for (;;) {
+        if (fread(&w, sizeof(w), 1, tr->fp) != 1)
+            return 0;
+
+        memset(r, 0, sizeof(*r));
+        r->lane = w.lane;
+
+        switch ((TraceType)w.type) {
+            case TR_STR: {
+                if (get_i32x2(tr, &a, NULL) || a < 0 || w.arg >= TRACE_MAX_STRINGS)
+                    return -1;
+                int words = (a + 7) / 8;
+                char *s = calloc((size_t)words * 8 + 1, 1);
+                if (!s || fread(s, 8, words, tr->fp) != (size_t)words) {
+                    free(s);
+                    return -1;
+                }
+                if (!fmt_is_safe(s)) s[0] = '\0';
+                free(tr->strings[w.arg]);
+                tr->strings[w.arg] = s;
+                continue;           /* not a record of its own */
+            }
+
+            case TR_KEY:
+            case TR_STEP: {
+                TraceLaneState *ls = &tr->lanes[w.lane];
+                if (w.type == TR_KEY) {
+                    r->tick = w.arg;
+                    if (get_i32x2(tr, &a, &b)) return -1;
+                    ls->pt     = a;
+                    ls->n_samp = b;
+                    ls->valid  = 1;
+                } else {
+                    if (!ls->valid) return -1;
+                    r->tick = tr->tick + (w.arg & 0xFFFF);
+                    ls->pt += (int16_t)(w.arg >> 16);
+                }
+                r->kind          = LOG_REC_STEP;
+                r->aux           = w.aux & ~TRACE_AUX_PRIO;
+                r->u.step.pt     = ls->pt;
+                r->u.step.n_samp = ls->n_samp;
+
+                if (w.aux & TRACE_AUX_PRIO) {
+                    TraceWord p;
+                    if (fread(&p, sizeof(p), 1, tr->fp) != 1 || p.type != TR_PRIO)
+                        return -1;
+                    r->kind        = LOG_REC_STEP_PRIO;
+                    r->u.step.prio = (int32_t)p.arg;
+                }
+                break;
+            }
+
+            case TR_GRID:
+                r->kind = LOG_REC_CTLE_GRID;
+                r->tick = w.arg;
+                if (get_i32x2(tr, &r->u.grid.old_grid, &r->u.grid.new_grid) ||
+                    get_f64(tr, &r->u.grid.A_prev, 5))
+                    return -1;
+                break;
+
+            case TR_RX_PROGRESS:
+                r->kind = LOG_REC_RX_PROGRESS;
+                r->tick = w.arg;
+                if (get_i32x2(tr, &r->u.rx.pct, NULL) ||
+                    get_f64(tr, &r->u.rx.ffe_main, 2))
+                    return -1;
+                break;
+
+            case TR_VEC: {
+                r->kind = LOG_REC_VEC;
+                r->aux  = w.aux;
+                r->tick = w.arg;
+                if (get_i32x2(tr, &r->u.vec.start, &r->u.vec.total))
+                    return -1;
+                int n = r->u.vec.total - r->u.vec.start;
+                if (n > LOG_VEC_CHUNK) n = LOG_VEC_CHUNK;
+                if (n < 0 || get_f64(tr, r->u.vec.v, n))
+                    return -1;
+                break;
+            }
+
+            case TR_TRANS:
+                r->kind = LOG_REC_TRANS;
+                r->aux  = w.aux;
+                r->tick = w.arg;
+                if (get_i32x2(tr, &r->u.trans.next, NULL) ||
+                    r->u.trans.next < 0 || r->u.trans.next > ERROR)
+                    return -1;      /* indexes the decoder's phase table */
+                break;
+
+            case TR_TRANS_INIT:
+                r->kind = LOG_REC_TRANS_INIT;
+                r->tick = w.arg;
+                if (get_i32x2(tr, &r->u.init.L, &r->u.init.rate) ||
+                    get_i32x2(tr, &r->u.init.instant, &r->u.init.lag) ||
+                    get_f64(tr, &r->u.init.Fs, 1) ||
+                    get_i32x2(tr, &a, NULL))
+                    return -1;
+                r->u.init.file = get_str(tr, a);
+                break;
+
+            case TR_TRANS_CTLE:
+                r->kind = LOG_REC_TRANS_CTLE;
+                r->tick = w.arg;
+                if (get_f64(tr, &r->u.ctle.A, 3)) return -1;
+                break;
+
+            case TR_TRANS_END:
+                r->kind = LOG_REC_TRANS_END;
+                r->tick = w.arg;
+                break;
+
+            case TR_TEXT:
+                r->kind = LOG_REC_TEXT;
+                r->tick = w.arg;
+                if (get_i32x2(tr, &a, &r->u.text.a[0]) ||
+                    get_i32x2(tr, &r->u.text.a[1], &r->u.text.a[2]))
+                    return -1;
+                r->u.text.fmt = get_str(tr, a);
+                break;
+
+            default:
+                return -1;
+        }
+
+        tr->tick = r->tick;
+        return 1;
+    }
+}
+
+void trace_reader_close(TraceReader *tr)
+{
+    for (int i = 0; i < TRACE_MAX_STRINGS; i++)
+        free(tr->strings[i]);
+    free(tr->lanes);
+    memset(tr, 0, sizeof(*tr));
+}
@@ -0,0 +1,115 @@
+/*
+ * script.c
+ *
+ * Loader and cursor for tick-stamped command scripts (see script.h).
+ * Shared by genericsched and marsched.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "script.h"
+
+static int script_push(Script *s, int tick, const char *cmd)
+{
+    if (s->n == s->cap) {
+        int cap = s->cap ? s->cap * 2 : 64;
+        ScriptCmd *buf = realloc(s->cmds, cap * sizeof(ScriptCmd));
+        if (!buf) return -1;
+        s->cmds = buf;
+        s->cap  = cap;
+    }
+    ScriptCmd *c = &s->cmds[s->n++];
+    c->tick = tick;
+    snprintf(c->cmd, sizeof(c->cmd), "%s", cmd);
+    return 0;
+}
+
+int script_load(Script *s, const char *path)
+{
+    memset(s, 0, sizeof(*s));
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    int lineno = 0, prev = 0, rc = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#')
+            continue;
+
+        if (*p != '@') {
+            fprintf(stderr, "%s:%d: expected '@<tick> <command>'\n", path, lineno);
+            rc = -1;
+            break;
+        }
+        p++;
+
+        int relative = (*p == '+');
+        if (relative) p++;
+
+        char *end;
+        long t = strtol(p, &end, 10);
+        if (end == p || t < 0 || !isspace((unsigned char)*end)) {
+            fprintf(stderr, "%s:%d: bad tick\n", path, lineno);
+            rc = -1;
+            break;
+        }
+        if (relative)
+            t += prev;
+        if (t < prev) {
+            fprintf(stderr, "%s:%d: tick %ld is before the previous line (%d)\n",
+                    path, lineno, t, prev);
+            rc = -1;
+            break;
+        }
+
+        p = end;
+        while (isspace((unsigned char)*p)) p++;
+        p[strcspn(p, "\r\n")] = '\0';
+        if (*p == '\0') {
+            fprintf(stderr, "%s:%d: missing command\n", path, lineno);
+            rc = -1;
+            break;
+        }
+
+        if (script_push(s, (int)t, p) != 0) {
+            fprintf(stderr, "%s: out of memory\n", path);
+            rc = -1;
+            break;
+        }
+        prev = (int)t;
+    }
+
+    fclose(fp);
+    if (rc != 0)
+        script_free(s);
+    return rc;
+}
+
+const char *script_next(Script *s, int tick)
+{
+    if (s->next < s->n && s->cmds[s->next].tick <= tick)
+        return s->cmds[s->next++].cmd;
+    return NULL;
+}
+
+int script_next_tick(const Script *s)
+{
+    return s->next < s->n ? s->cmds[s->next].tick : -1;
+}
+
+void script_free(Script *s)
+{
+    free(s->cmds);
+    memset(s, 0, sizeof(*s));
+}
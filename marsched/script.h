@@ -0,0 +1,50 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Scripted command replay (-S <script>)
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  One command per line, stamped with the scheduler tick it is injected
+ *  at — before that tick's step runs, exactly as if it had been typed:
+ *
+ *    # reset storm
+ *    @12000 r 3
+ *    @+0    r 4          same tick as the previous line
+ *    @+500  d 5 56       500 ticks after the previous line
+ *    @20000 p
+ *
+ *  Absolute ticks must not go backwards.  Blank lines and lines
+ *  starting with '#' are ignored.  Commands are passed through
+ *  unchanged to the interactive command interpreter.
+ *
+ *  With a script the scheduler does not read stdin, and anything that
+ *  depends on wall time is replaced by a fixed model, so a run with a
+ *  given -s seed and script is reproducible bit for bit.
+ */
+#define SCRIPT_CMD_MAX  128
+
+typedef struct {
+    int  tick;
+    char cmd[SCRIPT_CMD_MAX];
+} ScriptCmd;
+
+typedef struct {
+    ScriptCmd *cmds;
+    int        n, cap;
+    int        next;                /* first command not yet injected     */
+} Script;
+
+/* Parse a script file; errors go to stderr with the line number.
+ * Returns 0 on success. */
+int  script_load(Script *s, const char *path);
+
+/* Next command due at or before `tick` (advancing the cursor), or NULL. */
+const char *script_next(Script *s, int tick);
+
+/* Tick of the next pending command, or -1 when the script is done. */
+int  script_next_tick(const Script *s);
+
+void script_free(Script *s);
+
+#endif /* SCRIPT_H */
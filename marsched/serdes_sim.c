@@ -6,18 +6,23 @@
  * State machine driven by the scheduler in sched.c:
  *
  *   INIT  →  CTLE  →  RX  →  DONE
+ *     ↓
+ *   ERROR   (channel file cannot be loaded; see chan_load.h)
  *
  *   lane_init()        →  allocate buffers, enter INIT (no DSP work)
- *   lane_step_init()   →  generate PRBS, build channel, run CDR → CTLE
+ *   lane_step_init()   →  load channel, run CDR, generate PRBS in budgeted
+ *                          chunks → CTLE
  *   lane_step_ctle()   →  advance CTLE sweep by STEP_SIZE samples
  *   lane_step_rx()     →  advance RX FFE+DFE training by STEP_SIZE samples
- *   lane_soft_reset()  →  restart from INIT (keeps channel if loaded)
+ *   lane_soft_reset()  →  restart from INIT (reloads the channel)
+ *   lane_retrain()     →  new taps for the same channel file
  *   lane_destroy()     →  free heap memory
  *
  * TX FFE taps are pre-programmed (unit tap at pre-cursor position).
  */
 
 #include "serdes_sim.h"
+#include "chan_load.h"
 
 /* ═══════════════════════════════════════════════════════════════════════
  *  Utility helpers
@@ -84,20 +89,6 @@ double ctle_step(CTLEFilter *ctle, double x)
     return y;
 }
 
-int load_channel_taps(const char *filename, double *h_fir, int max_taps)
-{
-    FILE *fp = fopen(filename, "r");
-    if (!fp) {
-        fprintf(stderr, "ERROR: cannot open '%s'\n", filename);
-        return -1;
-    }
-    int L = 0;
-    while (L < max_taps && fscanf(fp, "%lf", &h_fir[L]) == 1)
-        L++;
-    fclose(fp);
-    return L;
-}
-
 double adc_quantize(double x, int B)
 {
     double clamped = x;
@@ -167,79 +158,164 @@ static double apply_channel(LaneContext *ctx, double sample_in)
 }
 
 /* ═══════════════════════════════════════════════════════════════════════
- *  Internal: generate PAM-4 PRBS
- * ═══════════════════════════════════════════════════════════════════════ */
-static void generate_prbs(LaneContext *ctx)
+ *  Internal: resumable INIT sub-phases
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  Each *_chunk() does at most one step's worth of work (see
+ *  STEP_SIZE in serdes_sim.h), keeps its position in init_pt and
+ *  returns nonzero when its sub-phase is complete.  Together they compute
+ *  exactly what the former one-shot load / run_cdr() / PRBS did.
+ */
+#if LEN_CDR > N_BIT
+#error "the CDR edge trace is kept in bits_osf and needs LEN_CDR <= N_BIT"
+#endif
+
+static void begin_init_phase(LaneContext *ctx, InitPhase phase)
 {
-    for (int i = 0; i < N_BIT; i++) {
-        int sym = rand() % NUM_LEVELS;
-        ctx->bits[i] = (2.0 * sym - (NUM_LEVELS - 1)) / (NUM_LEVELS - 1);
-        for (int j = 0; j < OSF; j++)
-            ctx->bits_osf[i * OSF + j] = ctx->bits[i];
-    }
+    ctx->init_phase = phase;
+    ctx->init_pt    = 0;
 }
 
-/* ═══════════════════════════════════════════════════════════════════════
- *  Internal: run CDR
- * ═══════════════════════════════════════════════════════════════════════ */
-static void run_cdr(LaneContext *ctx)
+/* Work units per step for the DSP sub-phases: one CTLE/RX step's worth */
+static int init_budget(const LaneContext *ctx)
 {
-    int total_cdr = LEN_CDR * OSF;
+    return STEP_SIZE * ctx->L;
+}
 
-    double *cb = (double *)calloc(ctx->L, sizeof(double));
-    double *d_edge = (double *)malloc(total_cdr * sizeof(double));
+/* Taps from the I/O thread (chan_load.h): 1 when they are in h_fir, 0
+ * while the load is in flight, -1 if it failed (ctx->load_err). */
+static int load_chunk(LaneContext *ctx)
+{
+    if (!ctx->load_gen)
+        ctx->load_entry = chan_load_request(ctx->channel_file, &ctx->load_gen);
+
+    switch (chan_load_result(ctx->load_entry, ctx->load_gen, ctx->h_fir,
+                             &ctx->L, &ctx->load_err, &ctx->taps_version)) {
+        case CHAN_PENDING:
+            return 0;
+        case CHAN_READY:
+            ctx->load_gen = 0;
+            return 1;
+        default:
+            ctx->load_gen = 0;
+            ctx->L = 0;
+            return -1;
+    }
+}
 
-    double post_channel = 0.0;
+/* Drive the CDR clock pattern (alternating symbols) through the channel
+ * and record the output's first difference in d_edge. */
+static int cdr_chunk(LaneContext *ctx)
+{
+    int     total_cdr = LEN_CDR * OSF;
+    double *cb        = ctx->channel_buffer;
+    double *d_edge    = ctx->bits_osf;
 
-    for (int pt = 0; pt < total_cdr; pt++) {
+    int end = ctx->init_pt + STEP_SIZE;
+    if (end > total_cdr) end = total_cdr;
+
+    for (int pt = ctx->init_pt; pt < end; pt++) {
         int sym_pair = pt / OSF;
         int clk_val  = (sym_pair % 2);
 
         memmove(cb + 1, cb, (ctx->L - 1) * sizeof(double));
         cb[0] = clk_val;
 
-        double post_prev = post_channel;
-        post_channel = 0.0;
+        double post_prev = ctx->cdr_post;
+        double post_channel = 0.0;
         for (int k = 0; k < ctx->L; k++)
             post_channel += ctx->h_fir[k] * cb[k];
+        ctx->cdr_post = post_channel;
 
         d_edge[pt] = post_channel - post_prev;
     }
+    ctx->init_pt = end;
+    return end >= total_cdr;
+}
 
-    /* find zero crossings */
-    int *cross_raw = (int *)malloc(total_cdr * sizeof(int));
-    int  n_cross = 0;
-    for (int i = 0; i < total_cdr - 1; i++) {
-        if (d_edge[i] * d_edge[i + 1] <= 0.0) {
+/* Zero crossings of d_edge, binned by sample phase (pt % OSF), and its
+ * maximum.  The most common phase is the sampling instant. */
+static int edges_chunk(LaneContext *ctx)
+{
+    int           total_cdr = LEN_CDR * OSF;
+    const double *d_edge    = ctx->bits_osf;
+
+    if (ctx->init_pt == 0) {
+        memset(ctx->cross_hist, 0, sizeof(ctx->cross_hist));
+        ctx->edge_max = -DBL_MAX;
+    }
+
+    int end = ctx->init_pt + init_budget(ctx);
+    if (end > total_cdr) end = total_cdr;
+
+    for (int i = ctx->init_pt; i < end; i++) {
+        if (i < total_cdr - 1 && d_edge[i] * d_edge[i + 1] <= 0.0) {
             int zc = (fabs(d_edge[i]) <= fabs(d_edge[i + 1])) ? i : i + 1;
-            cross_raw[n_cross++] = zc;
+            ctx->cross_hist[zc % OSF]++;
         }
+        if (!isnan(d_edge[i]) && d_edge[i] > ctx->edge_max)
+            ctx->edge_max = d_edge[i];
     }
+    ctx->init_pt = end;
+    if (end < total_cdr)
+        return 0;
+
+    /* mode, lowest phase on ties (as int_mode() does) */
+    int best_cnt = 0;
+    ctx->sample_instant = 0;
+    for (int i = 0; i < OSF; i++) {
+        if (ctx->cross_hist[i] > best_cnt) {
+            best_cnt = ctx->cross_hist[i];
+            ctx->sample_instant = i;
+        }
+    }
+    return 1;
+}
 
-    int *cross_mod = (int *)malloc(n_cross * sizeof(int));
-    for (int i = 0; i < n_cross; i++)
-        cross_mod[i] = cross_raw[i] % OSF;
-    ctx->sample_instant = int_mode(cross_mod, n_cross);
+/* Lag: first edge above 0.8 of the maximum, less half the instant. */
+static int lag_chunk(LaneContext *ctx)
+{
+    int           total_cdr = LEN_CDR * OSF;
+    const double *d_edge    = ctx->bits_osf;
 
-    double d_max = -DBL_MAX;
-    for (int i = 0; i < total_cdr; i++)
-        if (!isnan(d_edge[i]) && d_edge[i] > d_max)
-            d_max = d_edge[i];
+    int end = ctx->init_pt + init_budget(ctx);
+    if (end > total_cdr) end = total_cdr;
 
-    int first_high = 0;
-    for (int i = 0; i < total_cdr; i++) {
-        if (!isnan(d_edge[i]) && d_edge[i] > d_max * 0.8) {
+    int first_high = -1;
+    for (int i = ctx->init_pt; i < end; i++) {
+        if (!isnan(d_edge[i]) && d_edge[i] > ctx->edge_max * 0.8) {
             first_high = i;
             break;
         }
     }
+    ctx->init_pt = end;
+    if (first_high < 0 && end < total_cdr)
+        return 0;
+
+    if (first_high < 0)
+        first_high = 0;
     ctx->lag = first_high -
                (int)round((double)ctx->sample_instant / 2.0);
+    return 1;
+}
 
-    free(cross_raw);
-    free(cross_mod);
-    free(d_edge);
-    free(cb);
+/* PAM-4 PRBS, symbol by symbol into bits and (held OSF times) bits_osf */
+static int prbs_chunk(LaneContext *ctx)
+{
+    int n = init_budget(ctx) / OSF;
+    if (n < 1) n = 1;
+
+    int end = ctx->init_pt + n;
+    if (end > N_BIT) end = N_BIT;
+
+    for (int i = ctx->init_pt; i < end; i++) {
+        int sym = rand() % NUM_LEVELS;
+        ctx->bits[i] = (2.0 * sym - (NUM_LEVELS - 1)) / (NUM_LEVELS - 1);
+        for (int j = 0; j < OSF; j++)
+            ctx->bits_osf[i * OSF + j] = ctx->bits[i];
+    }
+    ctx->init_pt = end;
+    return end >= N_BIT;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════
@@ -274,6 +350,7 @@ static void enter_ctle_phase(LaneContext *ctx)
     ctx->iz = 0;
     ctx->ctle_cnt = 0;
     ctx->err_acc  = 0.0;
+    ctx->mse      = 0.0;
     ctx->ctle_train_done = 0;
 
     for (int a = 0; a < CTLE_NA; a++)
@@ -320,6 +397,16 @@ static void enter_rx_phase(LaneContext *ctx)
  *  No DSP work is performed here.
  */
 void lane_init(LaneContext *ctx, int dataRateGbps, const char *channel_file)
+{
+    lane_init_with(ctx, dataRateGbps, channel_file, NULL, NULL);
+}
+
+/* ── lane_init_with ───────────────────────────────────────────────────
+ *  As lane_init(), with caller-owned bitstream buffers (e.g. carved from
+ *  the lane arena); NULL buffers are malloc()ed and owned by the lane.
+ */
+void lane_init_with(LaneContext *ctx, int dataRateGbps, const char *channel_file,
+                    double *bits, double *bits_osf)
 {
     memset(ctx, 0, sizeof(*ctx));
 
@@ -328,8 +415,9 @@ void lane_init(LaneContext *ctx, int dataRateGbps, const char *channel_file)
     ctx->Fs           = (double)OSF * (double)dataRateGbps * 1e9;
     ctx->channel_file = channel_file;
 
-    ctx->bits     = (double *)malloc(N_BIT * sizeof(double));
-    ctx->bits_osf = (double *)malloc(N_BIT * OSF * sizeof(double));
+    ctx->own_bits = !bits || !bits_osf;
+    ctx->bits     = ctx->own_bits ? (double *)malloc(N_BIT * sizeof(double)) : bits;
+    ctx->bits_osf = ctx->own_bits ? (double *)malloc(N_BIT * OSF * sizeof(double)) : bits_osf;
 
     /* pre-programmed TX FFE: unit tap at pre-cursor position */
     memset(ctx->TX_FFE, 0, sizeof(ctx->TX_FFE));
@@ -337,10 +425,15 @@ void lane_init(LaneContext *ctx, int dataRateGbps, const char *channel_file)
 }
 
 /* ── lane_step_init ───────────────────────────────────────────────────
- *  Generate PRBS, build default channel (if none loaded from file),
- *  run CDR, then transition → CTLE.
+ *  Advance INIT by one chunk of its current sub-phase:
+ *
+ *    INIT_LOAD → INIT_CDR → INIT_EDGES → INIT_LAG → INIT_PRBS → CTLE
  *
- *  Completes in a single call (CDR is inherently a batch operation).
+ *  INIT_LOAD only checks on the I/O thread: it stays put while the load
+ *  is in flight and goes to ERROR if the file cannot be loaded.
+ *
+ *  Each call costs about one CTLE/RX step, so a lane in INIT no longer
+ *  holds the scheduler for the whole CDR.
  */
 void lane_step_init(LaneContext *ctx)
 {
@@ -349,27 +442,51 @@ void lane_step_init(LaneContext *ctx)
     /* recompute Fs in case dataRateGbps changed */
     ctx->Fs = (double)OSF * (double)ctx->dataRateGbps * 1e9;
 
-    /* load channel FIR taps from file */
-    int L = load_channel_taps(ctx->channel_file, ctx->h_fir, MAX_CHANNEL_TAPS);
-    if (L <= 0) {
-        fprintf(stderr, "lane_step_init: failed to load '%s'\n",
-                ctx->channel_file);
-        return;   /* stay in INIT — scheduler will retry */
+    switch (ctx->init_phase) {
+        case INIT_LOAD: {
+            int r = load_chunk(ctx);
+            if (r < 0) {
+                ctx->state = ERROR;   /* the loader retries with backoff */
+                return;
+            }
+            if (r > 0) {
+                memset(ctx->channel_buffer, 0, ctx->L * sizeof(double));
+                ctx->cdr_post = 0.0;
+                begin_init_phase(ctx, INIT_CDR);
+            }
+            break;
+        }
+        case INIT_CDR:
+            if (cdr_chunk(ctx))
+                begin_init_phase(ctx, INIT_EDGES);
+            break;
+        case INIT_EDGES:
+            if (edges_chunk(ctx))
+                begin_init_phase(ctx, INIT_LAG);
+            break;
+        case INIT_LAG:
+            if (lag_chunk(ctx))
+                begin_init_phase(ctx, INIT_PRBS);
+            break;
+        case INIT_PRBS:
+            if (prbs_chunk(ctx)) {
+                begin_init_phase(ctx, INIT_LOAD);
+                enter_ctle_phase(ctx);
+            }
+            break;
     }
-    ctx->L = L;
-
-    generate_prbs(ctx);
-    run_cdr(ctx);
-
-    enter_ctle_phase(ctx);
 }
 
 /* ── lane_soft_reset ──────────────────────────────────────────────────
- *  Restart link training from INIT.  Keeps loaded channel taps (if any)
- *  so CDR and training re-run against the same channel.
+ *  Restart link training from INIT, at its first sub-phase: the channel
+ *  is reloaded, so an edited tap file takes effect.
  */
 void lane_soft_reset(LaneContext *ctx)
 {
+    ctx->load_gen = 0;    /* ask for the file afresh */
+    ctx->retrain  = 0;
+    begin_init_phase(ctx, INIT_LOAD);
+
     /* reset TX FFE to pre-programmed values */
     memset(ctx->TX_FFE, 0, sizeof(ctx->TX_FFE));
     ctx->TX_FFE[TX_FFE_PRE] = 1.0;
@@ -377,6 +494,43 @@ void lane_soft_reset(LaneContext *ctx)
     ctx->state = INIT;
 }
 
+/* ── lane_channel_changed ─────────────────────────────────────────────
+ *  Lanes still waiting for their first taps, or in ERROR, get the new
+ *  ones through the ordinary load.
+ */
+int lane_channel_changed(const LaneContext *ctx)
+{
+    if (ctx->state == ERROR || !ctx->taps_version ||
+        (ctx->state == INIT && ctx->init_phase == INIT_LOAD))
+        return 0;
+    unsigned v = chan_load_version(ctx->load_entry, ctx->channel_file);
+    return v && v != ctx->taps_version;
+}
+
+/* ── lane_retrain ─────────────────────────────────────────────────────
+ *  Small channel drift needs neither a new CDR lock nor a new CTLE
+ *  sweep: rerun RX from where the equaliser is.
+ */
+int lane_retrain(LaneContext *ctx)
+{
+    if ((ctx->state != RX && ctx->state != DONE) ||
+        chan_load_taps(ctx->load_entry, ctx->channel_file,
+                       ctx->h_fir, &ctx->L, &ctx->taps_version) != 0) {
+        lane_soft_reset(ctx);
+        return 0;
+    }
+
+    ctx->retrain     = 1;
+    ctx->retrain_mse = ctx->mse;
+
+    ctx->state  = RX;
+    ctx->pt     = 0;
+    ctx->N_samp = (N_BIT - TX_FFE_POST) * OSF;
+    ctle_design(&ctx->ctle, ctx->Fs, ctx->ctle_z, ctx->ctle_p, ctx->ctle_A);
+    reset_signal_path(ctx);
+    return 1;
+}
+
 /* ── lane_step_ctle ───────────────────────────────────────────────────
  *  Advance the CTLE sweep by up to STEP_SIZE oversampled points.
  *  Transitions → RX when the sweep grid has been fully evaluated
@@ -411,6 +565,7 @@ void lane_step_ctle(LaneContext *ctx)
                     if (ctx->ctle_cnt == CTLE_WINDOW) {
                         ctx->J[ctx->ia][ctx->iz] =
                             ctx->err_acc / CTLE_WINDOW;
+                        ctx->mse      = ctx->J[ctx->ia][ctx->iz];
                         ctx->ctle_cnt = 0;
                         ctx->err_acc  = 0.0;
 
@@ -509,6 +664,7 @@ void lane_step_rx(LaneContext *ctx)
             if (lag_idx >= 0 && lag_idx < N_BIT * OSF) {
                 double desired   = ctx->bits_osf[lag_idx];
                 double bit_error = desired - y;
+                ctx->mse += (bit_error * bit_error - ctx->mse) / RX_MSE_SPAN;
 
                 for (int k = 0; k < RX_FFE_LEN; k++)
                     ctx->RX_FFE[k] += ctx->mu_ffe * bit_error *
@@ -533,12 +689,39 @@ void lane_step_rx(LaneContext *ctx)
 }
 
 /* ── lane_destroy ─────────────────────────────────────────────────────
- *  Free heap memory owned by the lane context.
+ *  Free heap memory owned by the lane context (not caller-owned
+ *  bitstream buffers from lane_init_with()).
  */
 void lane_destroy(LaneContext *ctx)
 {
-    free(ctx->bits);
-    free(ctx->bits_osf);
+    if (ctx->own_bits) {
+        free(ctx->bits);
+        free(ctx->bits_osf);
+    }
     ctx->bits     = NULL;
     ctx->bits_osf = NULL;
-}
\ No newline at end of file
+}
+
+const char *state_name(LaneState s)
+{
+    switch (s) {
+        case INIT: return "INIT";
+        case CTLE: return "CTLE";
+        case RX:   return "RX";
+        case DONE: return "DONE";
+        case ERROR: return "ERROR";
+    }
+    return "?";
+}
+
+const char *init_phase_name(InitPhase p)
+{
+    switch (p) {
+        case INIT_LOAD:  return "load";
+        case INIT_CDR:   return "cdr";
+        case INIT_EDGES: return "edges";
+        case INIT_LAG:   return "lag";
+        case INIT_PRBS:  return "prbs";
+    }
+    return "?";
+}
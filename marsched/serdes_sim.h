@@ -37,6 +37,14 @@
 #define CTLE_NZ         5           /* # zero-frequency steps             */
 #define CTLE_WINDOW     500         /* symbols per sweep point            */
 
+/* RX slicer MSE: running mean over about this many symbols */
+#define RX_MSE_SPAN     256
+
+/* An RX retrain after a channel change (lane_retrain) that ends with the
+ * MSE more than this many times what it started from did not converge:
+ * the scheduler falls back to a full retrain from INIT. */
+#define RETRAIN_MSE_GROWTH  4.0
+
 /* Channel */
 #define MAX_CHANNEL_TAPS 4096
 
@@ -50,9 +58,21 @@ typedef enum {
     INIT,           /* generate PRBS, build channel, run CDR              */
     CTLE,           /* CTLE sweep / training                              */
     RX,             /* RX FFE + DFE adaptation                            */
-    DONE            /* link training complete                              */
+    DONE,           /* link training complete                              */
+    ERROR           /* channel file could not be loaded                   */
 } LaneState;
 
+/* INIT sub-phases, each resumable across scheduler steps.  A step does
+ * about what one CTLE/RX step does (STEP_SIZE samples through the L-tap
+ * channel). */
+typedef enum {
+    INIT_LOAD,      /* wait for the taps (chan_load.h), then copy them    */
+    INIT_CDR,       /* STEP_SIZE samples of the clock pattern → d_edge    */
+    INIT_EDGES,     /* STEP_SIZE · L entries of the zero-crossing scan    */
+    INIT_LAG,       /* … of the scan for the first edge above 0.8 · max   */
+    INIT_PRBS       /* STEP_SIZE · L / OSF symbols of PAM-4 PRBS          */
+} InitPhase;
+
 /* ═══════════════════════════════════════════════════════════════════════
  *  CTLE filter structure
  * ═══════════════════════════════════════════════════════════════════════ */
@@ -84,14 +104,27 @@ typedef struct {
     double channel_buffer[MAX_CHANNEL_TAPS]; /* FIR delay line            */
     const char *channel_file;       /* path to channel taps file          */
 
-    /* ── Bitstream (heap-allocated in lane_init) ────────────────────── */
+    /* ── Bitstream (heap-allocated in lane_init, or caller-owned) ───── */
     double *bits;                   /* [N_BIT]                            */
     double *bits_osf;               /* [N_BIT * OSF]                      */
+    int     own_bits;               /* lane_destroy() frees them          */
 
     /* ── CDR results ────────────────────────────────────────────────── */
     int sample_instant;
     int lag;
 
+    /* ── INIT progress ──────────────────────────────────────────────────
+     *  The CDR runs before the PRBS so its d_edge trace can live in
+     *  bits_osf, and its delay line in channel_buffer.                   */
+    InitPhase init_phase;
+    int       init_pt;              /* position within the sub-phase      */
+    int       load_entry;           /* chan_load entry and load awaited   */
+    unsigned  load_gen;             /* … 0 = none requested yet           */
+    int       load_err;             /* errno of the failed load (ERROR)   */
+    double    cdr_post;             /* previous clock-pattern output      */
+    double    edge_max;
+    int       cross_hist[OSF];      /* zero crossings by sample phase     */
+
     /* ── TX FFE (pre-programmed, not trained) ───────────────────────── */
     double TX_FFE[TX_FFE_LEN];
 
@@ -117,6 +150,14 @@ typedef struct {
     double mu_ffe;
     double mu_dfe;
 
+    /* slicer mean-square error: last CTLE window, or running in RX */
+    double mse;
+
+    /* ── Channel changes (hot reload) ───────────────────────────────── */
+    unsigned taps_version;          /* chan_load version of h_fir         */
+    int      retrain;               /* RX rerun by lane_retrain()         */
+    double   retrain_mse;           /* … and the MSE it started from      */
+
     /* ── Iteration bookkeeping ──────────────────────────────────────── */
     int pt;                         /* current sample index in phase      */
     int N_samp;                     /* total samples for current phase    */
@@ -132,7 +173,6 @@ void   ctle_design(CTLEFilter *ctle, double Fs,
                    double zHz, double pHz, double A);
 double ctle_step  (CTLEFilter *ctle, double x);
 
-int    load_channel_taps(const char *filename, double *h_fir, int max_taps);
 double adc_quantize(double x, int B);
 int    int_mode(const int *arr, int n);
 
@@ -143,8 +183,12 @@ int    int_mode(const int *arr, int n);
  *  lane_init()          Allocate buffers and enter INIT state.
  *                       Lightweight — no DSP work is performed.
  *
- *  lane_step_init()     Load channel taps from file, generate PRBS,
- *                       run CDR.  Transitions → CTLE.
+ *  lane_init_with()     Same, with caller-owned bitstream buffers
+ *                       ([N_BIT] and [N_BIT * OSF]).
+ *
+ *  lane_step_init()     Advance INIT by one budgeted chunk: load
+ *                       channel taps, run CDR, analyse edges, generate
+ *                       PRBS.  Transitions → CTLE after the last chunk.
  *
  *  lane_step_ctle()     Advance CTLE sweep by STEP_SIZE samples.
  *                       Transitions → RX when sweep is complete.
@@ -154,14 +198,30 @@ int    int_mode(const int *arr, int n);
  *
  *  lane_soft_reset()    Re-enter INIT (reloads channel on next step).
  *
+ *  lane_channel_changed()  The lane's channel file has newer taps than
+ *                       the ones it is training or trained on.
+ *
+ *  lane_retrain()       Take those taps.  A lane with its CTLE chosen
+ *                       (RX, DONE) reruns RX adaptation only, starting
+ *                       from its current CTLE, FFE and DFE, with CDR
+ *                       and PRBS kept: returns 1.  Any other lane
+ *                       starts over with lane_soft_reset(): returns 0.
+ *
  *  lane_destroy()       Free heap memory owned by the context.
  */
 void lane_init         (LaneContext *ctx, int dataRateGbps,
                         const char *channel_file);
+void lane_init_with    (LaneContext *ctx, int dataRateGbps,
+                        const char *channel_file,
+                        double *bits, double *bits_osf);
 void lane_step_init    (LaneContext *ctx);
 void lane_step_ctle    (LaneContext *ctx);
 void lane_step_rx      (LaneContext *ctx);
 void lane_soft_reset   (LaneContext *ctx);
+int  lane_channel_changed(const LaneContext *ctx);
+int  lane_retrain      (LaneContext *ctx);
 void lane_destroy      (LaneContext *ctx);
+const char *state_name(LaneState s);
+const char *init_phase_name(InitPhase p);
 
 #endif /* SERDES_SIM_H */
\ No newline at end of file
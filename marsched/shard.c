@@ -0,0 +1,199 @@
+/*
+ * shard.c
+ *
+ * Worker processes and the shared-memory SPSC rings between them and
+ * the coordinator (see shard.h).
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "shard.h"
+
+static ShardWorker *workers;
+static int          n_workers;
+static size_t       map_size;
+static pid_t        coordinator;
+
+/* ── Rings ────────────────────────────────────────────────────────────── */
+
+void *shard_ring_reserve(ShardRing *r)
+{
+    uint32_t head = r->head;
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == r->slots)
+        return NULL;
+    return r->data + (size_t)(head & (r->slots - 1)) * r->size;
+}
+
+void shard_ring_publish(ShardRing *r)
+{
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+const void *shard_ring_peek(ShardRing *r)
+{
+    uint32_t tail = r->tail;
+    if (tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+        return NULL;
+    return r->data + (size_t)(tail & (r->slots - 1)) * r->size;
+}
+
+void shard_ring_release(ShardRing *r)
+{
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
+
+int shard_orphaned(void)
+{
+    return getppid() != coordinator;
+}
+
+void *shard_reserve_wait(ShardRing *r)
+{
+    void *slot;
+    while (!(slot = shard_ring_reserve(r))) {
+        if (shard_orphaned())
+            _exit(1);               /* nobody left to drain it */
+        usleep(50);
+    }
+    return slot;
+}
+
+static size_t ring_bytes(uint32_t slots, uint32_t size)
+{
+    return ((size_t)slots * size + 63) & ~(size_t)63;
+}
+
+static char *ring_setup(ShardRing *r, char *data, uint32_t slots, uint32_t size)
+{
+    r->head  = r->tail = 0;
+    r->slots = slots;
+    r->size  = size;
+    r->data  = data;
+    return data + ring_bytes(slots, size);
+}
+
+/* ── Processes ────────────────────────────────────────────────────────── */
+
+int shard_spawn(int count, int lanes)
+{
+    size_t per_worker = ring_bytes(SHARD_CMD_SLOTS, sizeof(ScriptCmd)) +
+                        ring_bytes(SHARD_EVT_SLOTS, sizeof(ShardEvent)) +
+                        ring_bytes(SHARD_STATUS_SLOTS, sizeof(LaneStatus));
+    size_t head = ((size_t)count * sizeof(ShardWorker) + 63) & ~(size_t)63;
+
+    map_size = head + (size_t)count * per_worker;
+    for (int w = 0; w < count; w++)
+        map_size += lane_snap_table_size(lanes / count + 1);
+    char *p = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap(shard rings)");
+        return -2;
+    }
+
+    workers     = (ShardWorker *)p;
+    n_workers   = count;
+    coordinator = getpid();
+
+    char *data = p + head;
+    for (int w = 0; w < count; w++) {
+        ShardWorker *sw = &workers[w];
+        sw->id = w;
+        sw->lo = (int)((long long)lanes * w / count);
+        sw->hi = (int)((long long)lanes * (w + 1) / count);
+        data = ring_setup(&sw->cmd,    data, SHARD_CMD_SLOTS,    sizeof(ScriptCmd));
+        data = ring_setup(&sw->evt,    data, SHARD_EVT_SLOTS,    sizeof(ShardEvent));
+        data = ring_setup(&sw->status, data, SHARD_STATUS_SLOTS, sizeof(LaneStatus));
+        sw->snaps = (LaneSnapTable *)data;
+        lane_snap_table_init(sw->snaps, sw->lo, sw->hi - sw->lo);
+        data += lane_snap_table_size(sw->hi - sw->lo);
+    }
+
+    fflush(NULL);                   /* nothing buffered twice */
+    for (int w = 0; w < count; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            for (int k = 0; k < w; k++)
+                kill(workers[k].pid, SIGKILL);
+            while (wait(NULL) > 0)
+                ;
+            shard_unmap();
+            return -2;
+        }
+        if (pid == 0)
+            return w;
+        workers[w].pid = pid;
+    }
+    return -1;
+}
+
+int shard_count(void)
+{
+    return n_workers;
+}
+
+ShardWorker *shard_get(int w)
+{
+    return &workers[w];
+}
+
+int shard_owner(int lane)
+{
+    for (int w = 0; w < n_workers; w++)
+        if (lane >= workers[w].lo && lane < workers[w].hi)
+            return w;
+    return -1;
+}
+
+void shard_unmap(void)
+{
+    if (workers)
+        munmap(workers, map_size);
+    workers   = NULL;
+    n_workers = 0;
+}
+
+/* ── Worker output ────────────────────────────────────────────────────── */
+
+static ssize_t evt_write(void *cookie, const char *buf, size_t size)
+{
+    ShardWorker *w = cookie;
+    size_t done = 0;
+    while (done < size) {
+        ShardEvent *e = shard_reserve_wait(&w->evt);
+        size_t n = size - done;
+        if (n > SHARD_TEXT_MAX) n = SHARD_TEXT_MAX;
+        e->kind = SHARD_EVT_TEXT;
+        e->len  = (int)n;
+        memcpy(e->text, buf + done, n);
+        shard_ring_publish(&w->evt);
+        done += n;
+    }
+    return (ssize_t)size;
+}
+
+FILE *shard_stdout(ShardWorker *w)
+{
+    cookie_io_functions_t io = { .write = evt_write };
+    FILE *fp = fopencookie(w, "w", io);
+    if (fp)
+        setvbuf(fp, NULL, _IOLBF, 0);
+    return fp;
+}
+
+void shard_linkup(ShardWorker *w, int ticks, uint64_t ns)
+{
+    fflush(stdout);                 /* keep it behind the DONE line */
+    ShardEvent *e = shard_reserve_wait(&w->evt);
+    e->kind  = SHARD_EVT_LINKUP;
+    e->ticks = ticks;
+    e->ns    = ns;
+    shard_ring_publish(&w->evt);
+}
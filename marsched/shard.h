@@ -0,0 +1,120 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "serdes_sim.h"
+#include "script.h"
+#include "lane_snap.h"
+
+/* ═══════════════════════════════════════════════════════════════════════
+ *  Lane sharding across worker processes (-w <workers>)
+ * ═══════════════════════════════════════════════════════════════════════
+ *
+ *  The coordinator (the process started from the shell) keeps the
+ *  console, stdin, the -S script and the --bench results.  It forks
+ *  workers, and each one runs the ordinary scheduler loop over a
+ *  contiguous shard of lanes with its own arena, run queue, tick count
+ *  and log file.  A worker that crashes takes only its shard down; the
+ *  coordinator reports it and the other shards run on.  Each worker is
+ *  its own process, so it can be placed in its own cgroup (the pids are
+ *  printed at start-up).
+ *
+ *  Everything between the two sides goes through single-producer,
+ *  single-consumer rings in one MAP_SHARED mapping made before fork(),
+ *  three per worker:
+ *
+ *    cmd      coordinator → worker   command lines, tick-stamped for -S
+ *                                    (tick 0: apply now)
+ *    evt      worker → coordinator   console text and link-up records
+ *    status   worker → coordinator   LaneStatus for a scripted 's'
+ *
+ *  Slots are written and read in place: the coordinator prints a status
+ *  straight from the ring slot and only then releases it.  Head and tail
+ *  sit on separate cache lines and are the only shared writes
+ *  (release/acquire).
+ *
+ *  Each worker also publishes its lanes' snapshots (lane_snap.h) into a
+ *  table in the same mapping.  An 's' or 'q' typed at the coordinator is
+ *  answered from those tables straight away, without asking the
+ *  workers; only scripted ones, which must see the lanes at their tick,
+ *  go through the cmd and status rings.
+ *
+ *  Lane numbers are global everywhere (console, commands, logs); worker
+ *  w owns lanes [lo, hi).
+ */
+#define SHARD_MAX_WORKERS   64
+#define SHARD_CMD_SLOTS     256
+#define SHARD_EVT_SLOTS     1024
+#define SHARD_STATUS_SLOTS  256
+#define SHARD_TEXT_MAX      240
+
+typedef struct {
+    uint32_t head __attribute__((aligned(64)));    /* written by producer  */
+    uint32_t tail __attribute__((aligned(64)));    /* written by consumer  */
+    uint32_t slots __attribute__((aligned(64)));   /* power of two         */
+    uint32_t size;                                 /* bytes per slot       */
+    char    *data;
+} ShardRing;
+
+/* Producer: free slot to fill, or NULL if the ring is full; then publish. */
+void *shard_ring_reserve(ShardRing *r);
+void  shard_ring_publish(ShardRing *r);
+
+/* Consumer: oldest unread slot, or NULL if empty; release when done. */
+const void *shard_ring_peek(ShardRing *r);
+void  shard_ring_release(ShardRing *r);
+
+typedef enum {
+    SHARD_EVT_TEXT,                 /* console output                     */
+    SHARD_EVT_LINKUP                /* a lane reached DONE (for --bench)  */
+} ShardEvtKind;
+
+typedef struct {
+    int      kind;
+    int      len;                   /* TEXT: bytes in text                */
+    int      ticks;                 /* LINKUP                             */
+    uint64_t ns;
+    char     text[SHARD_TEXT_MAX];
+} ShardEvent;
+
+typedef struct {
+    int      id;
+    int      lo, hi;                /* lanes owned                        */
+    pid_t    pid;
+    int      closed;                /* coordinator: no more commands      */
+    int      finished;              /* worker: ran to the end (stats set) */
+
+    /* step statistics, filled in by the worker before it exits */
+    uint64_t phase_ns[DONE];
+    uint64_t phase_steps[DONE];
+    uint64_t phase_max_ns[DONE];
+
+    ShardRing cmd;                  /* ScriptCmd slots                    */
+    ShardRing evt;                  /* ShardEvent slots                   */
+    ShardRing status;               /* LaneStatus slots                   */
+    LaneSnapTable *snaps;           /* lanes lo .. hi−1                   */
+} ShardWorker;
+
+/* Map the rings for `workers` workers over `lanes` lanes and fork them.
+ * Returns -1 in the coordinator, or the worker index in a worker.  If
+ * the mapping or any fork fails, no workers are left running and it
+ * returns -2 (after reporting why). */
+int  shard_spawn(int workers, int lanes);
+
+int          shard_count(void);
+ShardWorker *shard_get(int w);
+int          shard_owner(int lane);
+
+/* Worker side: stdout into the evt ring; link-up records; wait for ring
+ * space (exits if the coordinator is gone). */
+FILE *shard_stdout(ShardWorker *w);
+void  shard_linkup(ShardWorker *w, int ticks, uint64_t ns);
+void *shard_reserve_wait(ShardRing *r);
+int   shard_orphaned(void);         /* the coordinator has gone          */
+
+void  shard_unmap(void);
+
+#endif /* SHARD_H */
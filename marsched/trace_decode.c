@@ -0,0 +1,250 @@
+/*
+ * trace_decode.c
+ *
+ * Offline decoder for binary scheduler traces written with `sched -t`.
+ *
+ *   trace_decode <trace.bin>                 sched.log-style text on stdout
+ *   trace_decode --json [opts] <trace.bin>   Chrome trace / Perfetto JSON
+ *
+ * JSON options:
+ *   --no-steps     omit per-step slices (keep phases, grid points, cmds)
+ *   --tick-us <n>  wall time of one scheduler tick (default 10 µs)
+ *
+ * Timeline layout: one track per lane.  Each track shows the INIT / CTLE
+ * / RX phases as slices, CTLE sweep grid points nested inside CTLE, and
+ * (unless --no-steps) one slice per scheduler step, so the gaps between
+ * a lane's steps are the time it waited to be scheduled.  Commands are
+ * global instant events.  A per-lane summary goes to stderr.
+ */
+
+#include "sched_trace.h"
+
+typedef struct {
+    int      seen;
+    int      phase;
+    uint32_t phase_start;
+    int      grid;
+    uint32_t grid_start;
+    uint32_t last_step;
+    uint32_t max_gap;
+    uint64_t steps;
+    uint64_t phase_ticks[DONE + 1];
+} LaneTimeline;
+
+static FILE  *out;
+static int    first_event = 1;
+static double tick_us     = 10.0;
+
+static void event_sep(void)
+{
+    fputs(first_event ? "\n  " : ",\n  ", out);
+    first_event = 0;
+}
+
+static void json_escape(const char *s)
+{
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', out);
+        if (*s == '\n')
+            continue;
+        fputc(*s, out);
+    }
+}
+
+static void emit_slice(int lane, const char *name, uint32_t start,
+                       uint32_t end, const char *args)
+{
+    event_sep();
+    fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+            "\"ts\":%.3f,\"dur\":%.3f%s%s%s}",
+            name, lane, start * tick_us, (end - start) * tick_us,
+            args ? ",\"args\":{" : "", args ? args : "", args ? "}" : "");
+}
+
+static void close_phase(LaneTimeline *lt, int lane, uint32_t end)
+{
+    if (lt->phase >= DONE) return;      /* DONE and any later terminal state */
+    lt->phase_ticks[lt->phase] += end - lt->phase_start;
+    emit_slice(lane, state_name((LaneState)lt->phase), lt->phase_start, end, NULL);
+}
+
+static LaneTimeline *lane_tl(LaneTimeline *tl, int lane)
+{
+    LaneTimeline *lt = &tl[lane];
+    if (!lt->seen) {
+        lt->seen  = 1;
+        lt->phase = INIT;
+        event_sep();
+        fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"Lane %d\"}}", lane, lane);
+        event_sep();
+        fprintf(out, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"sort_index\":%d}}", lane, lane);
+    }
+    return lt;
+}
+
+static int export_json(TraceReader *tr, int with_steps)
+{
+    LaneTimeline *tl = calloc(TRACE_MAX_LANES, sizeof(LaneTimeline));
+    if (!tl) return 1;
+
+    LogRecord r;
+    int rc;
+    uint32_t last_tick = 0;
+    char args[160], name[160];
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"tick_us\":%g},"
+            "\"traceEvents\":[", tick_us);
+    event_sep();
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"args\":{\"name\":\"scheduler\"}}");
+
+    while ((rc = trace_read(tr, &r)) == 1) {
+        last_tick = r.tick;
+
+        switch ((LogKind)r.kind) {
+            case LOG_REC_STEP:
+            case LOG_REC_STEP_PRIO: {
+                LaneTimeline *lt = lane_tl(tl, r.lane);
+                if (lt->steps && r.tick - lt->last_step > lt->max_gap)
+                    lt->max_gap = r.tick - lt->last_step;
+                lt->last_step = r.tick;
+                lt->steps++;
+                if (with_steps) {
+                    snprintf(args, sizeof(args), "\"pt\":%d,\"N_samp\":%d",
+                             r.u.step.pt, r.u.step.n_samp);
+                    emit_slice(r.lane, "step", r.tick, r.tick + 1, args);
+                }
+                break;
+            }
+
+            case LOG_REC_CTLE_GRID: {
+                LaneTimeline *lt = lane_tl(tl, r.lane);
+                snprintf(name, sizeof(name), "grid %d/%d",
+                         r.u.grid.old_grid + 1, CTLE_NA * CTLE_NZ);
+                snprintf(args, sizeof(args), "\"A\":%.4f,\"z\":%.4e,\"MSE\":%.6f",
+                         r.u.grid.A_prev, r.u.grid.z_prev, r.u.grid.J);
+                emit_slice(r.lane, name, lt->grid_start, r.tick + 1, args);
+                lt->grid       = r.u.grid.new_grid;
+                lt->grid_start = r.tick + 1;
+                break;
+            }
+
+            case LOG_REC_TRANS: {
+                LaneTimeline *lt = lane_tl(tl, r.lane);
+                close_phase(lt, r.lane, r.tick + 1);
+                lt->phase       = r.u.trans.next;
+                lt->phase_start = r.tick + 1;
+                if (lt->phase == CTLE) {
+                    lt->grid       = 0;
+                    lt->grid_start = r.tick + 1;
+                }
+                if (lt->phase == DONE) {
+                    event_sep();
+                    fprintf(out, "{\"name\":\"link up\",\"ph\":\"i\",\"s\":\"t\","
+                            "\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                            r.lane, (r.tick + 1) * tick_us);
+                }
+                break;
+            }
+
+            case LOG_REC_TEXT: {
+                char text[160];
+                snprintf(text, sizeof(text), r.u.text.fmt,
+                         r.u.text.a[0], r.u.text.a[1], r.u.text.a[2]);
+                event_sep();
+                fprintf(out, "{\"name\":\"");
+                json_escape(text);
+                fprintf(out, "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,"
+                        "\"ts\":%.3f}", r.tick * tick_us);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    /* close phases still open at the end of the trace */
+    for (int lane = 0; lane < TRACE_MAX_LANES; lane++)
+        if (tl[lane].seen)
+            close_phase(&tl[lane], lane, last_tick + 1);
+
+    fprintf(out, "\n]}\n");
+
+    fprintf(stderr, "lane    steps  max_gap      INIT      CTLE        RX  (ticks)\n");
+    for (int lane = 0; lane < TRACE_MAX_LANES; lane++) {
+        LaneTimeline *lt = &tl[lane];
+        if (!lt->seen) continue;
+        fprintf(stderr, "%4d %8llu %8u %9llu %9llu %9llu\n", lane,
+                (unsigned long long)lt->steps, lt->max_gap,
+                (unsigned long long)lt->phase_ticks[INIT],
+                (unsigned long long)lt->phase_ticks[CTLE],
+                (unsigned long long)lt->phase_ticks[RX]);
+    }
+
+    free(tl);
+    if (rc < 0) {
+        fprintf(stderr, "trace_decode: corrupt record after tick %u\n", last_tick);
+        return 1;
+    }
+    return 0;
+}
+
+static int export_text(TraceReader *tr)
+{
+    LogRecord r;
+    int rc;
+    while ((rc = trace_read(tr, &r)) == 1)
+        lane_log_format(out, &r);
+    if (rc < 0) {
+        fprintf(stderr, "trace_decode: corrupt record\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    int json = 0, with_steps = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0)
+            json = 1;
+        else if (strcmp(argv[i], "--no-steps") == 0)
+            with_steps = 0;
+        else if (strcmp(argv[i], "--tick-us") == 0 && i + 1 < argc)
+            tick_us = atof(argv[++i]);
+        else
+            path = argv[i];
+    }
+
+    if (!path) {
+        fprintf(stderr, "Usage: %s [--json [--no-steps] [--tick-us <n>]] <trace.bin>\n",
+                argv[0]);
+        return 1;
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return 1;
+    }
+
+    TraceReader tr;
+    if (trace_reader_open(&tr, fp) != 0) {
+        fprintf(stderr, "%s: not a scheduler trace\n", path);
+        fclose(fp);
+        return 1;
+    }
+
+    out = stdout;
+    int rc = json ? export_json(&tr, with_steps) : export_text(&tr);
+
+    trace_reader_close(&tr);
+    fclose(fp);
+    return rc;
+}